@@ -6,12 +6,28 @@
 /* sequence alignment algorithm.                                         */
 /*=======================================================================*/
 #include "PWA_alignment.h"
+#include "PWA_banded.h"
+#include "PWA_cache.h"
+#include "PWA_diagonal.h"
+#include "PWA_difference.h"
+#include "PWA_linear.h"
 #include "PWA_message.h"
 #include "PWA_option.h"
+#include "PWA_overlap.h"
+#include "PWA_planner.h"
+#include "PWA_profile.h"
+#include "PWA_russians.h"
+#include "PWA_scheduler.h"
+#include "PWA_strand.h"
+#include "PWA_traceback.h"
+#include "PWA_wavefront.h"
 
 #include <algorithm>
+#include <climits>
 #include <iostream>
 #include <fstream>
+#include <new>
+#include <sstream>
 #include <stdlib.h>
 #include <string>
 
@@ -39,9 +55,34 @@ PWA_alignment::PWA_alignment()
     max_score         =  0;
     number_aligned    =  0;
     width = height    =  0;
+    alignment_matrix  = NULL;
+    steps_buffer      = NULL;
+    steps_count       =  0;
 
     scoring_specified =  0;
 
+    cache_obj         = NULL;
+    planner_obj       = NULL;
+    diagonal_obj      = NULL;
+    store_obj         = NULL;
+    profile_obj       = NULL;
+    scheduler_obj     = NULL;
+    worker_index      = 0;
+    engine            = "nw";
+    band_width        = 0;
+    xdrop             = 0;
+    both_strands      = 0;
+    traceback_filename = "";
+    strand            = '+';
+    score_only        = 0;
+    min_score_specified = 0;
+    min_score         = 0;
+    time_limit        = 0;
+    cell_limit        = 0;
+    limit_fallback    = 1;
+    alignment_status  = status_complete;
+    best_substitution_score = 1;
+
 }    // End PWA_alignment::PWA_alignment().
 
 
@@ -50,18 +91,352 @@ PWA_alignment::PWA_alignment()
 /*-----------------------------------------------------------------------*/
 /* Calls methods for the Needleman-Wunsch pairwise sequence alignment    */
 /* algorithm.                                                            */
+/*                                                                       */
+/* If a result cache has been attached with cache_obj, the cache is      */
+/* consulted first and the alignment is only computed (and then added    */
+/* to the cache) if this pair has not been aligned before with the same  */
+/* scoring scheme.                                                       */
+/*                                                                       */
+/* The engine used depends on engine:                                    */
+/*     nw     : full matrix, fill_alignment_matrix() (default)           */
+/*     banded : only a band of band_width around the diagonal            */
+/*     linear : Hirschberg's linear-space algorithm                      */
+/*     score  : score only, two matrix rows                              */
+/*     wfa    : wavefront alignment (+1/-1 scoring only)                 */
+/*     diff   : nw on 8-bit score differences, if the scores fit         */
+/*     russians: nw by table lookup of 2x2 blocks (+1/-1 scoring)        */
+/*     overlap: overlap alignment with free end gaps and X-drop pruning  */
+/* With a traceback_filename, nw keeps its steps in a memory-mapped      */
+/* scratch file instead (see PWA_traceback). In batch mode, a large nw   */
+/* matrix is filled in tiles by all the workers of scheduler_obj (see    */
+/* fill_in_tiles()).                                                     */
+/* If a planner has been attached with planner_obj, it picks the engine  */
+/* for each pair of a global engine from the memory budget instead.      */
+/* Overlap alignments are never planned or cached, since they answer a   */
+/* different question than the global engines.                           */
+/*                                                                       */
+/* With both_strands, PWA_strand first scores sequence 1 against both    */
+/* strands of sequence 2 and, if the reverse complement scores better,   */
+/* replaces sequence 2 with it before any of the above.                  */
+/*                                                                       */
+/* With min_score_specified, a pair whose score cannot reach min_score   */
+/* is abandoned with alignment_status set to status_below_min_score:     */
+/* before any work if even a perfect global alignment would fall short,  */
+/* and during the fill by the nw and score engines (see                  */
+/* can_reach_min_score()).                                               */
+/*                                                                       */
+/* With a diagonal_obj, a global pair is first screened by an ungapped   */
+/* scan of its diagonals (see PWA_diagonal): it may be accepted with its */
+/* ungapped alignment, or rejected with alignment_status set to          */
+/* status_filtered, before any engine runs.                              */
+/*                                                                       */
+/* With a cell_limit, a pair whose matrix has more cells is not given to */
+/* a quadratic engine (overlap without an X-drop included) at all; the   */
+/* wfa and X-drop overlap engines stop once they have computed more      */
+/* cells. With a time_limit, every engine but banded checks the clock    */
+/* after every row (or tile, anti-diagonal, block row or wavefront) and  */
+/* stops once it has passed. Either way the pair is aligned by the       */
+/* banded engine instead, with alignment_status set to                   */
+/* status_banded_fallback, or, without limit_fallback, abandoned with    */
+/* status_over_limit.                                                    */
+/*                                                                       */
+/* With a profile_obj, each of these steps is profiled as a phase (see   */
+/* align_phases()).                                                      */
 /*=======================================================================*/
 void PWA_alignment::begin_PWA_alignment(PWA_message *msg_obj)
 {
-    resize_alignment_matrix();
+    if (time_limit > 0)
+    {
+        deadline = chrono::steady_clock::now() +
+                   chrono::duration_cast<chrono::steady_clock::duration>(
+                       chrono::duration<double>(time_limit));
+    }
 
-    fill_alignment_matrix();
+    align_phases(msg_obj);
+    end_profile_phase();
 
-    trace_back_steps();
+}    // End PWA_alignment::begin_PWA_alignment()
 
-    compute_alignment_score();
 
-}    // End PWA_alignment::begin_PWA_alignment()
+/*=======================================================================*/
+/* Method: PWA_alignment::align_phases()                                 */
+/*-----------------------------------------------------------------------*/
+/* Performs the steps of begin_PWA_alignment(), starting a profile phase */
+/* before each: strand, diagonal, cache, then fill, traceback and score  */
+/* for the nw engine, or the name of any other engine. May return in any */
+/* phase; the caller ends it.                                            */
+/*=======================================================================*/
+void PWA_alignment::align_phases(PWA_message *msg_obj)
+{
+    PWA_cache_key cache_key;
+    string pair_engine = engine;
+    bool   overlap     = (engine == "overlap");
+
+    if (both_strands == 1)
+    {
+        begin_profile_phase("strand");
+        PWA_strand strand_obj;
+        strand_obj.choose_strand(this);
+    }
+
+    if ((min_score_specified == 1) && !overlap)
+    {
+        set_best_substitution_score();
+        if (get_score_bound(0, sequences_vector[1].length(),
+                            sequences_vector[0].length()) < min_score)
+        {
+            alignment_status = status_below_min_score;
+            return;
+        }
+    }
+
+    if ((diagonal_obj != NULL) && !overlap)
+    {
+        begin_profile_phase("diagonal");
+        if (diagonal_obj->screen_pair(this))
+        {
+            if ((alignment_status == status_complete) &&
+                (min_score_specified == 1) && (alignment_score < min_score))
+            {
+                alignment_status = status_below_min_score;
+            }
+            return;
+        }
+    }
+
+    if ((planner_obj != NULL) && !overlap)
+    {
+        long predicted_bytes = 0;
+        pair_engine = planner_obj->plan_alignment(
+                          sequences_vector[0].length(),
+                          sequences_vector[1].length(), &predicted_bytes);
+    }
+
+    if (cache_obj != NULL)
+    {
+        begin_profile_phase("cache");
+        cache_key = cache_obj->get_alignment_key(this, pair_engine);
+        if (cache_obj->lookup_alignment(this, cache_key))
+        {
+            if ((min_score_specified == 1) && (alignment_score < min_score))
+            {
+                alignment_status = status_below_min_score;
+            }
+            return;
+        }
+    }
+
+    long cells = (long)(sequences_vector[0].length() + 1) *
+                 (sequences_vector[1].length() + 1);
+    bool quadratic = (pair_engine != "banded") &&
+                     !((pair_engine == "wfa") && (scoring_specified == 0)) &&
+                     !(overlap && (xdrop > 0));
+
+    if ((cell_limit > 0) && quadratic && (cells > cell_limit))
+    {
+        // Over the budget before any work: not even started.
+        alignment_status = status_over_limit;
+    }
+    else if (overlap)
+    {
+        begin_profile_phase("overlap");
+        PWA_overlap overlap_obj;
+        overlap_obj.begin_overlap_alignment(this);
+    }
+    else if ((pair_engine == "wfa") && (scoring_specified == 0))
+    {
+        begin_profile_phase("wfa");
+        PWA_wavefront wavefront_obj;
+        wavefront_obj.begin_wavefront_alignment(this);
+    }
+    else if ((pair_engine == "diff") &&
+             PWA_difference::fits_in_8_bits(this))
+    {
+        begin_profile_phase("diff");
+        PWA_difference difference_obj;
+        difference_obj.begin_difference_alignment(this);
+    }
+    else if ((pair_engine == "russians") && PWA_russians::can_align(this))
+    {
+        begin_profile_phase("russians");
+        PWA_russians russians_obj;
+        russians_obj.begin_russians_alignment(this);
+    }
+    else if (pair_engine == "banded")
+    {
+        begin_profile_phase("banded");
+        PWA_banded banded_obj;
+        banded_obj.begin_banded_alignment(this);
+    }
+    else if (pair_engine == "linear")
+    {
+        begin_profile_phase("linear");
+        PWA_linear linear_obj;
+        linear_obj.begin_linear_alignment(this);
+    }
+    else if (pair_engine == "score")
+    {
+        begin_profile_phase("score only");
+        PWA_linear linear_obj;
+        linear_obj.begin_score_only(this);
+    }
+    else if (!traceback_filename.empty())
+    {
+        begin_profile_phase("nw on disk");
+        PWA_traceback traceback_obj;
+        traceback_obj.begin_traceback_alignment(this, msg_obj);
+
+        if (alignment_status == status_below_min_score)
+        {
+            return;
+        }
+    }
+    else
+    {
+        begin_profile_phase("fill");
+        resize_alignment_matrix();
+
+        if ((scheduler_obj != NULL) && (min_score_specified == 0) &&
+            scheduler_obj->can_fill_in_tiles((long)width * height))
+        {
+            fill_in_tiles();
+        }
+        else
+        {
+            fill_alignment_matrix();
+        }
+
+        if (alignment_status == status_below_min_score)
+        {
+            return;
+        }
+
+        if (alignment_status == status_complete)
+        {
+            begin_profile_phase("traceback");
+            trace_back_steps();
+
+            begin_profile_phase("score");
+            compute_alignment_score();
+        }
+    }
+
+    if (alignment_status == status_over_limit)
+    {
+        if (limit_fallback == 0)
+        {
+            return;
+        }
+
+        // A quick alignment, if perhaps not the best, beats none.
+        begin_profile_phase("banded");
+        PWA_banded banded_obj;
+        banded_obj.begin_banded_alignment(this);
+        alignment_status = status_banded_fallback;
+        pair_engine = "banded";
+    }
+
+    if ((min_score_specified == 1) && (alignment_score < min_score))
+    {
+        alignment_status = status_below_min_score;
+        return;
+    }
+
+    // A banded fallback depends on the limits, not just the pair.
+    if ((cache_obj != NULL) && (alignment_status == status_complete))
+    {
+        begin_profile_phase("cache");
+        cache_obj->store_alignment(this, cache_key);
+    }
+
+}    // End PWA_alignment::align_phases()
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::begin_profile_phase()                          */
+/*-----------------------------------------------------------------------*/
+/* Starts the profile phase name, ending the previous one, if profiling. */
+/*=======================================================================*/
+void PWA_alignment::begin_profile_phase(const string &name)
+{
+    if (profile_obj != NULL)
+    {
+        profile_obj->begin_phase(name);
+    }
+
+}    // End PWA_alignment::begin_profile_phase()
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::end_profile_phase()                            */
+/*-----------------------------------------------------------------------*/
+/* Ends the current profile phase, if profiling.                         */
+/*=======================================================================*/
+void PWA_alignment::end_profile_phase(void)
+{
+    if (profile_obj != NULL)
+    {
+        profile_obj->end_phase();
+    }
+
+}    // End PWA_alignment::end_profile_phase()
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::reset_alignment()                              */
+/*-----------------------------------------------------------------------*/
+/* Clears the names, sequences, steps and totals of the previous         */
+/* alignment so that the same object can align another pair. The         */
+/* scoring_map and arena_obj are kept, so workers in batch mode do not   */
+/* reload the scoring table or remap the matrix for every pair.          */
+/*=======================================================================*/
+void PWA_alignment::reset_alignment(void)
+{
+    names_vector.clear();
+    sequences_vector.clear();
+    store_obj   = NULL;
+    steps_count = 0;
+
+    alignment_score = 0;
+    number_aligned  = 0;
+    max_score       = 0;
+    score_only      = 0;
+    alignment_status = status_complete;
+    strand          = '+';
+
+}    // End PWA_alignment::reset_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::copy_settings_from()                           */
+/*-----------------------------------------------------------------------*/
+/* Copies the scoring scheme and alignment settings (but not the         */
+/* sequences or results) of PWA_obj, so that a worker's own object       */
+/* aligns exactly like the object set up from the command line. The      */
+/* profile is not copied: each worker profiles into its own (see         */
+/* PWA_pipeline::begin_worker_profile()).                                */
+/*=======================================================================*/
+void PWA_alignment::copy_settings_from(PWA_alignment *PWA_obj)
+{
+    scoring_map       = PWA_obj->scoring_map;
+    scoring_specified = PWA_obj->scoring_specified;
+    gap_penalty       = PWA_obj->gap_penalty;
+    score_table       = PWA_obj->score_table;
+    cache_obj         = PWA_obj->cache_obj;
+    planner_obj       = PWA_obj->planner_obj;
+    diagonal_obj      = PWA_obj->diagonal_obj;
+    engine            = PWA_obj->engine;
+    band_width        = PWA_obj->band_width;
+    xdrop             = PWA_obj->xdrop;
+    both_strands      = PWA_obj->both_strands;
+    traceback_filename = PWA_obj->traceback_filename;
+    min_score_specified = PWA_obj->min_score_specified;
+    min_score         = PWA_obj->min_score;
+    time_limit        = PWA_obj->time_limit;
+    cell_limit        = PWA_obj->cell_limit;
+    limit_fallback    = PWA_obj->limit_fallback;
+
+}    // End PWA_alignment::copy_settings_from().
 
 
 /*=======================================================================*/
@@ -71,6 +446,11 @@ void PWA_alignment::begin_PWA_alignment(PWA_message *msg_obj)
 /* ((length of sequence 2) + 1). The matrix only contains the integer    */
 /* values and not the characters of the sequences themselves in order    */
 /* to make the matrix of only int data type for easier computations.     */
+/*                                                                       */
+/* The matrix, its row pointers and steps_buffer (one step per cell) are */
+/* carved from arena_obj in one go, so aligning a pair no larger than    */
+/* an earlier one of this object allocates nothing. Throws bad_alloc,    */
+/* like any other allocation, if the arena cannot be mapped.             */
 /*=======================================================================*/
 void PWA_alignment::resize_alignment_matrix(void)
 {
@@ -78,13 +458,24 @@ void PWA_alignment::resize_alignment_matrix(void)
     width  = sequences_vector[0].length() + 1;
     height = sequences_vector[1].length() + 1;
 
-    // Resize number of rows.
-    alignment_matrix.resize(height);
+    size_t cells = (size_t)width * height;
+
+    // Three allocations, each padded to a cache line at most.
+    if (!arena_obj.reserve((height * sizeof(int *)) +
+                           (cells * sizeof(int)) + cells + 256))
+    {
+        throw bad_alloc();
+    }
+
+    alignment_matrix = (int **)arena_obj.allocate(height * sizeof(int *));
+    int *cell_scores = (int *)arena_obj.allocate(cells * sizeof(int));
+    steps_buffer     = (char *)arena_obj.allocate(cells);
+    steps_count      = 0;
 
-    // Resize number of columns.
+    // Point each row into the flat matrix.
     for (int i = 0; i < height; i++)
     {
-        alignment_matrix[i].resize(width);
+        alignment_matrix[i] = cell_scores + ((size_t)i * width);
     }
 
 }    // End PWA_alignment::resize_alignment_matrix().
@@ -95,10 +486,11 @@ void PWA_alignment::resize_alignment_matrix(void)
 /*-----------------------------------------------------------------------*/
 /* Fills the alignment_matrix. The first row and column are filled with  */
 /* increasing gap penalty, then the values for the rest of the matrix    */
-/* are computed.                                                         */
+/* are computed. With min_score_specified, stops after any row from      */
+/* which min_score can no longer be reached.                             */
 /*                                                                       */
 /* Also contains debugging print statements to print the entire          */
-/* contents of alignment_matrix and steps_vector.                        */
+/* contents of alignment_matrix and steps_buffer.                        */
 /*=======================================================================*/
 void PWA_alignment::fill_alignment_matrix(void)
 {
@@ -107,14 +499,16 @@ void PWA_alignment::fill_alignment_matrix(void)
     int i    = 0;
     int j    = 0;
 
+    steps_count = 0;
+
     // Fill first row.
     for (j = 0; j < width; j++)
     {
         alignment_matrix[i][j] = fill;
         fill += gap_penalty;
-        steps_vector.push_back('L');
+        steps_buffer[steps_count++] = 'L';
     }
-    fill = -2;
+    fill = gap_penalty;
     j    = 0;
 
     // Fill first column.
@@ -127,12 +521,26 @@ void PWA_alignment::fill_alignment_matrix(void)
     // Compute rest of matrix.
     for (i = 1; i < height; i++)
     {
-        steps_vector.push_back('U');
+        steps_buffer[steps_count++] = 'U';
         for (j = 1; j < width; j++)
         {
             get_max_score(i, j);
             alignment_matrix[i][j] = max_score;
         }
+
+        if ((min_score_specified == 1) &&
+            !can_reach_min_score(&alignment_matrix[i][0], width - 1,
+                                 height - 1 - i))
+        {
+            alignment_status = status_below_min_score;
+            return;
+        }
+
+        if (exceeds_time_limit())
+        {
+            alignment_status = status_over_limit;
+            return;
+        }
     }
 
 #ifdef USEDEBUG_ALIGNMENT
@@ -152,17 +560,14 @@ void PWA_alignment::fill_alignment_matrix(void)
 
     // Print all step directions.
     debuga(endl << "Final step direction matrix:");
-    int counter = 0;
-    for (vector<char>::iterator it = steps_vector.begin();
-         it != steps_vector.end(); ++it)
+    for (long counter = 0; counter < steps_count; counter++)
     {
         // For readability.
         if (counter%(width) == 0)
         {
             debuga(endl);
         } 
-        debuga(*it << "   ");
-        counter++;
+        debuga(steps_buffer[counter] << "   ");
     }
     debuga(endl << endl);
 #endif
@@ -170,6 +575,55 @@ void PWA_alignment::fill_alignment_matrix(void)
 }    // End PWA_alignment::fill_alignment_matrix().
 
 
+/*=======================================================================*/
+/* Method: PWA_alignment::fill_in_tiles()                                */
+/*-----------------------------------------------------------------------*/
+/* Fills the same matrix and steps as fill_alignment_matrix(), but hands */
+/* everything after the first row and column to scheduler_obj, whose     */
+/* workers fill it in tiles. Scores come from score_table, so the tiles  */
+/* never touch scoring_map. Not used with min_score_specified, whose     */
+/* check needs the rows in order.                                        */
+/*=======================================================================*/
+void PWA_alignment::fill_in_tiles(void)
+{
+    if (score_table.empty())
+    {
+        build_score_table();
+    }
+
+    for (int j = 0; j < width; j++)
+    {
+        alignment_matrix[0][j] = j * gap_penalty;
+        steps_buffer[j] = 'L';
+    }
+    for (int i = 1; i < height; i++)
+    {
+        alignment_matrix[i][0] = i * gap_penalty;
+        steps_buffer[(long)i * width] = 'U';
+    }
+
+    PWA_tiling tiling;
+    tiling.matrix      = alignment_matrix;
+    tiling.steps       = steps_buffer;
+    tiling.score_table = score_table.data();
+    tiling.sequence_1  = sequences_vector[0].data();
+    tiling.sequence_2  = sequences_vector[1].data();
+    tiling.width       = width;
+    tiling.height      = height;
+    tiling.gap_penalty = gap_penalty;
+    tiling.limit_obj   = (time_limit > 0) ? this : NULL;
+
+    scheduler_obj->fill_in_tiles(&tiling, worker_index);
+    steps_count = (long)width * height;
+
+    if (tiling.stopped)
+    {
+        alignment_status = status_over_limit;
+    }
+
+}    // End PWA_alignment::fill_in_tiles().
+
+
 /*=======================================================================*/
 /* Method: PWA_alignment::get_max_score()                                */
 /*-----------------------------------------------------------------------*/
@@ -224,7 +678,7 @@ void PWA_alignment::get_max_score(int i, int j)
 /* Method: PWA_alignment::get_step_direction()                           */
 /*-----------------------------------------------------------------------*/
 /* Determines which direction the max_score was chosen from. Pushes      */
-/* the direction to steps_vector for algorithm traceback later.          */
+/* the direction to steps_buffer for algorithm traceback later.          */
 /* Currently, the program does not keep track of all possible            */
 /* directions that max_score came from.                                  */
 /*=======================================================================*/
@@ -232,15 +686,15 @@ void PWA_alignment::get_step_direction(int left_score, int up_score)
 {
     if (max_score == diagonal_score)
     {
-        steps_vector.push_back('D');
+        steps_buffer[steps_count++] = 'D';
     }
     else if (max_score == left_score)
     {
-        steps_vector.push_back('L');
+        steps_buffer[steps_count++] = 'L';
     }
     else if (max_score == up_score)
     {
-        steps_vector.push_back('U');
+        steps_buffer[steps_count++] = 'U';
     }
 
 }   // End PWA_alignment::get_step_direction().
@@ -250,7 +704,7 @@ void PWA_alignment::get_step_direction(int left_score, int up_score)
 /* Method: PWA_alignment::trace_back_steps()                             */
 /*-----------------------------------------------------------------------*/
 /* Performs traceback of steps from where the score in the matrix        */
-/* position was calculated. Traces back from the end of steps_vector,    */
+/* position was calculated. Traces back from the end of steps_buffer,    */
 /* indicating the last (right-most and bottom-most) position in the      */
 /* matrix.                                                               */
 /*                                                                       */
@@ -293,19 +747,18 @@ void PWA_alignment::trace_back_steps(void)
     string::reverse_iterator iterator_1 = sequences_vector[0].rbegin();
     string::reverse_iterator iterator_2 = sequences_vector[1].rbegin();
 
-    for (vector<char>::reverse_iterator it = steps_vector.rbegin();
-         it != steps_vector.rend()-1; ++it)
+    for (long it = steps_count - 1; it > 0; --it)
     {
-        if (*it == 'U')
+        if (steps_buffer[it] == 'U')
         {
             sequence_1 = "-" + sequence_1;
             sequence_2 = *iterator_2 + sequence_2;
             alignments = " " + alignments;
 
-            it+=width-1;
+            it-=width-1;
             ++iterator_2;
         }
-        else if (*it == 'D')
+        else if (steps_buffer[it] == 'D')
         {
             sequence_1 = *iterator_1 + sequence_1;
             sequence_2 = *iterator_2 + sequence_2;
@@ -319,14 +772,14 @@ void PWA_alignment::trace_back_steps(void)
                 alignments = " " + alignments;
             }
 
-            it+=width;
+            it-=width;
             number_aligned+=1;
             ++iterator_1;
             ++iterator_2;
         }
-        else if (*it == 'L')
+        else if (steps_buffer[it] == 'L')
         {
-            // Increment normally.
+            // Decrement normally.
             sequence_2 = "-" + sequence_2;
             sequence_1 = *iterator_1 + sequence_1;
             alignments = " " + alignments;
@@ -350,7 +803,7 @@ void PWA_alignment::trace_back_steps(void)
 /*     Match (no scoring matrix specified): +1                           */
 /*     Mismatch (no scoring matrix specified): -1                        */
 /*     Match = Mismatch (score dependent on scoring matrix specified)    */
-/*     Gaps: -2                                                          */
+/*     Gaps: gap_penalty (-2 unless set with set_gap_penalty())          */
 /*=======================================================================*/
 void PWA_alignment::compute_alignment_score(void)
 {
@@ -388,3 +841,329 @@ void PWA_alignment::compute_alignment_score(void)
 
 }   // End PWA_alignment::compute_alignment_score().
 
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::get_gap_penalty()                              */
+/*-----------------------------------------------------------------------*/
+/* Returns the gap penalty used by this alignment.                       */
+/*=======================================================================*/
+int PWA_alignment::get_gap_penalty(void)
+{
+    return (gap_penalty);
+
+}   // End PWA_alignment::get_gap_penalty().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::set_gap_penalty()                              */
+/*-----------------------------------------------------------------------*/
+/* Sets the score of each gap character, -2 by default. A penalty is     */
+/* negative; all engines read it through get_gap_penalty().              */
+/*=======================================================================*/
+void PWA_alignment::set_gap_penalty(int penalty)
+{
+    gap_penalty = penalty;
+
+}   // End PWA_alignment::set_gap_penalty().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::get_scoring_scheme()                           */
+/*-----------------------------------------------------------------------*/
+/* Returns a text description of everything that affects the alignment   */
+/* besides the sequences: whether a scoring matrix is used, every pair   */
+/* score in scoring_map, and the gap penalty. Two alignments with equal  */
+/* descriptions score every pair of sequences identically.               */
+/*=======================================================================*/
+string PWA_alignment::get_scoring_scheme(void)
+{
+    ostringstream scheme;
+
+    scheme << "scoring=" << scoring_specified;
+    scheme << " gap=" << gap_penalty;
+
+    if (scoring_specified == 1)
+    {
+        for (map<string, int>::const_iterator it = scoring_map.begin();
+             it != scoring_map.end(); ++it)
+        {
+            scheme << " " << it->first << "=" << it->second;
+        }
+    }
+
+    return (scheme.str());
+
+}   // End PWA_alignment::get_scoring_scheme().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::get_cigar_string()                             */
+/*-----------------------------------------------------------------------*/
+/* Returns the finished alignment in compact run-length form, e.g.       */
+/* "12M2I30M1D4M":                                                       */
+/*     M: a character from each sequence (match or mismatch)             */
+/*     I: a gap in sequence 1 (character taken from sequence 2)          */
+/*     D: a gap in sequence 2 (character taken from sequence 1)          */
+/* Must be called after trace_back_steps().                              */
+/*=======================================================================*/
+string PWA_alignment::get_cigar_string(void)
+{
+    ostringstream cigar;
+    char last_op = '\0';
+    int  count   = 0;
+
+    for (size_t i = 0; i < sequences_vector[0].length(); i++)
+    {
+        char op = 'M';
+
+        if (sequences_vector[0][i] == '-')
+        {
+            op = 'I';
+        }
+        else if (sequences_vector[2][i] == '-')
+        {
+            op = 'D';
+        }
+
+        if ((op != last_op) && (count > 0))
+        {
+            cigar << count << last_op;
+            count = 0;
+        }
+        last_op = op;
+        count++;
+    }
+
+    if (count > 0)
+    {
+        cigar << count << last_op;
+    }
+
+    return (cigar.str());
+
+}   // End PWA_alignment::get_cigar_string().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::apply_cigar_string()                           */
+/*-----------------------------------------------------------------------*/
+/* Rebuilds the output strings from the two original sequences in        */
+/* sequences_vector and a cigar string returned by get_cigar_string(),   */
+/* exactly as trace_back_steps() would have left them. Also counts       */
+/* number_aligned; alignment_score is left to the caller. A step without */
+/* a count stands for a single step, so the engines can also pass their  */
+/* plain step strings (e.g. "MMDMI").                                    */
+/*=======================================================================*/
+void PWA_alignment::apply_cigar_string(const string &cigar)
+{
+    string sequence_1 = "";
+    string sequence_2 = "";
+    string alignments = "";
+
+    size_t position_1 = 0;
+    size_t position_2 = 0;
+    int    count      = 0;
+
+    for (size_t i = 0; i < cigar.length(); i++)
+    {
+        if (isdigit(cigar[i]))
+        {
+            count = (count * 10) + (cigar[i] - '0');
+            continue;
+        }
+        if (count == 0)
+        {
+            count = 1;
+        }
+
+        for (int k = 0; k < count; k++)
+        {
+            if (cigar[i] == 'I')
+            {
+                sequence_1 += '-';
+                sequence_2 += sequences_vector[1][position_2++];
+                alignments += ' ';
+            }
+            else if (cigar[i] == 'D')
+            {
+                sequence_1 += sequences_vector[0][position_1++];
+                sequence_2 += '-';
+                alignments += ' ';
+            }
+            else
+            {
+                char char_1 = sequences_vector[0][position_1++];
+                char char_2 = sequences_vector[1][position_2++];
+
+                sequence_1 += char_1;
+                sequence_2 += char_2;
+                alignments += (char_1 == char_2) ? '|' : ' ';
+                number_aligned+=1;
+            }
+        }
+        count = 0;
+    }
+
+    sequences_vector.clear();
+    sequences_vector.push_back(sequence_1);
+    sequences_vector.push_back(alignments);
+    sequences_vector.push_back(sequence_2);
+
+}   // End PWA_alignment::apply_cigar_string().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::build_score_table()                            */
+/*-----------------------------------------------------------------------*/
+/* Builds score_table, a 256 x 256 table holding the substitution score  */
+/* of every pair of characters, indexed by                               */
+/*     (char from sequence 1 << 8) | char from sequence 2                */
+/* The table gives exactly the scores get_max_score() computes from      */
+/* scoring_map (or +1/-1 without a scoring matrix), but without building */
+/* a string and searching the map for every cell. The alternative        */
+/* engines read their substitution scores from it.                       */
+/*=======================================================================*/
+void PWA_alignment::build_score_table(void)
+{
+    score_table.assign(256 * 256, 0);
+
+    for (int char_1 = 0; char_1 < 256; char_1++)
+    {
+        for (int char_2 = 0; char_2 < 256; char_2++)
+        {
+            int score = 0;
+
+            if (scoring_specified == 1)
+            {
+                string amino_pair = "";
+                amino_pair.push_back(toupper(char_1));
+                amino_pair.push_back(toupper(char_2));
+
+                map<string, int>::const_iterator it =
+                    scoring_map.find(amino_pair);
+                if (it != scoring_map.end())
+                {
+                    score = it->second;
+                }
+            }
+            else
+            {
+                score = (char_1 == char_2) ? 1 : -1;
+            }
+
+            score_table[(char_1 << 8) | char_2] = score;
+        }
+    }
+
+}   // End PWA_alignment::build_score_table().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::can_reach_min_score()                          */
+/*-----------------------------------------------------------------------*/
+/* Returns 0 if no alignment through row, a completed matrix row of      */
+/* columns + 1 scores with rows_left rows still below it, can score      */
+/* min_score or more. Every alignment passes through every row, so the   */
+/* best final score is at most the best bound over the row's cells.      */
+/*=======================================================================*/
+bool PWA_alignment::can_reach_min_score(const int *row, int columns,
+                                        int rows_left)
+{
+    for (int j = 0; j <= columns; j++)
+    {
+        if (get_score_bound(row[j], rows_left, columns - j) >= min_score)
+        {
+            return (1);
+        }
+    }
+
+    return (0);
+
+}   // End PWA_alignment::can_reach_min_score().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::exceeds_time_limit()                           */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if a time_limit is set and the alignment has run past it.   */
+/* Safe to call from any thread while the alignment runs.                */
+/*=======================================================================*/
+bool PWA_alignment::exceeds_time_limit(void)
+{
+    return ((time_limit > 0) && (chrono::steady_clock::now() > deadline));
+
+}   // End PWA_alignment::exceeds_time_limit().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::get_score_bound()                              */
+/*-----------------------------------------------------------------------*/
+/* Returns the highest final score an alignment could reach from a cell  */
+/* with the given score and rows and columns left. The rest of the       */
+/* alignment has d diagonal steps, each worth at most                    */
+/* best_substitution_score, and rows_left + columns_left - 2d gaps, so   */
+/* it scores at most                                                     */
+/*     (rows_left + columns_left) * gap_penalty                          */
+/*         + d * (best_substitution_score - 2 * gap_penalty)             */
+/* with d as large as possible (min of rows and columns left) if the     */
+/* second term is positive, and 0 otherwise.                             */
+/*=======================================================================*/
+long PWA_alignment::get_score_bound(long score, long rows_left,
+                                    long columns_left)
+{
+    long gain = best_substitution_score - (2L * gap_penalty);
+
+    score += (rows_left + columns_left) * gap_penalty;
+    if (gain > 0)
+    {
+        score += min(rows_left, columns_left) * gain;
+    }
+
+    return (score);
+
+}   // End PWA_alignment::get_score_bound().
+
+
+/*=======================================================================*/
+/* Method: PWA_alignment::set_best_substitution_score()                  */
+/*-----------------------------------------------------------------------*/
+/* Sets best_substitution_score to the highest score_table entry for a   */
+/* character of sequence 1 against a character of sequence 2, which is   */
+/* much tighter than the best entry of the whole table.                  */
+/*=======================================================================*/
+void PWA_alignment::set_best_substitution_score(void)
+{
+    bool in_1[256] = {0};
+    bool in_2[256] = {0};
+
+    if (score_table.empty())
+    {
+        build_score_table();
+    }
+
+    for (size_t k = 0; k < sequences_vector[0].length(); k++)
+    {
+        in_1[(unsigned char)sequences_vector[0][k]] = 1;
+    }
+    for (size_t k = 0; k < sequences_vector[1].length(); k++)
+    {
+        in_2[(unsigned char)sequences_vector[1][k]] = 1;
+    }
+
+    // With an empty sequence there are no diagonal steps at all.
+    best_substitution_score = INT_MIN;
+    for (int char_1 = 0; char_1 < 256; char_1++)
+    {
+        for (int char_2 = 0; char_2 < 256; char_2++)
+        {
+            if (in_1[char_1] && in_2[char_2])
+            {
+                best_substitution_score =
+                    max(best_substitution_score,
+                        score_table[(char_1 << 8) | char_2]);
+            }
+        }
+    }
+
+}   // End PWA_alignment::set_best_substitution_score().
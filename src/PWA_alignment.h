@@ -1,42 +1,104 @@
 #ifndef PWA_ALIGNMENT_H
 #define PWA_ALIGNMENT_H
 
+#include "PWA_arena.h"
 #include "PWA_message.h"
 
+#include <chrono>
 #include <map>
 #include <string>
 #include <vector>
 
 using namespace std;
 
+class PWA_cache;
+class PWA_diagonal;
+class PWA_planner;
+class PWA_profile;
+class PWA_scheduler;
+class PWA_store;
+
 class PWA_alignment
 {
 public:
     PWA_alignment();
     void begin_PWA_alignment(PWA_message *msg_obj);
+    void reset_alignment(void);
+    void copy_settings_from(PWA_alignment *PWA_obj);
+    int  get_gap_penalty(void);
+    void set_gap_penalty(int penalty);
+    string get_scoring_scheme(void);
+    string get_cigar_string(void);
+    void apply_cigar_string(const string &cigar);
+    void build_score_table(void);
+    bool can_reach_min_score(const int *row, int columns, int rows_left);
+    bool exceeds_time_limit(void);
 
     map<string, int> scoring_map;
+    vector<int>      score_table;  // 256 x 256, see build_score_table()
+    PWA_cache   *cache_obj;
+    PWA_planner *planner_obj;
+    PWA_diagonal *diagonal_obj;     // Pairs screened first if not NULL.
+    PWA_profile *profile_obj;   // Phases are profiled if not NULL.
+    PWA_scheduler *scheduler_obj;   // Large nw fills shared if not NULL.
+    int          worker_index;  // This object's worker in scheduler_obj
+    string       engine;    // nw, banded, linear, score, wfa, overlap,
+                            // diff or russians
+    int          band_width;
+    int          xdrop;     // Overlap engine pruning, 0 for none
+    bool         both_strands;  // Also try the reverse complement.
+    string       traceback_filename;    // nw steps on disk, "" for RAM
 
     vector<string> names_vector;
     vector<string> sequences_vector;
+    PWA_store *store_obj;       // Where the sequences were loaded from,
+    long store_records[2];      // and their records; NULL if not.
     bool scoring_specified;
     int alignment_score;
     int number_aligned;
+    bool score_only;        // No alignment strings, only the score.
+    bool min_score_specified;
+    int  min_score;         // Pairs that cannot reach it are abandoned.
+    double time_limit;      // Seconds per alignment, 0 for none.
+    long   cell_limit;      // Matrix cells per alignment, 0 for none.
+    bool   limit_fallback;  // Over a limit: banded (1) or give up (0).
+    int  alignment_status;  // One of the status values below.
+    char strand;            // '-' if sequence 2 was reverse complemented
+
+    static const int status_complete        = 0;
+    static const int status_below_min_score = 1;
+    static const int status_over_limit      = 2;
+    static const int status_banded_fallback = 3;
+    static const int status_filtered        = 4;
 
 private:
+    friend class PWA_incremental;
+    friend class PWA_interleave;
+
+    void align_phases(PWA_message *msg_obj);
+    void begin_profile_phase(const string &name);
+    void end_profile_phase(void);
     void resize_alignment_matrix(void);
     void fill_alignment_matrix(void);
+    void fill_in_tiles(void);
     void get_max_score(int i, int j);
     void get_step_direction(int left_score, int up_score);
     void trace_back_steps(void);
     void compute_alignment_score(void);
+    void set_best_substitution_score(void);
+    long get_score_bound(long score, long rows_left, long columns_left);
 
-    vector<vector<int> >alignment_matrix;
-    vector<char> steps_vector;
+    // Both in arena_obj, which is reused by the next alignment.
+    PWA_arena arena_obj;
+    int  **alignment_matrix;    // Row pointers into one flat matrix.
+    char  *steps_buffer;        // D, L or U for each cell, row by row.
+    long   steps_count;
 
     int diagonal_score;
     int gap_penalty;
     int max_score;
+    int best_substitution_score;
+    chrono::steady_clock::time_point deadline;  // With time_limit.
     int width, height;
 
 };  // PWA_alignment
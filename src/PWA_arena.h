@@ -0,0 +1,37 @@
+#ifndef PWA_ARENA_H
+#define PWA_ARENA_H
+
+#include <stddef.h>
+
+using namespace std;
+
+class PWA_arena
+{
+public:
+    PWA_arena();
+    ~PWA_arena();
+    bool  reserve(size_t bytes);
+    void *allocate(size_t bytes);
+    void  reset(void);
+
+    size_t get_capacity(void);
+    bool   uses_huge_pages(void);
+
+    // Mappings are rounded up to this, the usual huge page size.
+    static const size_t huge_page_bytes = 2UL << 20;
+
+private:
+    // An arena owns its mapping and cannot be copied.
+    PWA_arena(const PWA_arena &);
+    PWA_arena &operator=(const PWA_arena &);
+
+    void release(void);
+
+    char  *memory;
+    size_t capacity;
+    size_t used;
+    bool   huge_pages;      // Explicit huge pages (MAP_HUGETLB).
+
+};  // PWA_arena
+
+#endif  // PWA_ARENA_H
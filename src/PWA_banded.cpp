@@ -0,0 +1,231 @@
+/*=======================================================================*/
+/* Filename: PWA_banded.cpp                                              */
+/*=======================================================================*/
+/* Banded alignment engine. Only the cells within band_width columns of  */
+/* the straight line from the top-left to the bottom-right corner of     */
+/* the matrix are computed and stored, so time and memory grow with the  */
+/* sequence length times the band width. The result is the best          */
+/* alignment that stays inside the band, which is the optimal alignment  */
+/* whenever the sequences are similar enough for it to fit.              */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_banded.h"
+
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Score of cells outside the band.
+static const int outside_band = INT_MIN / 4;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_banded                                               */
+/*-----------------------------------------------------------------------*/
+/* Initializes an empty banded engine.                                   */
+/*=======================================================================*/
+PWA_banded::PWA_banded()
+{
+    score_table = NULL;
+    gap_penalty = -2;
+    final_score = 0;
+
+}   // End PWA_banded::PWA_banded().
+
+
+/*=======================================================================*/
+/* Method: PWA_banded::begin_banded_alignment()                          */
+/*-----------------------------------------------------------------------*/
+/* Aligns the two sequences of PWA_obj within a band of                  */
+/* PWA_obj->band_width (default_band_width if not set) and stores the    */
+/* alignment and score in PWA_obj.                                       */
+/*=======================================================================*/
+void PWA_banded::begin_banded_alignment(PWA_alignment *PWA_obj)
+{
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    sequence_1  = PWA_obj->sequences_vector[0];
+    sequence_2  = PWA_obj->sequences_vector[1];
+    score_table = PWA_obj->score_table.data();
+    gap_penalty = PWA_obj->get_gap_penalty();
+
+    if (PWA_obj->band_width > 0)
+    {
+        set_band_limits(PWA_obj->band_width);
+    }
+    else
+    {
+        set_band_limits(default_band_width);
+    }
+
+    fill_band();
+
+    PWA_obj->apply_cigar_string(trace_back_band());
+    PWA_obj->alignment_score = final_score;
+
+}   // End PWA_banded::begin_banded_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_banded::set_band_limits()                                 */
+/*-----------------------------------------------------------------------*/
+/* Sets the first and last column of the band in each row. The band is   */
+/* centred on the line from (0, 0) to (rows, columns). Each row starts   */
+/* no later than the previous row ends, so the band always contains a   */
+/* path from the first cell to the last.                                 */
+/*=======================================================================*/
+void PWA_banded::set_band_limits(int band_width)
+{
+    long columns = sequence_1.length();
+    long rows    = sequence_2.length();
+    long offset  = 0;
+
+    first_column.resize(rows + 1);
+    last_column.resize(rows + 1);
+    row_offset.resize(rows + 1);
+
+    for (long i = 0; i <= rows; i++)
+    {
+        long centre = (rows > 0) ? ((i * columns) + (rows / 2)) / rows : 0;
+
+        first_column[i] = max(0L, centre - band_width);
+        last_column[i]  = min(columns, centre + band_width);
+
+        if (i > 0)
+        {
+            first_column[i] = min((long)first_column[i],
+                                  (long)last_column[i-1]);
+        }
+    }
+    first_column[0]   = 0;
+    last_column[rows] = columns;
+
+    for (long i = 0; i <= rows; i++)
+    {
+        row_offset[i] = offset;
+        offset += last_column[i] - first_column[i] + 1;
+    }
+    steps.resize(offset);
+
+}   // End PWA_banded::set_band_limits().
+
+
+/*=======================================================================*/
+/* Method: PWA_banded::fill_band()                                       */
+/*-----------------------------------------------------------------------*/
+/* Computes the scores and step directions of all cells in the band,     */
+/* one row at a time. Directions are chosen in the same order as         */
+/* get_step_direction(): diagonal, left, then up.                        */
+/*=======================================================================*/
+void PWA_banded::fill_band(void)
+{
+    int columns = sequence_1.length();
+    int rows    = sequence_2.length();
+
+    vector<int> previous_row(columns + 1, outside_band);
+    vector<int> current_row(columns + 1, outside_band);
+
+    for (int j = first_column[0]; j <= last_column[0]; j++)
+    {
+        previous_row[j] = j * gap_penalty;
+        steps[row_offset[0] + j] = 'L';
+    }
+
+    for (int i = 1; i <= rows; i++)
+    {
+        int char_2 = (unsigned char)sequence_2[i-1];
+        int lo     = first_column[i];
+        int hi     = last_column[i];
+        int up_lo  = first_column[i-1];
+        int up_hi  = last_column[i-1];
+        char *row_steps = &steps[row_offset[i] - lo];
+
+        for (int j = lo; j <= hi; j++)
+        {
+            int diagonal = outside_band;
+            int left     = outside_band;
+            int up       = outside_band;
+
+            if ((j > 0) && (j - 1 >= up_lo) && (j - 1 <= up_hi))
+            {
+                int char_1 = (unsigned char)sequence_1[j-1];
+                diagonal   = previous_row[j-1] +
+                             score_table[(char_1 << 8) | char_2];
+            }
+            if (j > lo)
+            {
+                left = current_row[j-1] + gap_penalty;
+            }
+            if ((j >= up_lo) && (j <= up_hi))
+            {
+                up = previous_row[j] + gap_penalty;
+            }
+
+            int best = max(max(diagonal, left), up);
+            current_row[j] = best;
+
+            if ((j > 0) && (best == diagonal))
+            {
+                row_steps[j] = 'D';
+            }
+            else if ((j > lo) && (best == left))
+            {
+                row_steps[j] = 'L';
+            }
+            else
+            {
+                row_steps[j] = 'U';
+            }
+        }
+
+        previous_row.swap(current_row);
+    }
+
+    final_score = previous_row[columns];
+
+}   // End PWA_banded::fill_band().
+
+
+/*=======================================================================*/
+/* Method: PWA_banded::trace_back_band()                                 */
+/*-----------------------------------------------------------------------*/
+/* Traces back from the last cell and returns the alignment as a string  */
+/* of steps for apply_cigar_string().                                    */
+/*=======================================================================*/
+string PWA_banded::trace_back_band(void)
+{
+    string reversed_steps = "";
+    int i = sequence_2.length();
+    int j = sequence_1.length();
+
+    while ((i > 0) || (j > 0))
+    {
+        char direction = steps[row_offset[i] + j - first_column[i]];
+
+        if (direction == 'D')
+        {
+            reversed_steps.push_back('M');
+            i--;
+            j--;
+        }
+        else if (direction == 'L')
+        {
+            reversed_steps.push_back('D');
+            j--;
+        }
+        else
+        {
+            reversed_steps.push_back('I');
+            i--;
+        }
+    }
+
+    return (string(reversed_steps.rbegin(), reversed_steps.rend()));
+
+}   // End PWA_banded::trace_back_band().
@@ -0,0 +1,37 @@
+#ifndef PWA_BANDED_H
+#define PWA_BANDED_H
+
+#include "PWA_alignment.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_banded
+{
+public:
+    PWA_banded();
+    void begin_banded_alignment(PWA_alignment *PWA_obj);
+
+    static const int default_band_width = 100;
+
+private:
+    void set_band_limits(int band_width);
+    void fill_band(void);
+    string trace_back_band(void);
+
+    string       sequence_1;    // Columns of the matrix.
+    string       sequence_2;    // Rows of the matrix.
+    const int   *score_table;
+    int          gap_penalty;
+    int          final_score;
+
+    vector<int>  first_column;  // First column in the band, per row.
+    vector<int>  last_column;   // Last column in the band, per row.
+    vector<long> row_offset;    // Start of each row in steps.
+    vector<char> steps;         // D, L or U for each cell in the band.
+
+};  // PWA_banded
+
+#endif  // PWA_BANDED_H
@@ -0,0 +1,598 @@
+/*=======================================================================*/
+/* Filename: PWA_benchmark.cpp                                           */
+/*=======================================================================*/
+/* Performance regression check (--benchmark FILE). A fixed corpus of    */
+/* nucleotide and protein pairs (short, medium and long) is generated    */
+/* from a fixed seed, so it is the same on every machine and needs no    */
+/* data files. Every engine that applies aligns every pair; the best     */
+/* wall time of a few repetitions, the GCUPS (billions of matrix cells   */
+/* per second) and the peak resident memory are recorded.                */
+/*                                                                       */
+/* Each engine runs in a child process, so the peak memory reported by   */
+/* wait4() belongs to that engine alone and a crash cannot take the      */
+/* rest of the run with it.                                              */
+/*                                                                       */
+/* The results are compared with a baseline file written earlier with    */
+/* --update-baseline: a run slower or larger than the baseline by more   */
+/* than the tolerances, or with a different score, is a regression.      */
+/* Independently, every exact engine must give the nw score on every     */
+/* pair, so a fast path cannot drift from the reference engine, and the  */
+/* diagonal filter must not reject any related pair of the corpus that   */
+/* nw scores at or above its threshold.                                  */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_benchmark.h"
+#include "PWA_diagonal.h"
+
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// Engines measured on each kind of pair. wfa and russians only apply
+// to +1/-1 scoring, and overlap answers a different question.
+static const char *nucleotide_engines[] =
+    {"nw", "banded", "linear", "score", "wfa", "diff", "russians"};
+static const char *protein_engines[] =
+    {"nw", "banded", "linear", "score", "diff"};
+
+static const string nucleotides = "ACGT";
+static const string amino_acids = "ARNDCQEGHILKMFPSTWYV";
+
+
+/*=======================================================================*/
+/* Constructor: PWA_benchmark                                            */
+/*-----------------------------------------------------------------------*/
+/* Initializes a benchmark with 3 repetitions, a 20% time tolerance and  */
+/* a 10% memory tolerance. Time differences below 2 ms are ignored. The  */
+/* diagonal filter is checked at a threshold of 20.                      */
+/*=======================================================================*/
+PWA_benchmark::PWA_benchmark()
+{
+    repetitions      = 3;
+    time_tolerance   = 0.20;
+    memory_tolerance = 0.10;
+    min_seconds      = 0.002;
+    filter_keep_score = 20;
+    random_state     = 20171127;
+
+}   // End PWA_benchmark::PWA_benchmark().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::build_corpus()                                 */
+/*-----------------------------------------------------------------------*/
+/* Generates the corpus: for nucleotides and proteins, a short, medium   */
+/* and long random sequence, each paired with a mutated copy of itself.  */
+/*=======================================================================*/
+void PWA_benchmark::build_corpus(void)
+{
+    const char *names[]         = {"short", "medium", "long"};
+    int nucleotide_lengths[]    = {200, 2000, 6000};
+    int protein_lengths[]       = {100, 600, 2000};
+
+    corpus.clear();
+
+    for (int protein = 0; protein < 2; protein++)
+    {
+        const string &alphabet = protein ? amino_acids : nucleotides;
+
+        for (int size = 0; size < 3; size++)
+        {
+            PWA_benchmark_case pair;
+            pair.name       = string(protein ? "protein_" : "nucleotide_") +
+                              names[size];
+            pair.protein    = protein;
+            pair.sequence_1 = make_sequence(alphabet, protein ?
+                                            protein_lengths[size] :
+                                            nucleotide_lengths[size]);
+            pair.sequence_2 = mutate_sequence(pair.sequence_1, alphabet);
+            corpus.push_back(pair);
+        }
+    }
+
+}   // End PWA_benchmark::build_corpus().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::run_benchmark()                                */
+/*-----------------------------------------------------------------------*/
+/* Measures every engine on every pair of the corpus, aligning with the  */
+/* scoring scheme of nucleotide_obj or protein_obj.                      */
+/*=======================================================================*/
+void PWA_benchmark::run_benchmark(PWA_alignment *nucleotide_obj,
+                                  PWA_alignment *protein_obj)
+{
+    results.clear();
+
+    for (size_t c = 0; c < corpus.size(); c++)
+    {
+        const char **engines = corpus[c].protein ? protein_engines
+                                                 : nucleotide_engines;
+        int number_of_engines = corpus[c].protein ?
+            sizeof(protein_engines) / sizeof(protein_engines[0]) :
+            sizeof(nucleotide_engines) / sizeof(nucleotide_engines[0]);
+
+        for (int e = 0; e < number_of_engines; e++)
+        {
+            PWA_measurement result;
+            measure(corpus[c], engines[e],
+                    corpus[c].protein ? protein_obj : nucleotide_obj,
+                    result);
+            results.push_back(result);
+        }
+    }
+
+}   // End PWA_benchmark::run_benchmark().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::measure()                                      */
+/*-----------------------------------------------------------------------*/
+/* Aligns pair repetitions times with engine in a child process and      */
+/* stores the score, best time, GCUPS and peak memory in result. The     */
+/* child reports its score and time through a pipe; a child that fails   */
+/* is recorded with a score of INT_MIN and status "failed".              */
+/*=======================================================================*/
+void PWA_benchmark::measure(const PWA_benchmark_case &pair,
+                            const string &engine,
+                            PWA_alignment *template_obj,
+                            PWA_measurement &result)
+{
+    int    pipe_fds[2];
+    double cells = (double)pair.sequence_1.length() *
+                   pair.sequence_2.length();
+
+    result.case_name = pair.name;
+    result.engine    = engine;
+    result.score     = INT_MIN;
+    result.seconds   = 0;
+    result.gcups     = 0;
+    result.peak_kb   = 0;
+    result.status    = "";
+
+    // Nothing buffered may be written twice by the child.
+    cout.flush();
+
+    if (pipe(pipe_fds) != 0)
+    {
+        result.status = "failed";
+        return;
+    }
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        PWA_alignment align_obj;
+        align_obj.copy_settings_from(template_obj);
+        align_obj.engine = engine;
+
+        double best = -1;
+        for (int r = 0; r < repetitions; r++)
+        {
+            align_obj.reset_alignment();
+            align_obj.names_vector.push_back(pair.name + "_1");
+            align_obj.names_vector.push_back(pair.name + "_2");
+            align_obj.sequences_vector.push_back(pair.sequence_1);
+            align_obj.sequences_vector.push_back(pair.sequence_2);
+
+            chrono::steady_clock::time_point start =
+                chrono::steady_clock::now();
+            align_obj.begin_PWA_alignment(NULL);
+            double seconds = chrono::duration<double>(
+                                 chrono::steady_clock::now() - start).count();
+
+            if ((best < 0) || (seconds < best))
+            {
+                best = seconds;
+            }
+        }
+
+        ostringstream message;
+        message << align_obj.alignment_score << " " << setprecision(9)
+                << best << endl;
+        string text = message.str();
+        ssize_t written = write(pipe_fds[1], text.data(), text.length());
+        _exit(written == (ssize_t)text.length() ? 0 : 1);
+    }
+
+    close(pipe_fds[1]);
+
+    string text = "";
+    char   buffer[256];
+    ssize_t count = 0;
+    while ((child > 0) &&
+           ((count = read(pipe_fds[0], buffer, sizeof(buffer))) > 0))
+    {
+        text.append(buffer, count);
+    }
+    close(pipe_fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    if ((child < 0) || (wait4(child, &status, 0, &usage) != child) ||
+        !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+    {
+        result.status = "failed";
+        return;
+    }
+
+    istringstream message(text);
+    message >> result.score >> result.seconds;
+    result.peak_kb = usage.ru_maxrss;
+    result.gcups   = (result.seconds > 0) ? cells / result.seconds / 1e9 : 0;
+
+}   // End PWA_benchmark::measure().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::check_scores()                                 */
+/*-----------------------------------------------------------------------*/
+/* Marks every exact engine whose score differs from that of nw on the   */
+/* same pair and returns how many do. The banded engine is only exact    */
+/* when the alignment stays in its band, so it is not checked.           */
+/*=======================================================================*/
+int PWA_benchmark::check_scores(void)
+{
+    int mismatches = 0;
+
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        PWA_measurement &result = results[r];
+        if ((result.engine == "nw") || (result.engine == "banded") ||
+            (result.status == "failed"))
+        {
+            continue;
+        }
+
+        for (size_t n = 0; n < results.size(); n++)
+        {
+            if ((results[n].case_name == result.case_name) &&
+                (results[n].engine == "nw") &&
+                (results[n].score != result.score))
+            {
+                ostringstream status;
+                status << "score differs from nw (" << results[n].score
+                       << ")";
+                result.status = status.str();
+                mismatches++;
+            }
+        }
+    }
+
+    return (mismatches);
+
+}   // End PWA_benchmark::check_scores().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::check_diagonal_filter()                        */
+/*-----------------------------------------------------------------------*/
+/* Screens the first sequence of every nucleotide case against copies    */
+/* mutated once, twice and three times (about 8% to 24% substitutions    */
+/* and 4% to 12% indels) and against an unrelated sequence, with the     */
+/* diagonal filter at filter_keep_score, and aligns each with nw. A pair */
+/* that is rejected although nw scores it at least filter_keep_score is  */
+/* a failure; returns how many there are.                                */
+/*=======================================================================*/
+int PWA_benchmark::check_diagonal_filter(PWA_alignment *nucleotide_obj)
+{
+    const char  *names[] = {"related", "diverged", "distant", "unrelated"};
+    PWA_diagonal diagonal_obj;
+
+    diagonal_obj.min_diagonal_score = filter_keep_score;
+    filter_failures.clear();
+
+    for (size_t c = 0; c < corpus.size(); c++)
+    {
+        if (corpus[c].protein)
+        {
+            continue;
+        }
+
+        string variant = corpus[c].sequence_1;
+
+        for (int v = 0; v < 4; v++)
+        {
+            variant = (v < 3) ? mutate_sequence(variant, nucleotides)
+                              : make_sequence(nucleotides,
+                                              corpus[c].sequence_1.length());
+
+            PWA_alignment align_obj;
+            align_obj.copy_settings_from(nucleotide_obj);
+            align_obj.engine = "nw";
+            align_obj.sequences_vector.push_back(corpus[c].sequence_1);
+            align_obj.sequences_vector.push_back(variant);
+
+            PWA_alignment screen_obj;
+            screen_obj.copy_settings_from(&align_obj);
+            screen_obj.sequences_vector = align_obj.sequences_vector;
+
+            bool rejected = diagonal_obj.screen_pair(&screen_obj) &&
+                            (screen_obj.alignment_status ==
+                             PWA_alignment::status_filtered);
+
+            align_obj.begin_PWA_alignment(NULL);
+
+            if (rejected && (align_obj.alignment_score >= filter_keep_score))
+            {
+                ostringstream failure;
+                failure << corpus[c].name << " " << names[v]
+                        << ": rejected, nw score "
+                        << align_obj.alignment_score;
+                filter_failures.push_back(failure.str());
+            }
+        }
+    }
+
+    return (filter_failures.size());
+
+}   // End PWA_benchmark::check_diagonal_filter().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::load_baseline()                                */
+/*-----------------------------------------------------------------------*/
+/* Reads a baseline file written by save_baseline(). Returns 0 if it     */
+/* cannot be opened.                                                     */
+/*=======================================================================*/
+bool PWA_benchmark::load_baseline(const string &filename)
+{
+    ifstream baseline_file(filename.c_str());
+    string   line = "";
+
+    if (!baseline_file.is_open())
+    {
+        return (0);
+    }
+
+    baseline.clear();
+    while (getline(baseline_file, line))
+    {
+        if (line.empty() || (line[0] == '#'))
+        {
+            continue;
+        }
+
+        PWA_measurement entry;
+        istringstream fields(line);
+        if (fields >> entry.case_name >> entry.engine >> entry.seconds >>
+                      entry.gcups >> entry.peak_kb >> entry.score)
+        {
+            baseline[entry.case_name + " " + entry.engine] = entry;
+        }
+    }
+
+    return (1);
+
+}   // End PWA_benchmark::load_baseline().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::compare_with_baseline()                        */
+/*-----------------------------------------------------------------------*/
+/* Sets the status of every result against the loaded baseline and       */
+/* returns the number of regressions: failed runs, runs slower than the  */
+/* baseline by more than time_tolerance (and min_seconds), runs using    */
+/* more memory than memory_tolerance allows, and changed scores. Runs    */
+/* missing from the baseline are reported as new.                        */
+/*=======================================================================*/
+int PWA_benchmark::compare_with_baseline(void)
+{
+    int regressions = 0;
+
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        PWA_measurement &result = results[r];
+        bool regressed = 0;
+
+        if (result.status == "failed")
+        {
+            regressions++;
+            continue;
+        }
+
+        map<string, PWA_measurement>::iterator it =
+            baseline.find(result.case_name + " " + result.engine);
+        if (it == baseline.end())
+        {
+            if (result.status.empty())
+            {
+                result.status = "new";
+            }
+            continue;
+        }
+
+        PWA_measurement &base = it->second;
+        ostringstream status;
+
+        if ((result.seconds > base.seconds * (1 + time_tolerance)) &&
+            (result.seconds - base.seconds > min_seconds))
+        {
+            status << "slower +" << fixed << setprecision(0)
+                   << 100 * (result.seconds / base.seconds - 1) << "% ";
+            regressed = 1;
+        }
+        if (result.peak_kb > base.peak_kb * (1 + memory_tolerance))
+        {
+            status << "memory +" << fixed << setprecision(0)
+                   << 100 * ((double)result.peak_kb / base.peak_kb - 1)
+                   << "% ";
+            regressed = 1;
+        }
+        if (result.score != base.score)
+        {
+            status << "score was " << base.score << " ";
+            regressed = 1;
+        }
+
+        // Score mismatches across engines were set first and stay.
+        if (!result.status.empty())
+        {
+            continue;
+        }
+
+        string reasons = status.str();
+        result.status  = regressed ? reasons.substr(0, reasons.length() - 1)
+                                   : "ok";
+        regressions  += regressed;
+    }
+
+    return (regressions);
+
+}   // End PWA_benchmark::compare_with_baseline().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::save_baseline()                                */
+/*-----------------------------------------------------------------------*/
+/* Writes the results as a baseline file, one case and engine per line.  */
+/* Returns 0 if the file cannot be written.                              */
+/*=======================================================================*/
+bool PWA_benchmark::save_baseline(const string &filename)
+{
+    ofstream baseline_file(filename.c_str(), ofstream::trunc);
+
+    if (!baseline_file.is_open())
+    {
+        return (0);
+    }
+
+    baseline_file << "# PWA benchmark baseline (pwa --benchmark FILE"
+                  << " --update-baseline)" << endl;
+    baseline_file << "# case engine seconds gcups peak_kb score" << endl;
+
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        PWA_measurement &result = results[r];
+        baseline_file << result.case_name << " " << result.engine << " "
+                      << fixed << setprecision(6) << result.seconds << " "
+                      << setprecision(4) << result.gcups << " "
+                      << result.peak_kb << " " << result.score << endl;
+    }
+
+    return (baseline_file.good());
+
+}   // End PWA_benchmark::save_baseline().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::get_report()                                   */
+/*-----------------------------------------------------------------------*/
+/* Returns a table of the results and their status, then the pairs the   */
+/* diagonal filter wrongly rejected.                                     */
+/*=======================================================================*/
+string PWA_benchmark::get_report(void)
+{
+    ostringstream report;
+
+    report << "Benchmark (best of " << repetitions << " runs):" << endl;
+    report << "  " << left << setw(19) << "Case" << setw(10) << "Engine"
+           << right << setw(11) << "Seconds" << setw(9) << "GCUPS"
+           << setw(10) << "Peak MB" << setw(9) << "Score" << "  "
+           << "Status" << endl;
+
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        PWA_measurement &result = results[r];
+
+        report << "  " << left << setw(19) << result.case_name
+               << setw(10) << result.engine << right
+               << setw(11) << fixed << setprecision(4) << result.seconds
+               << setw(9) << setprecision(3) << result.gcups
+               << setw(10) << setprecision(1) << result.peak_kb / 1024.0
+               << setw(9) << result.score << "  " << result.status << endl;
+    }
+
+    for (size_t f = 0; f < filter_failures.size(); f++)
+    {
+        report << "  Diagonal filter (" << filter_keep_score << "): "
+               << filter_failures[f] << endl;
+    }
+
+    return (report.str());
+
+}   // End PWA_benchmark::get_report().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::make_sequence()                                */
+/*-----------------------------------------------------------------------*/
+/* Returns a random sequence of length characters of alphabet.           */
+/*=======================================================================*/
+string PWA_benchmark::make_sequence(const string &alphabet, int length)
+{
+    string sequence = "";
+
+    for (int i = 0; i < length; i++)
+    {
+        sequence += alphabet[get_random() % alphabet.length()];
+    }
+
+    return (sequence);
+
+}   // End PWA_benchmark::make_sequence().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::mutate_sequence()                              */
+/*-----------------------------------------------------------------------*/
+/* Returns a copy of sequence with about 8% substitutions, 2% deletions  */
+/* and 2% insertions, like two related genes or proteins.                */
+/*=======================================================================*/
+string PWA_benchmark::mutate_sequence(const string &sequence,
+                                      const string &alphabet)
+{
+    string mutated = "";
+
+    for (size_t i = 0; i < sequence.length(); i++)
+    {
+        unsigned int roll = get_random() % 100;
+
+        if (roll < 8)
+        {
+            mutated += alphabet[get_random() % alphabet.length()];
+        }
+        else if (roll < 10)
+        {
+            continue;
+        }
+        else if (roll < 12)
+        {
+            mutated += sequence[i];
+            mutated += alphabet[get_random() % alphabet.length()];
+        }
+        else
+        {
+            mutated += sequence[i];
+        }
+    }
+
+    return (mutated);
+
+}   // End PWA_benchmark::mutate_sequence().
+
+
+/*=======================================================================*/
+/* Method: PWA_benchmark::get_random()                                   */
+/*-----------------------------------------------------------------------*/
+/* Returns the next number of a 64-bit linear congruential generator.    */
+/* rand() is not used, since its sequence differs between C libraries.   */
+/*=======================================================================*/
+unsigned int PWA_benchmark::get_random(void)
+{
+    random_state = (random_state * 6364136223846793005ULL) +
+                   1442695040888963407ULL;
+
+    return ((unsigned int)(random_state >> 33));
+
+}   // End PWA_benchmark::get_random().
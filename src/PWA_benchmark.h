@@ -0,0 +1,68 @@
+#ifndef PWA_BENCHMARK_H
+#define PWA_BENCHMARK_H
+
+#include "PWA_alignment.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// One pair of the fixed corpus.
+struct PWA_benchmark_case
+{
+    string name;
+    bool   protein;
+    string sequence_1;
+    string sequence_2;
+};
+
+// One engine on one case, measured or read from a baseline file.
+struct PWA_measurement
+{
+    string case_name;
+    string engine;
+    int    score;
+    double seconds;         // Best of the repetitions.
+    double gcups;           // Matrix cells per second, in billions.
+    long   peak_kb;         // Peak resident memory of the run.
+    string status;          // Comparison with the baseline.
+};
+
+class PWA_benchmark
+{
+public:
+    PWA_benchmark();
+    void   build_corpus(void);
+    void   run_benchmark(PWA_alignment *nucleotide_obj,
+                         PWA_alignment *protein_obj);
+    int    check_scores(void);
+    int    check_diagonal_filter(PWA_alignment *nucleotide_obj);
+    bool   load_baseline(const string &filename);
+    int    compare_with_baseline(void);
+    bool   save_baseline(const string &filename);
+    string get_report(void);
+
+    int    repetitions;
+    double time_tolerance;      // Allowed slowdown, as a fraction.
+    double memory_tolerance;    // Allowed memory growth, as a fraction.
+    double min_seconds;         // Time differences below this are noise.
+    int    filter_keep_score;   // nw score the diagonal filter must keep.
+
+private:
+    void measure(const PWA_benchmark_case &pair, const string &engine,
+                 PWA_alignment *template_obj, PWA_measurement &result);
+    string make_sequence(const string &alphabet, int length);
+    string mutate_sequence(const string &sequence, const string &alphabet);
+    unsigned int get_random(void);
+
+    vector<PWA_benchmark_case> corpus;
+    vector<PWA_measurement>    results;
+    vector<string>             filter_failures;
+    map<string, PWA_measurement> baseline;  // By "case engine".
+    unsigned long long random_state;
+
+};  // PWA_benchmark
+
+#endif  // PWA_BENCHMARK_H
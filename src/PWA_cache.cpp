@@ -0,0 +1,425 @@
+/*=======================================================================*/
+/* Filename: PWA_cache.cpp                                               */
+/*=======================================================================*/
+/* Persistent on-disk cache of alignment results. Each entry is keyed    */
+/* by a hash of both sequences, of the scoring scheme (scoring map and   */
+/* gap penalty) and of the engine with its settings, and stores the      */
+/* alignment score and the alignment as a compact cigar string. Reruns   */
+/* on unchanged pairs then skip fill_alignment_matrix() entirely.        */
+/*                                                                       */
+/* The sequences themselves are not stored. Instead each entry keeps     */
+/* their lengths and a second hash, computed independently of the key,   */
+/* and a hit must match both; a pair whose key merely collides with      */
+/* another's is computed like any other miss.                            */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_cache.h"
+#include "PWA_message.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// FNV-1a 64-bit parameters.
+static const unsigned long long fnv_offset_basis = 14695981039346656037ULL;
+static const unsigned long long fnv_prime        = 1099511628211ULL;
+
+// Multiplier of the check hash (the 64-bit golden ratio).
+static const unsigned long long check_multiplier = 0x9E3779B97F4A7C15ULL;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_cache                                                */
+/*-----------------------------------------------------------------------*/
+/* Initializes an empty cache with a default size cap of 256 MB.         */
+/*=======================================================================*/
+PWA_cache::PWA_cache()
+{
+    max_cache_bytes = 256L * 1024 * 1024;
+    cache_hits      = 0;
+    cache_misses    = 0;
+
+    cache_filename  = NULL;
+    scheme_hash     = fnv_offset_basis;
+    scheme_check_hash = 0;
+    generation      = 0;
+    cache_bytes     = 0;
+
+}   // End PWA_cache::PWA_cache().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::load_cache()                                       */
+/*-----------------------------------------------------------------------*/
+/* Reads all entries from the cache file, if it exists. A missing or     */
+/* unreadable cache file simply starts an empty cache. Each run gets a   */
+/* new generation number which is stamped on every entry it uses, so     */
+/* that the least recently used entries can be evicted first.            */
+/*=======================================================================*/
+void PWA_cache::load_cache(char *filename)
+{
+    fstream cache_file;
+    string  line   = "";
+    string  header = "";
+    int     version = 0;
+
+    cache_filename = filename;
+
+    cache_file.open(cache_filename, fstream::in);
+    if (cache_file.fail())
+    {
+        generation = 1;
+        return;
+    }
+
+    getline(cache_file, line);
+    istringstream header_ss(line);
+    header_ss >> header >> version >> generation;
+
+    if ((header != "PWA_CACHE") || (version != 3))
+    {
+        // Unknown format; start over rather than misreading it.
+        cache_file.close();
+        generation = 1;
+        return;
+    }
+    generation++;
+
+    while (getline(cache_file, line))
+    {
+        istringstream ss(line);
+        unsigned long long key = 0;
+        PWA_cache_entry entry;
+
+        if ((ss >> hex >> key >> entry.check_hash >> dec
+                >> entry.length_1 >> entry.length_2 >> entry.last_used
+                >> entry.alignment_score >> entry.number_aligned) &&
+            (entries.count(key) == 0))
+        {
+            ss >> entry.cigar;
+            entries[key] = entry;
+            cache_bytes += get_entry_bytes(entry);
+        }
+    }
+
+    cache_file.close();
+
+}   // End PWA_cache::load_cache().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::save_cache()                                       */
+/*-----------------------------------------------------------------------*/
+/* Evicts entries until the cache fits in max_cache_bytes, then writes   */
+/* the cache to a temporary file and renames it over the cache file, so  */
+/* an interrupted run never leaves a truncated cache behind. If it       */
+/* cannot be written, the old cache is kept and a warning printed.       */
+/*=======================================================================*/
+void PWA_cache::save_cache(PWA_message *msg_obj)
+{
+    fstream cache_file;
+    string  tmp_filename = "";
+
+    if (cache_filename == NULL)
+    {
+        return;
+    }
+
+    evict_entries();
+
+    tmp_filename = string(cache_filename) + ".tmp";
+    cache_file.open(tmp_filename.c_str(), fstream::out | fstream::trunc);
+    if (cache_file.fail())
+    {
+        msg_obj->print_cache_write_error(cache_filename);
+        return;
+    }
+
+    cache_file << "PWA_CACHE 3 " << generation << endl;
+
+    for (map<unsigned long long, PWA_cache_entry>::iterator it =
+         entries.begin(); it != entries.end(); ++it)
+    {
+        cache_file << hex << it->first << " "
+                   << it->second.check_hash << dec << " "
+                   << it->second.length_1 << " "
+                   << it->second.length_2 << " "
+                   << it->second.last_used << " "
+                   << it->second.alignment_score << " "
+                   << it->second.number_aligned << " "
+                   << it->second.cigar << "\n";
+    }
+
+    cache_file.close();
+    if (cache_file.fail())
+    {
+        remove(tmp_filename.c_str());
+        msg_obj->print_cache_write_error(cache_filename);
+        return;
+    }
+    rename(tmp_filename.c_str(), cache_filename);
+
+}   // End PWA_cache::save_cache().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::set_scoring_scheme()                               */
+/*-----------------------------------------------------------------------*/
+/* Hashes the scoring scheme of PWA_obj once. The result is mixed into   */
+/* every alignment key, so changing the scoring matrix or the gap        */
+/* penalty never returns a stale alignment.                              */
+/*=======================================================================*/
+void PWA_cache::set_scoring_scheme(PWA_alignment *PWA_obj)
+{
+    scheme_hash       = hash_bytes(fnv_offset_basis,
+                                   PWA_obj->get_scoring_scheme());
+    scheme_check_hash = check_bytes(0, PWA_obj->get_scoring_scheme());
+
+}   // End PWA_cache::set_scoring_scheme().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::get_alignment_key()                                */
+/*-----------------------------------------------------------------------*/
+/* Returns the cache key for aligning the two sequences currently in     */
+/* sequences_vector of PWA_obj with pair_engine. Engines may break ties  */
+/* differently, and banded, overlap and score-only results differ from   */
+/* nw ones, so the engine is hashed, with the band width for banded and  */
+/* the X-drop for overlap. The sequence lengths are hashed as well so    */
+/* that moving characters from one sequence to the other changes the     */
+/* key; the check hash is taken with check_bytes().                      */
+/*=======================================================================*/
+PWA_cache_key PWA_cache::get_alignment_key(PWA_alignment *PWA_obj,
+                                           const string &pair_engine)
+{
+    ostringstream settings;
+    PWA_cache_key key;
+
+    key.length_1   = PWA_obj->sequences_vector[0].length();
+    key.length_2   = PWA_obj->sequences_vector[1].length();
+    key.score_only = (pair_engine == "score");
+
+    settings << pair_engine << ":";
+    if (pair_engine == "banded")
+    {
+        settings << PWA_obj->band_width << ":";
+    }
+    if (pair_engine == "overlap")
+    {
+        settings << PWA_obj->xdrop << ":";
+    }
+    settings << key.length_1 << ":" << key.length_2 << ":";
+
+    key.hash = hash_bytes(scheme_hash, settings.str());
+    key.hash = hash_bytes(key.hash, PWA_obj->sequences_vector[0]);
+    key.hash = hash_bytes(key.hash, PWA_obj->sequences_vector[1]);
+
+    key.check_hash = check_bytes(scheme_check_hash, settings.str());
+    key.check_hash = check_bytes(key.check_hash,
+                                 PWA_obj->sequences_vector[0]);
+    key.check_hash = check_bytes(key.check_hash,
+                                 PWA_obj->sequences_vector[1]);
+
+    return (key);
+
+}   // End PWA_cache::get_alignment_key().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::lookup_alignment()                                 */
+/*-----------------------------------------------------------------------*/
+/* If key is in the cache, and its entry is for the same pair (see       */
+/* matches_entry()), fills in the alignment results of PWA_obj from the  */
+/* cached entry and returns 1. Otherwise returns 0. A score-only key     */
+/* only ever finds score-only entries, which restore no alignment.       */
+/*=======================================================================*/
+bool PWA_cache::lookup_alignment(PWA_alignment *PWA_obj,
+                                 const PWA_cache_key &key)
+{
+    PWA_cache_entry entry;
+
+    {
+        lock_guard<mutex> lock(cache_mutex);
+        map<unsigned long long, PWA_cache_entry>::iterator it =
+            entries.find(key.hash);
+
+        if ((it == entries.end()) || !matches_entry(key, it->second))
+        {
+            cache_misses++;
+            return (0);
+        }
+
+        it->second.last_used = generation;
+        entry = it->second;
+        cache_hits++;
+    }
+
+    if (key.score_only)
+    {
+        PWA_obj->score_only = 1;
+    }
+    else
+    {
+        PWA_obj->apply_cigar_string(entry.cigar);
+    }
+    PWA_obj->alignment_score = entry.alignment_score;
+    PWA_obj->number_aligned  = entry.number_aligned;
+
+    return (1);
+
+}   // End PWA_cache::lookup_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::store_alignment()                                  */
+/*-----------------------------------------------------------------------*/
+/* Adds the finished alignment of PWA_obj to the cache under key. If a   */
+/* long batch run grows the cache to twice its cap, the least recently   */
+/* used entries are evicted right away instead of waiting for            */
+/* save_cache().                                                         */
+/*=======================================================================*/
+void PWA_cache::store_alignment(PWA_alignment *PWA_obj,
+                                const PWA_cache_key &key)
+{
+    PWA_cache_entry entry;
+
+    entry.length_1        = key.length_1;
+    entry.length_2        = key.length_2;
+    entry.check_hash      = key.check_hash;
+    entry.alignment_score = PWA_obj->alignment_score;
+    entry.number_aligned  = PWA_obj->number_aligned;
+    entry.last_used       = generation;
+    entry.cigar           = key.score_only ? ""
+                                               : PWA_obj->get_cigar_string();
+
+    lock_guard<mutex> lock(cache_mutex);
+
+    if (entries.count(key.hash) == 0)
+    {
+        cache_bytes += get_entry_bytes(entry);
+    }
+    else
+    {
+        cache_bytes -= get_entry_bytes(entries[key.hash]);
+        cache_bytes += get_entry_bytes(entry);
+    }
+    entries[key.hash] = entry;
+
+    if (cache_bytes > 2 * max_cache_bytes)
+    {
+        evict_entries();
+    }
+
+}   // End PWA_cache::store_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::hash_bytes()                                       */
+/*-----------------------------------------------------------------------*/
+/* Continues the FNV-1a hash over the given bytes.                       */
+/*=======================================================================*/
+unsigned long long PWA_cache::hash_bytes(unsigned long long hash,
+                                         const string &bytes)
+{
+    for (size_t i = 0; i < bytes.length(); i++)
+    {
+        hash ^= (unsigned char)bytes[i];
+        hash *= fnv_prime;
+    }
+
+    return (hash);
+
+}   // End PWA_cache::hash_bytes().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::check_bytes()                                      */
+/*-----------------------------------------------------------------------*/
+/* Continues the check hash over the given bytes. Unlike FNV-1a it adds  */
+/* and multiplies in each byte and folds the high bits back down, so a   */
+/* pair of inputs that collide in one hash need not collide in the       */
+/* other. The end of the bytes is mixed in too, so no bytes can move     */
+/* from one sequence to the next unnoticed.                              */
+/*=======================================================================*/
+unsigned long long PWA_cache::check_bytes(unsigned long long hash,
+                                          const string &bytes)
+{
+    for (size_t i = 0; i < bytes.length(); i++)
+    {
+        hash  = (hash + (unsigned char)bytes[i] + 1) * check_multiplier;
+        hash ^= hash >> 29;
+    }
+
+    return ((hash + 257) * check_multiplier);
+
+}   // End PWA_cache::check_bytes().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::matches_entry()                                    */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if entry was stored for the pair of key: the lengths of     */
+/* both sequences and the check hash must all be the same.               */
+/*=======================================================================*/
+bool PWA_cache::matches_entry(const PWA_cache_key &key,
+                              const PWA_cache_entry &entry)
+{
+    return ((entry.length_1 == key.length_1) &&
+            (entry.length_2 == key.length_2) &&
+            (entry.check_hash == key.check_hash));
+
+}   // End PWA_cache::matches_entry().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::get_entry_bytes()                                  */
+/*-----------------------------------------------------------------------*/
+/* Approximate size of an entry in the cache file.                       */
+/*=======================================================================*/
+long PWA_cache::get_entry_bytes(const PWA_cache_entry &entry)
+{
+    return (80 + entry.cigar.length());
+
+}   // End PWA_cache::get_entry_bytes().
+
+
+/*=======================================================================*/
+/* Method: PWA_cache::evict_entries()                                    */
+/*-----------------------------------------------------------------------*/
+/* Removes least recently used entries until the cache fits in           */
+/* max_cache_bytes. The caller must hold cache_mutex or be the only      */
+/* thread using the cache.                                               */
+/*=======================================================================*/
+void PWA_cache::evict_entries(void)
+{
+    if (cache_bytes <= max_cache_bytes)
+    {
+        return;
+    }
+
+    vector<pair<long, unsigned long long> > by_age;
+    for (map<unsigned long long, PWA_cache_entry>::iterator it =
+         entries.begin(); it != entries.end(); ++it)
+    {
+        by_age.push_back(make_pair(it->second.last_used, it->first));
+    }
+    sort(by_age.begin(), by_age.end());
+
+    for (size_t i = 0; (i < by_age.size()) &&
+                       (cache_bytes > max_cache_bytes); i++)
+    {
+        map<unsigned long long, PWA_cache_entry>::iterator it =
+            entries.find(by_age[i].second);
+
+        cache_bytes -= get_entry_bytes(it->second);
+        entries.erase(it);
+    }
+
+}   // End PWA_cache::evict_entries().
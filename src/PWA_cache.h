@@ -0,0 +1,75 @@
+#ifndef PWA_CACHE_H
+#define PWA_CACHE_H
+
+#include "PWA_alignment.h"
+#include "PWA_message.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+// Identifies a pair: hash is the key of its entry, and the rest must
+// match the entry on a hit, so a collision of keys is a miss, not
+// another pair's alignment. Taken before aligning, as the alignment
+// replaces the sequences of the object.
+struct PWA_cache_key
+{
+    unsigned long long hash;
+    unsigned long long check_hash;
+    long length_1;
+    long length_2;
+    bool score_only;        // Entry holds a score but no alignment.
+};
+
+// One cached alignment result.
+struct PWA_cache_entry
+{
+    long   length_1;
+    long   length_2;
+    unsigned long long check_hash;
+    int    alignment_score;
+    int    number_aligned;
+    long   last_used;
+    string cigar;
+};
+
+class PWA_cache
+{
+public:
+    PWA_cache();
+    void load_cache(char *filename);
+    void save_cache(PWA_message *msg_obj);
+    void set_scoring_scheme(PWA_alignment *PWA_obj);
+    PWA_cache_key get_alignment_key(PWA_alignment *PWA_obj,
+                                    const string &pair_engine);
+    bool lookup_alignment(PWA_alignment *PWA_obj, const PWA_cache_key &key);
+    void store_alignment(PWA_alignment *PWA_obj, const PWA_cache_key &key);
+
+    long max_cache_bytes;
+    long cache_hits;
+    long cache_misses;
+
+private:
+    unsigned long long hash_bytes(unsigned long long hash,
+                                  const string &bytes);
+    unsigned long long check_bytes(unsigned long long hash,
+                                   const string &bytes);
+    bool matches_entry(const PWA_cache_key &key,
+                       const PWA_cache_entry &entry);
+    long get_entry_bytes(const PWA_cache_entry &entry);
+    void evict_entries(void);
+
+    map<unsigned long long, PWA_cache_entry> entries;
+    mutex cache_mutex;
+
+    char *cache_filename;
+    unsigned long long scheme_hash;
+    unsigned long long scheme_check_hash;
+    long generation;
+    long cache_bytes;
+
+};  // PWA_cache
+
+#endif  // PWA_CACHE_H
@@ -0,0 +1,330 @@
+/*=======================================================================*/
+/* Filename: PWA_capi.cpp                                                */
+/*=======================================================================*/
+/* C interface to PWA_alignment for embedding the aligner in other       */
+/* programs (see PWA_capi.h). Each pwa_aligner owns one PWA_alignment,   */
+/* which keeps its score table and matrix arena between calls, so a      */
+/* context aligning many pairs allocates almost nothing after the first. */
+/* Nothing here is shared between contexts.                              */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_capi.h"
+
+#include <ctype.h>
+#include <new>
+#include <string>
+
+using namespace std;
+
+// Context behind the opaque C handle.
+struct pwa_aligner
+{
+    PWA_alignment alignment_obj;
+    string        cigar;
+    int           score;
+};
+
+
+/*=======================================================================*/
+/* Function: pwa_api_version()                                           */
+/*-----------------------------------------------------------------------*/
+/* Returns PWA_API_VERSION of the library, to be checked against the     */
+/* header a program was compiled with.                                   */
+/*=======================================================================*/
+int pwa_api_version(void)
+{
+    return (PWA_API_VERSION);
+
+}   // End pwa_api_version().
+
+
+/*=======================================================================*/
+/* Function: pwa_aligner_create()                                        */
+/*-----------------------------------------------------------------------*/
+/* Returns a new context with +1/-1 scoring, gap penalty -2 and the nw   */
+/* engine, or NULL if out of memory.                                     */
+/*=======================================================================*/
+pwa_aligner *pwa_aligner_create(void)
+{
+    pwa_aligner *aligner = new (nothrow) pwa_aligner;
+
+    if (aligner != NULL)
+    {
+        aligner->score = 0;
+    }
+
+    return (aligner);
+
+}   // End pwa_aligner_create().
+
+
+/*=======================================================================*/
+/* Function: pwa_aligner_free()                                          */
+/*-----------------------------------------------------------------------*/
+/* Frees a context and its buffers. NULL is ignored.                     */
+/*=======================================================================*/
+void pwa_aligner_free(pwa_aligner *aligner)
+{
+    delete aligner;
+
+}   // End pwa_aligner_free().
+
+
+/*=======================================================================*/
+/* Function: pwa_set_score()                                             */
+/*-----------------------------------------------------------------------*/
+/* Sets the substitution score of char_1 (sequence 1) against char_2     */
+/* (sequence 2), case-insensitively. Once any score is set, the context  */
+/* scores from its table like -s FILE, pairs not set scoring 0.          */
+/*=======================================================================*/
+int pwa_set_score(pwa_aligner *aligner, char char_1, char char_2, int score)
+{
+    if (aligner == NULL)
+    {
+        return (PWA_ERROR_INVALID_ARGUMENT);
+    }
+
+    string amino_pair = "";
+    amino_pair.push_back(toupper((unsigned char)char_1));
+    amino_pair.push_back(toupper((unsigned char)char_2));
+
+    aligner->alignment_obj.scoring_map[amino_pair] = score;
+    aligner->alignment_obj.scoring_specified = 1;
+    aligner->alignment_obj.score_table.clear();
+
+    return (PWA_OK);
+
+}   // End pwa_set_score().
+
+
+/*=======================================================================*/
+/* Function: pwa_clear_scores()                                          */
+/*-----------------------------------------------------------------------*/
+/* Returns the context to +1/-1 scoring.                                 */
+/*=======================================================================*/
+int pwa_clear_scores(pwa_aligner *aligner)
+{
+    if (aligner == NULL)
+    {
+        return (PWA_ERROR_INVALID_ARGUMENT);
+    }
+
+    aligner->alignment_obj.scoring_map.clear();
+    aligner->alignment_obj.scoring_specified = 0;
+    aligner->alignment_obj.score_table.clear();
+
+    return (PWA_OK);
+
+}   // End pwa_clear_scores().
+
+
+/*=======================================================================*/
+/* Function: pwa_set_gap_penalty()                                       */
+/*-----------------------------------------------------------------------*/
+/* Sets the score of each gap character; must be negative.               */
+/*=======================================================================*/
+int pwa_set_gap_penalty(pwa_aligner *aligner, int penalty)
+{
+    if ((aligner == NULL) || (penalty >= 0))
+    {
+        return (PWA_ERROR_INVALID_ARGUMENT);
+    }
+
+    aligner->alignment_obj.set_gap_penalty(penalty);
+
+    return (PWA_OK);
+
+}   // End pwa_set_gap_penalty().
+
+
+/*=======================================================================*/
+/* Function: pwa_set_engine()                                            */
+/*-----------------------------------------------------------------------*/
+/* Selects the engine by its --engine name: nw, banded, linear, score,   */
+/* wfa, overlap, diff or russians.                                       */
+/*=======================================================================*/
+int pwa_set_engine(pwa_aligner *aligner, const char *engine)
+{
+    if ((aligner == NULL) || (engine == NULL))
+    {
+        return (PWA_ERROR_INVALID_ARGUMENT);
+    }
+
+    string name = engine;
+    if ((name != "nw") && (name != "banded") && (name != "linear") &&
+        (name != "score") && (name != "wfa") && (name != "overlap") &&
+        (name != "diff") && (name != "russians"))
+    {
+        return (PWA_ERROR_UNKNOWN_ENGINE);
+    }
+
+    aligner->alignment_obj.engine = name;
+
+    return (PWA_OK);
+
+}   // End pwa_set_engine().
+
+
+/*=======================================================================*/
+/* Function: pwa_set_band_width()                                        */
+/*-----------------------------------------------------------------------*/
+/* Sets the band width of the banded engine (0 for its default).         */
+/*=======================================================================*/
+int pwa_set_band_width(pwa_aligner *aligner, int band_width)
+{
+    if ((aligner == NULL) || (band_width < 0))
+    {
+        return (PWA_ERROR_INVALID_ARGUMENT);
+    }
+
+    aligner->alignment_obj.band_width = band_width;
+
+    return (PWA_OK);
+
+}   // End pwa_set_band_width().
+
+
+/*=======================================================================*/
+/* Function: pwa_set_min_score()                                         */
+/*-----------------------------------------------------------------------*/
+/* Makes pwa_align() give up with PWA_ERROR_BELOW_MIN_SCORE on pairs     */
+/* that cannot score min_score, as --min-score does.                     */
+/*=======================================================================*/
+int pwa_set_min_score(pwa_aligner *aligner, int min_score)
+{
+    if (aligner == NULL)
+    {
+        return (PWA_ERROR_INVALID_ARGUMENT);
+    }
+
+    aligner->alignment_obj.min_score_specified = 1;
+    aligner->alignment_obj.min_score = min_score;
+
+    return (PWA_OK);
+
+}   // End pwa_set_min_score().
+
+
+/*=======================================================================*/
+/* Function: pwa_set_limits()                                            */
+/*-----------------------------------------------------------------------*/
+/* Limits each pwa_align() to seconds of time and cells of matrix, as    */
+/* --time-limit and --cell-limit do (0 for no limit). Over a limit, the  */
+/* pair is aligned with the banded engine if fallback is nonzero, and    */
+/* otherwise pwa_align() gives up with PWA_ERROR_OVER_LIMIT.             */
+/*=======================================================================*/
+int pwa_set_limits(pwa_aligner *aligner, double seconds, long cells,
+                   int fallback)
+{
+    if ((aligner == NULL) || (seconds < 0) || (cells < 0))
+    {
+        return (PWA_ERROR_INVALID_ARGUMENT);
+    }
+
+    aligner->alignment_obj.time_limit     = seconds;
+    aligner->alignment_obj.cell_limit     = cells;
+    aligner->alignment_obj.limit_fallback = (fallback != 0);
+
+    return (PWA_OK);
+
+}   // End pwa_set_limits().
+
+
+/*=======================================================================*/
+/* Function: pwa_align()                                                 */
+/*-----------------------------------------------------------------------*/
+/* Aligns sequence_1 (length_1 characters, not necessarily terminated)   */
+/* with sequence_2. On PWA_OK the score and CIGAR string (see            */
+/* PWA_alignment::get_cigar_string(); empty for the score engine) are    */
+/* available until the next call with this context. Running out of       */
+/* memory returns PWA_ERROR_OUT_OF_MEMORY, and any other exception       */
+/* PWA_ERROR_INTERNAL, instead of unwinding into C code; the context     */
+/* stays usable either way.                                              */
+/*=======================================================================*/
+int pwa_align(pwa_aligner *aligner,
+              const char *sequence_1, size_t length_1,
+              const char *sequence_2, size_t length_2)
+{
+    if ((aligner == NULL) ||
+        ((sequence_1 == NULL) && (length_1 > 0)) ||
+        ((sequence_2 == NULL) && (length_2 > 0)))
+    {
+        return (PWA_ERROR_INVALID_ARGUMENT);
+    }
+
+    PWA_alignment &alignment_obj = aligner->alignment_obj;
+
+    aligner->cigar = "";
+    aligner->score = 0;
+
+    try
+    {
+        alignment_obj.reset_alignment();
+        alignment_obj.names_vector.push_back("");
+        alignment_obj.names_vector.push_back("");
+        alignment_obj.sequences_vector.push_back(
+            string(sequence_1, length_1));
+        alignment_obj.sequences_vector.push_back(
+            string(sequence_2, length_2));
+
+        // No messages: the engines reachable from here never print.
+        alignment_obj.begin_PWA_alignment(NULL);
+
+        if (alignment_obj.alignment_status ==
+            PWA_alignment::status_below_min_score)
+        {
+            return (PWA_ERROR_BELOW_MIN_SCORE);
+        }
+        if (alignment_obj.alignment_status ==
+            PWA_alignment::status_over_limit)
+        {
+            return (PWA_ERROR_OVER_LIMIT);
+        }
+
+        aligner->score = alignment_obj.alignment_score;
+        if (alignment_obj.score_only == 0)
+        {
+            aligner->cigar = alignment_obj.get_cigar_string();
+        }
+    }
+    catch (const bad_alloc &)
+    {
+        aligner->cigar = "";
+        aligner->score = 0;
+        return (PWA_ERROR_OUT_OF_MEMORY);
+    }
+    catch (...)
+    {
+        aligner->cigar = "";
+        aligner->score = 0;
+        return (PWA_ERROR_INTERNAL);
+    }
+
+    return (PWA_OK);
+
+}   // End pwa_align().
+
+
+/*=======================================================================*/
+/* Function: pwa_get_score()                                             */
+/*-----------------------------------------------------------------------*/
+/* Returns the score of the last successful pwa_align().                 */
+/*=======================================================================*/
+int pwa_get_score(const pwa_aligner *aligner)
+{
+    return ((aligner != NULL) ? aligner->score : 0);
+
+}   // End pwa_get_score().
+
+
+/*=======================================================================*/
+/* Function: pwa_get_cigar()                                             */
+/*-----------------------------------------------------------------------*/
+/* Returns the CIGAR string of the last successful pwa_align(), owned by */
+/* the context.                                                          */
+/*=======================================================================*/
+const char *pwa_get_cigar(const pwa_aligner *aligner)
+{
+    return ((aligner != NULL) ? aligner->cigar.c_str() : "");
+
+}   // End pwa_get_cigar().
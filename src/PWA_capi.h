@@ -0,0 +1,73 @@
+#ifndef PWA_CAPI_H
+#define PWA_CAPI_H
+
+/*=======================================================================*/
+/* C interface of libpwa (built with quicklib). An aligner context holds */
+/* the scoring scheme, engine and reusable buffers; one context may be   */
+/* used by one thread at a time, and any number of contexts may be used  */
+/* by different threads at once.                                         */
+/*                                                                       */
+/*     pwa_aligner *aligner = pwa_aligner_create();                      */
+/*     pwa_set_gap_penalty(aligner, -3);                                 */
+/*     if (pwa_align(aligner, seq_1, len_1, seq_2, len_2) == PWA_OK)     */
+/*         printf("%d %s\n", pwa_get_score(aligner),                     */
+/*                pwa_get_cigar(aligner));                               */
+/*     pwa_aligner_free(aligner);                                        */
+/*                                                                       */
+/* Functions returning int return PWA_OK or a PWA_ERROR_ code; no        */
+/* failure exits the program or lets an exception out. The ABI only      */
+/* changes with PWA_API_VERSION (2 added PWA_ERROR_OUT_OF_MEMORY and     */
+/* PWA_ERROR_INTERNAL).                                                  */
+/*=======================================================================*/
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWA_API_VERSION 2
+
+// quicklib hides everything but the functions below.
+#if defined(__GNUC__)
+#define PWA_API __attribute__((visibility("default")))
+#else
+#define PWA_API
+#endif
+
+#define PWA_OK                      0
+#define PWA_ERROR_INVALID_ARGUMENT -1
+#define PWA_ERROR_UNKNOWN_ENGINE   -2
+#define PWA_ERROR_BELOW_MIN_SCORE  -3
+#define PWA_ERROR_OVER_LIMIT       -4
+#define PWA_ERROR_OUT_OF_MEMORY    -5
+#define PWA_ERROR_INTERNAL         -6
+
+typedef struct pwa_aligner pwa_aligner;
+
+PWA_API int          pwa_api_version(void);
+
+PWA_API pwa_aligner *pwa_aligner_create(void);
+PWA_API void         pwa_aligner_free(pwa_aligner *aligner);
+
+PWA_API int pwa_set_score(pwa_aligner *aligner, char char_1, char char_2,
+                          int score);
+PWA_API int pwa_clear_scores(pwa_aligner *aligner);
+PWA_API int pwa_set_gap_penalty(pwa_aligner *aligner, int penalty);
+PWA_API int pwa_set_engine(pwa_aligner *aligner, const char *engine);
+PWA_API int pwa_set_band_width(pwa_aligner *aligner, int band_width);
+PWA_API int pwa_set_min_score(pwa_aligner *aligner, int min_score);
+PWA_API int pwa_set_limits(pwa_aligner *aligner, double seconds, long cells,
+                           int fallback);
+
+PWA_API int pwa_align(pwa_aligner *aligner,
+                      const char *sequence_1, size_t length_1,
+                      const char *sequence_2, size_t length_2);
+
+PWA_API int         pwa_get_score(const pwa_aligner *aligner);
+PWA_API const char *pwa_get_cigar(const pwa_aligner *aligner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PWA_CAPI_H
@@ -0,0 +1,336 @@
+/*=======================================================================*/
+/* Filename: PWA_diagonal.cpp                                            */
+/*=======================================================================*/
+/* Ungapped diagonal filter for nucleotide screening (--diagonal-filter).*/
+/* The sequences are read as the 2-bit packed words of PWA_store, so     */
+/* that 32 bases of a diagonal are compared with one XOR: a base         */
+/* mismatches if either of its 2 bits differs, or if either base is an   */
+/* exception (N, IUPAC), which the words read as A. The best segment is  */
+/* found to the base by combining, 8 bases at a time, the best prefix,   */
+/* suffix and segment of each byte of mismatch bits from a table.        */
+/*                                                                       */
+/* A pair is decided without dynamic programming when it can be:         */
+/*     accepted: the sequences have the same length and the main         */
+/*               diagonal scores more than any alignment with a gap      */
+/*               could, so the ungapped alignment is the nw alignment;   */
+/*     rejected: no diagonal near the main one (or the one joining the   */
+/*               ends) has an ungapped segment scoring                   */
+/*               min_diagonal_score or more. "Near" is band diagonals    */
+/*               plus 2 sqrt(L) for a shorter length L, since the net    */
+/*               drift of random indels grows like sqrt(L).              */
+/* Every other pair is left to the engine. Rejection is a heuristic, as  */
+/* with the all-vs-all prefilter; acceptance is exact.                   */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_diagonal.h"
+
+#include "PWA_store.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Low bit of every 2-bit code in a word.
+static const unsigned long long low_bits = 0x5555555555555555ULL;
+
+
+/*=======================================================================*/
+/* Function: get_base_bits()                                             */
+/*-----------------------------------------------------------------------*/
+/* Returns the low bits of the 32 2-bit codes of bits as one bit per     */
+/* base, base i in bit i.                                                */
+/*=======================================================================*/
+static unsigned int get_base_bits(unsigned long long bits)
+{
+    bits &= low_bits;
+    bits = (bits | (bits >> 1))  & 0x3333333333333333ULL;
+    bits = (bits | (bits >> 2))  & 0x0F0F0F0F0F0F0F0FULL;
+    bits = (bits | (bits >> 4))  & 0x00FF00FF00FF00FFULL;
+    bits = (bits | (bits >> 8))  & 0x0000FFFF0000FFFFULL;
+    bits = (bits | (bits >> 16)) & 0x00000000FFFFFFFFULL;
+
+    return ((unsigned int)bits);
+
+}   // End get_base_bits().
+
+
+/*=======================================================================*/
+/* Constructor: PWA_diagonal                                             */
+/*-----------------------------------------------------------------------*/
+/* Initializes a filter that scans at least 16 diagonals on either side, */
+/* and its table of 8-base segment scores.                               */
+/*=======================================================================*/
+PWA_diagonal::PWA_diagonal()
+{
+    min_diagonal_score = 0;
+    band               = 16;
+    pairs_accepted     = 0;
+    pairs_rejected     = 0;
+
+    for (int mismatches = 0; mismatches < 256; mismatches++)
+    {
+        PWA_segment_score &segment = segment_table[mismatches];
+        int sum = 0;
+        int run = 0;
+
+        segment.prefix = 0;
+        segment.best   = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            int score = ((mismatches >> i) & 1) ? -1 : 1;
+
+            sum += score;
+            run  = max(0, run) + score;
+            segment.prefix = max((int)segment.prefix, sum);
+            segment.best   = max((int)segment.best, run);
+        }
+        segment.total  = sum;
+        segment.suffix = max(0, run);
+    }
+
+}   // End PWA_diagonal::PWA_diagonal().
+
+
+/*=======================================================================*/
+/* Method: PWA_diagonal::screen_pair()                                   */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if the pair of PWA_obj was decided: accepted, with its      */
+/* alignment and score stored in PWA_obj, or rejected, with              */
+/* alignment_status set to status_filtered. Returns 0 if it must be      */
+/* aligned, and for pairs scored with a scoring matrix.                  */
+/*=======================================================================*/
+bool PWA_diagonal::screen_pair(PWA_alignment *PWA_obj)
+{
+    if (PWA_obj->scoring_specified == 1)
+    {
+        return (0);
+    }
+
+    PWA_store           pair_store;
+    PWA_packed_sequence sequences[2];
+    long length_1 = PWA_obj->sequences_vector[0].length();
+    long length_2 = PWA_obj->sequences_vector[1].length();
+    int  gap      = PWA_obj->get_gap_penalty();
+    int  total    = 0;
+
+    if (!get_packed_pair(PWA_obj, &pair_store, sequences))
+    {
+        return (0);
+    }
+
+    if ((length_1 == length_2) && (length_1 > 0))
+    {
+        scan_diagonal(sequences[0], sequences[1], 0, 0, length_1, &total);
+        if ((total > (length_1 - 1) + (2 * gap)) &&
+            accept_main_diagonal(PWA_obj))
+        {
+            pairs_accepted++;
+            return (1);
+        }
+    }
+
+    // Diagonal d pairs base j of sequence 1 with base j - d of sequence 2.
+    long reach = band + (long)(2 * sqrt((double)min(length_1, length_2)));
+    long first = min(0L, length_1 - length_2) - reach;
+    long last  = max(0L, length_1 - length_2) + reach;
+
+    for (long d = first; d <= last; d++)
+    {
+        long start_1 = max(0L, d);
+        long start_2 = max(0L, -d);
+        long length  = min(length_1 - start_1, length_2 - start_2);
+
+        if ((length > 0) &&
+            (scan_diagonal(sequences[0], sequences[1], start_1, start_2,
+                           length, &total) >= min_diagonal_score))
+        {
+            return (0);
+        }
+    }
+
+    PWA_obj->alignment_status = PWA_alignment::status_filtered;
+    pairs_rejected++;
+
+    return (1);
+
+}   // End PWA_diagonal::screen_pair().
+
+
+/*=======================================================================*/
+/* Method: PWA_diagonal::get_packed_pair()                               */
+/*-----------------------------------------------------------------------*/
+/* Points sequences at the packed words of the pair of PWA_obj: those of */
+/* its store_obj if it has one and sequence 2 was not reverse            */
+/* complemented, or else those of pair_store, into which both sequences  */
+/* are packed here. Returns 0 if either is not a nucleotide record.      */
+/*=======================================================================*/
+bool PWA_diagonal::get_packed_pair(PWA_alignment *PWA_obj,
+                                   PWA_store *pair_store,
+                                   PWA_packed_sequence *sequences)
+{
+    PWA_store *store_obj = PWA_obj->store_obj;
+    long       records[2];
+
+    if ((store_obj != NULL) && (PWA_obj->strand == '+'))
+    {
+        records[0] = PWA_obj->store_records[0];
+        records[1] = PWA_obj->store_records[1];
+    }
+    else
+    {
+        store_obj = pair_store;
+        store_obj->add_record("", PWA_obj->sequences_vector[0]);
+        store_obj->add_record("", PWA_obj->sequences_vector[1]);
+        records[0] = 0;
+        records[1] = 1;
+    }
+
+    for (int k = 0; k < 2; k++)
+    {
+        if (!store_obj->is_nucleotide(records[k]))
+        {
+            return (0);
+        }
+
+        sequences[k].words      = store_obj->get_packed_words(records[k]);
+        sequences[k].word_count = store_obj->get_word_count(records[k]);
+        store_obj->get_exception_mask(records[k], sequences[k].exceptions);
+    }
+
+    return (1);
+
+}   // End PWA_diagonal::get_packed_pair().
+
+
+/*=======================================================================*/
+/* Method: PWA_diagonal::get_window()                                    */
+/*-----------------------------------------------------------------------*/
+/* Returns the 32 codes of words starting at code start. Words past      */
+/* word_count read as 0.                                                 */
+/*=======================================================================*/
+unsigned long long PWA_diagonal::get_window(const unsigned long long *words,
+                                            long word_count, long start)
+{
+    long word  = start >> 5;
+    int  shift = (start & 31) * 2;
+    unsigned long long low  = (word < word_count) ? words[word] : 0;
+    unsigned long long high = (word + 1 < word_count) ? words[word + 1] : 0;
+
+    if (shift == 0)
+    {
+        return (low);
+    }
+
+    return ((low >> shift) | (high << (64 - shift)));
+
+}   // End PWA_diagonal::get_window().
+
+
+/*=======================================================================*/
+/* Method: PWA_diagonal::scan_diagonal()                                 */
+/*-----------------------------------------------------------------------*/
+/* Scores length bases of sequence_1 from start_1 against sequence_2     */
+/* from start_2, +1 per match and -1 per mismatch, 32 at a time. Stores  */
+/* the score of the whole diagonal in total_score and returns the best   */
+/* score of an ungapped segment (0 if none is positive). run is the best */
+/* score of a segment ending at the current base, or 0.                  */
+/*=======================================================================*/
+int PWA_diagonal::scan_diagonal(const PWA_packed_sequence &sequence_1,
+                                const PWA_packed_sequence &sequence_2,
+                                long start_1, long start_2, long length,
+                                int *total_score)
+{
+    const unsigned long long *words_1      = sequence_1.words;
+    const unsigned long long *words_2      = sequence_2.words;
+    const unsigned long long *exceptions_1 = sequence_1.exceptions.data();
+    const unsigned long long *exceptions_2 = sequence_2.exceptions.data();
+    long count_1 = sequence_1.word_count;
+    long count_2 = sequence_2.word_count;
+
+    int best  = 0;
+    int run   = 0;
+    int total = 0;
+
+    for (long k = 0; k < length; k += 32)
+    {
+        int bases = min(32L, length - k);
+        unsigned long long difference =
+            get_window(words_1, count_1, start_1 + k) ^
+            get_window(words_2, count_2, start_2 + k);
+        unsigned int mismatches = get_base_bits(
+            difference | (difference >> 1) |
+            get_window(exceptions_1, count_1, start_1 + k) |
+            get_window(exceptions_2, count_2, start_2 + k));
+
+        if (bases < 32)
+        {
+            // Bases past the end mismatch, so no segment reaches them.
+            mismatches |= ~0U << bases;
+            total += 32 - (2 * __builtin_popcount(mismatches)) +
+                     (32 - bases);
+        }
+        else
+        {
+            total += 32 - (2 * __builtin_popcount(mismatches));
+        }
+
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            const PWA_segment_score &segment =
+                segment_table[(mismatches >> shift) & 255];
+
+            best = max(best, max((int)segment.best, run + segment.prefix));
+            run  = max((int)segment.suffix, run + segment.total);
+        }
+    }
+
+    *total_score = total;
+
+    return (best);
+
+}   // End PWA_diagonal::scan_diagonal().
+
+
+/*=======================================================================*/
+/* Method: PWA_diagonal::accept_main_diagonal()                          */
+/*-----------------------------------------------------------------------*/
+/* Scores the main diagonal of PWA_obj exactly from the characters,      */
+/* which the packed words only approximate (case, N). An alignment of    */
+/* two sequences of length L with a gap has at least two gaps and at     */
+/* most L - 1 aligned pairs, so it scores at most L - 1 + 2g. If the     */
+/* diagonal scores more, it is the only best alignment, and the one nw   */
+/* would trace back: stores it in PWA_obj and returns 1.                 */
+/*=======================================================================*/
+bool PWA_diagonal::accept_main_diagonal(PWA_alignment *PWA_obj)
+{
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    const string &sequence_1 = PWA_obj->sequences_vector[0];
+    const string &sequence_2 = PWA_obj->sequences_vector[1];
+    const int    *table      = PWA_obj->score_table.data();
+    long length = sequence_1.length();
+    long score  = 0;
+
+    for (long i = 0; i < length; i++)
+    {
+        score += table[((unsigned char)sequence_1[i] << 8) |
+                       (unsigned char)sequence_2[i]];
+    }
+
+    if (score <= (length - 1) + (2 * PWA_obj->get_gap_penalty()))
+    {
+        return (0);
+    }
+
+    PWA_obj->apply_cigar_string(string(length, 'M'));
+    PWA_obj->alignment_score = score;
+
+    return (1);
+
+}   // End PWA_diagonal::accept_main_diagonal().
@@ -0,0 +1,64 @@
+#ifndef PWA_DIAGONAL_H
+#define PWA_DIAGONAL_H
+
+#include "PWA_alignment.h"
+#include "PWA_store.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Score of 8 bases, +1 per match and -1 per mismatch, and its best
+// prefix, suffix and segment (each 0 if none is positive).
+struct PWA_segment_score
+{
+    signed char total;
+    signed char prefix;
+    signed char suffix;
+    signed char best;
+};
+
+// A nucleotide sequence as the filter reads it: the packed words of its
+// PWA_store record and a mask of its exceptions, which the words read
+// as A.
+struct PWA_packed_sequence
+{
+    const unsigned long long  *words;
+    long                       word_count;
+    vector<unsigned long long> exceptions;
+};
+
+class PWA_diagonal
+{
+public:
+    PWA_diagonal();
+    bool screen_pair(PWA_alignment *PWA_obj);
+
+    int  min_diagonal_score;    // Pairs whose best segment scores less
+                                // are rejected.
+    int  band;                  // Diagonals scanned around the ends,
+                                // besides those for indel drift.
+
+    // Shared by all workers.
+    atomic<long> pairs_accepted;
+    atomic<long> pairs_rejected;
+
+private:
+    bool get_packed_pair(PWA_alignment *PWA_obj, PWA_store *pair_store,
+                         PWA_packed_sequence *sequences);
+    unsigned long long get_window(const unsigned long long *words,
+                                  long word_count, long start);
+    int  scan_diagonal(const PWA_packed_sequence &sequence_1,
+                       const PWA_packed_sequence &sequence_2,
+                       long start_1, long start_2, long length,
+                       int *total_score);
+    bool accept_main_diagonal(PWA_alignment *PWA_obj);
+
+    // By the mismatch bits of 8 bases.
+    PWA_segment_score segment_table[256];
+
+};  // PWA_diagonal
+
+#endif  // PWA_DIAGONAL_H
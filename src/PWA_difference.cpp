@@ -0,0 +1,334 @@
+/*=======================================================================*/
+/* Filename: PWA_difference.cpp                                          */
+/*=======================================================================*/
+/* Needleman-Wunsch engine on score differences (--engine diff), after   */
+/* Suzuki and Kasahara. Absolute scores grow with the sequence length,   */
+/* but the difference between neighbouring cells does not: with gap      */
+/* penalty g and best substitution score s_max, the vertical difference  */
+/* H(i,j) - H(i-1,j) and horizontal difference H(i,j) - H(i,j-1) always  */
+/* lie in [g, s_max - g]. Writing Z = H(i,j) - H(i-1,j-1), the           */
+/* recurrence becomes                                                    */
+/*     Z       = max(s(i,j), V(i,j-1) + g, H(i-1,j) + g)                 */
+/*     V(i,j)  = Z - H(i-1,j)                                            */
+/*     H(i,j)  = Z - V(i,j-1)                                            */
+/* (V and H here being the vertical and horizontal differences), so      */
+/* every value fits in a signed 8-bit lane whatever the length.          */
+/*                                                                       */
+/* Cells are computed one anti-diagonal at a time, since every cell of   */
+/* an anti-diagonal only depends on the one before, 16 cells per vector  */
+/* operation (GCC vector extensions, i.e. SSE2 or NEON). The step of    */
+/* each cell is kept, one byte per cell, for the traceback, and the      */
+/* final score is rebuilt from the horizontal differences of the last    */
+/* row. Steps are chosen as by the nw engine, so the alignment is the    */
+/* same.                                                                 */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_difference.h"
+
+#include <algorithm>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// 16 signed 8-bit lanes.
+typedef signed char PWA_lanes __attribute__((vector_size(16)));
+
+static const int lane_count = 16;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_difference                                           */
+/*-----------------------------------------------------------------------*/
+/* Initializes an empty engine.                                          */
+/*=======================================================================*/
+PWA_difference::PWA_difference()
+{
+    length_1     = 0;
+    length_2     = 0;
+    score_table  = NULL;
+    unit_scoring = 1;
+    gap_penalty  = -2;
+    final_score  = 0;
+    limit_obj    = NULL;
+
+}   // End PWA_difference::PWA_difference().
+
+
+/*=======================================================================*/
+/* Method: PWA_difference::fits_in_8_bits()                              */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if every value of the difference recurrence for the pair    */
+/* of PWA_obj fits in a signed byte: substitution scores of the          */
+/* characters in the two sequences, twice the gap penalty, and the       */
+/* largest difference, s_max - g. Otherwise the nw engine is used.       */
+/*=======================================================================*/
+bool PWA_difference::fits_in_8_bits(PWA_alignment *PWA_obj)
+{
+    bool in_1[256] = {0};
+    bool in_2[256] = {0};
+    int  gap       = PWA_obj->get_gap_penalty();
+    int  min_score = 0;
+    int  max_score = 0;
+    bool first     = 1;
+
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    for (size_t i = 0; i < PWA_obj->sequences_vector[0].length(); i++)
+    {
+        in_1[(unsigned char)PWA_obj->sequences_vector[0][i]] = 1;
+    }
+    for (size_t i = 0; i < PWA_obj->sequences_vector[1].length(); i++)
+    {
+        in_2[(unsigned char)PWA_obj->sequences_vector[1][i]] = 1;
+    }
+
+    for (int char_1 = 0; char_1 < 256; char_1++)
+    {
+        for (int char_2 = 0; in_1[char_1] && (char_2 < 256); char_2++)
+        {
+            if (in_2[char_2])
+            {
+                int score = PWA_obj->score_table[(char_1 << 8) | char_2];
+                min_score = first ? score : min(min_score, score);
+                max_score = first ? score : max(max_score, score);
+                first     = 0;
+            }
+        }
+    }
+
+    return ((gap < 0) && (2 * gap >= -128) && (min_score >= -128) &&
+            (max_score - gap <= 127));
+
+}   // End PWA_difference::fits_in_8_bits().
+
+
+/*=======================================================================*/
+/* Method: PWA_difference::begin_difference_alignment()                  */
+/*-----------------------------------------------------------------------*/
+/* Aligns the two sequences of PWA_obj, which must pass                  */
+/* fits_in_8_bits(), and stores the alignment in PWA_obj. If the time    */
+/* limit of PWA_obj passes first, sets status_over_limit instead.        */
+/*=======================================================================*/
+void PWA_difference::begin_difference_alignment(PWA_alignment *PWA_obj)
+{
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    sequence_1   = PWA_obj->sequences_vector[0];
+    reverse_2.assign(PWA_obj->sequences_vector[1].rbegin(),
+                     PWA_obj->sequences_vector[1].rend());
+    length_1     = sequence_1.length();
+    length_2     = reverse_2.length();
+    score_table  = PWA_obj->score_table.data();
+    unit_scoring = (PWA_obj->scoring_specified == 0);
+    gap_penalty  = PWA_obj->get_gap_penalty();
+    limit_obj    = (PWA_obj->time_limit > 0) ? PWA_obj : NULL;
+
+    if (!fill_diagonals())
+    {
+        PWA_obj->alignment_status = PWA_alignment::status_over_limit;
+        return;
+    }
+
+    PWA_obj->apply_cigar_string(trace_back_diagonals());
+    PWA_obj->alignment_score = final_score;
+
+}   // End PWA_difference::begin_difference_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_difference::fill_diagonals()                              */
+/*-----------------------------------------------------------------------*/
+/* Computes anti-diagonals d = i + j from 2 to length_1 + length_2.      */
+/* Before each, the boundary differences it reads are set: V(i,0) and    */
+/* H(0,j) are both g, as the first row and column are multiples of g.    */
+/* Returns 0 if the time limit of limit_obj passed first.                */
+/*=======================================================================*/
+bool PWA_difference::fill_diagonals(void)
+{
+    int diagonals = length_1 + length_2;
+
+    vertical_previous.assign(length_1 + lane_count + 2, 0);
+    vertical_current.assign(length_1 + lane_count + 2, 0);
+    horizontal_previous.assign(length_1 + lane_count + 2, 0);
+    horizontal_current.assign(length_1 + lane_count + 2, 0);
+    substitution.assign(length_1 + lane_count + 2, 0);
+
+    diagonal_offset.assign(diagonals + 2, 0);
+    for (int d = 2; d <= diagonals; d++)
+    {
+        int lo = max(1, d - length_2);
+        int hi = min(length_1, d - 1);
+        diagonal_offset[d + 1] = diagonal_offset[d] + max(0, hi - lo + 1);
+    }
+    steps.resize(diagonal_offset[diagonals + 1] + lane_count);
+
+    final_score = length_2 * gap_penalty;
+    if (length_2 == 0)
+    {
+        final_score = length_1 * gap_penalty;
+    }
+
+    for (int d = 2; d <= diagonals; d++)
+    {
+        int lo = max(1, d - length_2);
+        int hi = min(length_1, d - 1);
+
+        if (lo > hi)
+        {
+            continue;
+        }
+
+        vertical_previous[0] = gap_penalty;
+        if (d - 1 <= length_1)
+        {
+            horizontal_previous[d - 1] = gap_penalty;
+        }
+
+        compute_diagonal(d, lo, hi);
+
+        // Cell (length_2, d - length_2) of the last row.
+        if (d > length_2)
+        {
+            final_score += horizontal_current[lo];
+        }
+
+        vertical_previous.swap(vertical_current);
+        horizontal_previous.swap(horizontal_current);
+
+        if ((limit_obj != NULL) && limit_obj->exceeds_time_limit())
+        {
+            return (0);
+        }
+    }
+
+    return (1);
+
+}   // End PWA_difference::fill_diagonals().
+
+
+/*=======================================================================*/
+/* Method: PWA_difference::compute_diagonal()                            */
+/*-----------------------------------------------------------------------*/
+/* Computes columns lo to hi of anti-diagonal d, lane_count cells at a   */
+/* time and the rest one by one. Cell (d - j, j) reads V(d - j, j - 1)   */
+/* at vertical_previous[j - 1] and H(d - j - 1, j) at                    */
+/* horizontal_previous[j]. Its characters are sequence_1[j - 1] and      */
+/* reverse_2[length_2 - d + j], both increasing with j.                  */
+/*=======================================================================*/
+void PWA_difference::compute_diagonal(int d, int lo, int hi)
+{
+    int count = hi - lo + 1;
+
+    const signed char *vertical   = &vertical_previous[lo - 1];
+    const signed char *horizontal = &horizontal_previous[lo];
+    const char        *chars_1    = sequence_1.data() + (lo - 1);
+    const char        *chars_2    = reverse_2.data() + (length_2 - d + lo);
+    signed char       *new_vertical   = &vertical_current[lo];
+    signed char       *new_horizontal = &horizontal_current[lo];
+    unsigned char     *step           = &steps[diagonal_offset[d]];
+
+    if (!unit_scoring)
+    {
+        for (int k = 0; k < count; k++)
+        {
+            int char_1 = (unsigned char)chars_1[k];
+            int char_2 = (unsigned char)chars_2[k];
+            substitution[k] = score_table[(char_1 << 8) | char_2];
+        }
+    }
+
+    PWA_lanes gap  = {0};
+    PWA_lanes ones = {0};
+    gap  += gap_penalty;
+    ones += 1;
+
+    int k = 0;
+    for (; k + lane_count <= count; k += lane_count)
+    {
+        PWA_lanes s, v, h;
+
+        if (unit_scoring)
+        {
+            PWA_lanes c_1, c_2;
+            memcpy(&c_1, chars_1 + k, lane_count);
+            memcpy(&c_2, chars_2 + k, lane_count);
+            s = ((c_1 == c_2) & 2) - ones;
+        }
+        else
+        {
+            memcpy(&s, &substitution[k], lane_count);
+        }
+        memcpy(&v, vertical + k, lane_count);
+        memcpy(&h, horizontal + k, lane_count);
+
+        PWA_lanes left = v + gap;
+        PWA_lanes up   = h + gap;
+        PWA_lanes z    = (s > left) ? s : left;
+        z = (z > up) ? z : up;
+
+        PWA_lanes new_v = z - h;
+        PWA_lanes new_h = z - v;
+        PWA_lanes not_diagonal = (z != s) & ones;
+        PWA_lanes code = not_diagonal + (not_diagonal & (z != left) & ones);
+
+        memcpy(new_vertical + k, &new_v, lane_count);
+        memcpy(new_horizontal + k, &new_h, lane_count);
+        memcpy(step + k, &code, lane_count);
+    }
+
+    for (; k < count; k++)
+    {
+        int s = unit_scoring ? ((chars_1[k] == chars_2[k]) ? 1 : -1)
+                             : substitution[k];
+        int left = vertical[k] + gap_penalty;
+        int up   = horizontal[k] + gap_penalty;
+        int z    = max(max(s, left), up);
+
+        new_vertical[k]   = z - horizontal[k];
+        new_horizontal[k] = z - vertical[k];
+        step[k] = (z == s) ? 0 : (z == left) ? 1 : 2;
+    }
+
+}   // End PWA_difference::compute_diagonal().
+
+
+/*=======================================================================*/
+/* Method: PWA_difference::trace_back_diagonals()                        */
+/*-----------------------------------------------------------------------*/
+/* Follows the steps from the last cell back to the first and returns    */
+/* them as an M/I/D step string in alignment order.                      */
+/*=======================================================================*/
+string PWA_difference::trace_back_diagonals(void)
+{
+    string path = "";
+    int    i    = length_2;
+    int    j    = length_1;
+
+    while ((i > 0) && (j > 0))
+    {
+        int d  = i + j;
+        int lo = max(1, d - length_2);
+
+        switch (steps[diagonal_offset[d] + (j - lo)])
+        {
+            case 0:  path += 'M'; i--; j--; break;
+            case 1:  path += 'D'; j--;      break;
+            default: path += 'I'; i--;      break;
+        }
+    }
+    path.append(j, 'D');
+    path.append(i, 'I');
+
+    reverse(path.begin(), path.end());
+
+    return (path);
+
+}   // End PWA_difference::trace_back_diagonals().
@@ -0,0 +1,44 @@
+#ifndef PWA_DIFFERENCE_H
+#define PWA_DIFFERENCE_H
+
+#include "PWA_alignment.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_difference
+{
+public:
+    PWA_difference();
+    static bool fits_in_8_bits(PWA_alignment *PWA_obj);
+    void begin_difference_alignment(PWA_alignment *PWA_obj);
+
+private:
+    bool fill_diagonals(void);
+    void compute_diagonal(int d, int lo, int hi);
+    string trace_back_diagonals(void);
+
+    string       sequence_1;    // Columns of the matrix.
+    string       reverse_2;     // Rows of the matrix, last row first.
+    int          length_1, length_2;
+    const int   *score_table;
+    bool         unit_scoring;  // +1/-1, compared instead of looked up.
+    signed char  gap_penalty;
+    int          final_score;
+    PWA_alignment *limit_obj;   // Checks time_limit after each diagonal.
+
+    // Score differences of the previous and current anti-diagonal,
+    // indexed by column: vertical H(i,j) - H(i-1,j) and horizontal
+    // H(i,j) - H(i,j-1).
+    vector<signed char> vertical_previous, vertical_current;
+    vector<signed char> horizontal_previous, horizontal_current;
+    vector<signed char> substitution;   // Scores along one diagonal.
+
+    vector<long>          diagonal_offset;  // Start of each diagonal.
+    vector<unsigned char> steps;            // 0 D, 1 L, 2 U per cell.
+
+};  // PWA_difference
+
+#endif  // PWA_DIFFERENCE_H
@@ -5,7 +5,9 @@
 /* Handles all file operations and stores all filenames used in PWA.     */
 /*=======================================================================*/
 #include "PWA_alignment.h"
+#include "PWA_diagonal.h"
 #include "PWA_file.h"
+#include "PWA_store.h"
 
 #include <iostream>
 #include <fstream>
@@ -33,9 +35,15 @@ using namespace std;
 /*=======================================================================*/
 PWA_file::PWA_file()
 {
-    input_filename   = '\0';
-    output_filename  = '\0';
-    scoring_filename = '\0';
+    input_filename   = NULL;
+    output_filename  = NULL;
+    scoring_filename = NULL;
+    cache_filename   = NULL;
+    checkpoint_filename = NULL;
+    progress_filename   = NULL;
+    queries_filename    = NULL;
+
+    record_pending   = 0;
 
 }   // End PWA_file::PWA_file().
 
@@ -117,8 +125,9 @@ void PWA_file::get_scoring_map(PWA_alignment *protein_obj)
 /* into sequences_vector and names_vector, respectively. The contents    */
 /* of names_vector will be included in the final output.                 */
 /*                                                                       */
-/* If the input file contains more than two sequences, only the first    */
-/* two sequences are aligned.                                            */
+/* The whole file is read into a packed PWA_store, and only the two      */
+/* records that are aligned are decoded. If the input file contains      */
+/* more than two sequences, only the first two sequences are aligned.    */
 /*                                                                       */
 /* Additionally contains debugging print statements of the contents of   */
 /* names_vector and sequences_vector after reading and saving from       */
@@ -126,35 +135,20 @@ void PWA_file::get_scoring_map(PWA_alignment *protein_obj)
 /*=======================================================================*/
 void PWA_file::get_contents_from_file(PWA_alignment *PWA_obj)
 {
-    string contents = "";
-    string line     = "";
-    fstream input_file;
-
-    input_filename = remove_hidden_end_characters(input_filename);
+    PWA_store store_obj;
+    string name     = "";
+    string sequence = "";
 
-    input_file.open(input_filename, fstream::in);
-    check_file_status(input_file, input_filename);
+    load_sequence_store(&store_obj);
 
-    while (getline(input_file, line))
+    for (long i = 0; (i < 2) && (i < store_obj.get_record_count()); i++)
     {
-        if (line.find(">") != string::npos)
-        {
-            // Add name of sequence to include in final output.
-            line.erase(line.find(">"), 1);
-            PWA_obj->names_vector.push_back(line);
+        store_obj.get_name(i, name);
+        store_obj.get_sequence(i, sequence);
 
-            if (contents != "")
-            {
-                PWA_obj->sequences_vector.push_back(contents);
-                contents.clear();
-            }
-        }
-        else
-        {
-            contents = contents + line;
-        }
+        PWA_obj->names_vector.push_back(name);
+        PWA_obj->sequences_vector.push_back(sequence);
     }
-    PWA_obj->sequences_vector.push_back(contents);
 
 #ifdef USEDEBUG_FILE
     // Print contents of names_vector.
@@ -172,12 +166,31 @@ void PWA_file::get_contents_from_file(PWA_alignment *PWA_obj)
     debug(endl << endl);
 #endif
 
-    input_file.close();
-    remove(input_filename);
-
 }   // End PWA_file::get_contents_from_file().
 
 
+/*=======================================================================*/
+/* Method: PWA_file::load_sequence_store()                               */
+/*-----------------------------------------------------------------------*/
+/* Reads every record of input_filename into store_obj.                  */
+/*=======================================================================*/
+void PWA_file::load_sequence_store(PWA_store *store_obj)
+{
+    string name     = "";
+    string sequence = "";
+
+    open_record_stream();
+
+    while (get_next_record(name, sequence))
+    {
+        store_obj->add_record(name, sequence);
+    }
+
+    close_record_stream();
+
+}   // End PWA_file::load_sequence_store().
+
+
 /*=======================================================================*/
 /* Method: PWA_file::print_output_to_file()                              */
 /*-----------------------------------------------------------------------*/
@@ -194,50 +207,117 @@ void PWA_file::get_contents_from_file(PWA_alignment *PWA_obj)
 void PWA_file::print_output_to_file(PWA_alignment *PWA_obj)
 {
     fstream output_file;
-    int i = 0;
 
     output_file.open(output_filename, fstream::out | fstream::trunc);
     check_file_status(output_file, output_filename);
 
+    write_alignment_results(output_file, PWA_obj);
+
+    output_file.close();
+
+}   // End PWA_file::print_output_to_file().
+
+
+/*=======================================================================*/
+/* Method: PWA_file::write_alignment_results()                           */
+/*-----------------------------------------------------------------------*/
+/* Writes the results of one alignment to output_file: the header with   */
+/* the sequence names, the sequence alignment split into lines of        */
+/* line_length, and the totals. Shared by print_output_to_file() and     */
+/* the batch writer so that every alignment block looks the same.        */
+/*=======================================================================*/
+void PWA_file::write_alignment_results(ostream &output_file,
+                                       PWA_alignment *PWA_obj)
+{
+    int i = 0;
+
     // Print names.
     output_file << "Alignment results for:" << endl;
     output_file << "1. " << PWA_obj->names_vector[0] << endl;
     output_file << "2. " << PWA_obj->names_vector[1];
+    if (PWA_obj->both_strands == 1)
+    {
+        output_file << endl << "Strand: " << PWA_obj->strand;
+        if (PWA_obj->strand == '-')
+        {
+            output_file << " (reverse complement of sequence 2)";
+        }
+    }
     output_file << endl << endl;
 
-    // Print sequence alignment.
-    for (vector<string>::iterator it = PWA_obj->sequences_vector.begin();
-         it != PWA_obj->sequences_vector.end(); ++it)
+    if (PWA_obj->alignment_status == PWA_alignment::status_below_min_score)
+    {
+        // Abandoned pairs have neither an alignment nor a final score.
+        output_file << "(Score below the minimum score of ";
+        output_file << PWA_obj->min_score << "; alignment abandoned.)";
+        output_file << endl << endl;
+        return;
+    }
+
+    if (PWA_obj->alignment_status == PWA_alignment::status_filtered)
+    {
+        output_file << "(No ungapped diagonal segment scoring at least ";
+        output_file << PWA_obj->diagonal_obj->min_diagonal_score;
+        output_file << "; alignment skipped.)" << endl << endl;
+        return;
+    }
+
+    if (PWA_obj->alignment_status == PWA_alignment::status_over_limit)
+    {
+        output_file << "(Alignment over its time or cell limit;";
+        output_file << " alignment abandoned.)" << endl << endl;
+        return;
+    }
+
+    if (PWA_obj->alignment_status == PWA_alignment::status_banded_fallback)
+    {
+        // Banded alignments are not always optimal, so say so.
+        output_file << "(Alignment over its time or cell limit;";
+        output_file << " banded alignment shown.)" << endl << endl;
+    }
+
+    if (PWA_obj->score_only == 1)
     {
-        if ((*it).length() > line_length)
+        // Score-only engines leave no alignment to print.
+        output_file << "(Score only; alignment not computed.)";
+        output_file << endl << endl;
+    }
+    else
+    {
+        // Print sequence alignment.
+        for (vector<string>::iterator it = PWA_obj->sequences_vector.begin();
+             it != PWA_obj->sequences_vector.end(); ++it)
         {
-              if ((i + line_length) < (*it).length())
-              {
-                  output_file << (*it).substr(i, line_length) << endl;
-                  if (it == PWA_obj->sequences_vector.end()-1)
+            if ((*it).length() > line_length)
+            {
+                  if ((i + line_length) < (*it).length())
                   {
+                      output_file << (*it).substr(i, line_length) << endl;
+                      if (it == PWA_obj->sequences_vector.end()-1)
+                      {
+                          output_file << endl;
+                          it = PWA_obj->sequences_vector.begin()-1;
+                          i +=line_length;
+                      }
+                  }
+                  else
+                  {
+                      output_file << (*it).substr(i, (*it).length() - \
+                                                  line_length);
                       output_file << endl;
-                      it = PWA_obj->sequences_vector.begin()-1;
-                      i +=line_length;
                   }
-              }
-              else
-              {
-                  output_file << (*it).substr(i, (*it).length() - \
-                                              line_length);
-                  output_file << endl;
-              }
-        }
-        else
-        {
-            output_file << *it << endl;
+            }
+            else
+            {
+                output_file << *it << endl;
+            }
         }
-    }
-    output_file << endl;
+        output_file << endl;
 
-    // Print total number of alignments. 
-    output_file << "Total number alignments: ";
-    output_file << PWA_obj->number_aligned << endl;
+        // Print total number of alignments. 
+        output_file << "Total number alignments: ";
+        output_file << PWA_obj->number_aligned << endl;
+    }
 
     // Print total alignment score.
     // For readability, also prints additional space
@@ -249,9 +329,7 @@ void PWA_file::print_output_to_file(PWA_alignment *PWA_obj)
     }
     output_file << PWA_obj->alignment_score << endl << endl;
 
-    output_file.close();
-
-}   // End PWA_file::print_output_to_file().
+}   // End PWA_file::write_alignment_results().
 
 
 /*=======================================================================*/
@@ -317,3 +395,87 @@ char* PWA_file::remove_hidden_end_characters(char *filename)
 
 }   // End PWA_file::remove_hidden_end_characters().
 
+
+
+/*=======================================================================*/
+/* Method: PWA_file::open_record_stream()                                */
+/*-----------------------------------------------------------------------*/
+/* Opens input_filename for reading one record at a time with            */
+/* get_next_record(). The input is not copied to a temporary file        */
+/* first: hidden \r characters are stripped line by line as the records  */
+/* are read, so inputs of any size are never held on disk twice.         */
+/*=======================================================================*/
+void PWA_file::open_record_stream(void)
+{
+    record_file.open(input_filename, fstream::in);
+    check_file_status(record_file, input_filename);
+
+    record_pending = 0;
+    pending_name.clear();
+
+}   // End PWA_file::open_record_stream().
+
+
+/*=======================================================================*/
+/* Method: PWA_file::get_next_record()                                   */
+/*-----------------------------------------------------------------------*/
+/* Reads the next FASTA record from the record stream into name and      */
+/* sequence. The header line of the following record is kept in          */
+/* pending_name so that it is not lost. Lines before the first header    */
+/* are kept as the start of the first sequence, not dropped (with no     */
+/* header at all, they are one record without a name). Returns 0 once    */
+/* the stream has no more records.                                       */
+/*=======================================================================*/
+bool PWA_file::get_next_record(string &name, string &sequence)
+{
+    string line = "";
+    bool   found_record = record_pending;
+
+    name = pending_name;
+    sequence.clear();
+    record_pending = 0;
+
+    while (getline(record_file, line))
+    {
+        while (!line.empty() && line[line.length()-1] == '\r')
+        {
+            line.erase(line.length()-1);
+        }
+
+        if (line.find(">") != string::npos)
+        {
+            line.erase(line.find(">"), 1);
+
+            if (found_record)
+            {
+                // Start of the next record; save its name for later.
+                pending_name   = line;
+                record_pending = 1;
+                return (1);
+            }
+
+            name = line;
+            found_record = 1;
+        }
+        else
+        {
+            sequence += line;
+        }
+    }
+
+    return (found_record || !sequence.empty());
+
+}   // End PWA_file::get_next_record().
+
+
+/*=======================================================================*/
+/* Method: PWA_file::close_record_stream()                               */
+/*-----------------------------------------------------------------------*/
+/* Closes the record stream opened by open_record_stream().              */
+/*=======================================================================*/
+void PWA_file::close_record_stream(void)
+{
+    record_file.close();
+    record_pending = 0;
+
+}   // End PWA_file::close_record_stream().
@@ -2,9 +2,11 @@
 #define PWA_FILE_H
 
 #include "PWA_alignment.h"
+#include "PWA_store.h"
 
 #include <fstream>
 #include <map>
+#include <ostream>
 #include <string>
 
 using namespace std;
@@ -16,16 +18,31 @@ public:
     void check_file_status(fstream &file, char *filename);
     void get_scoring_map(PWA_alignment *protein_obj);
     void get_contents_from_file(PWA_alignment *PWA_obj);
+    void load_sequence_store(PWA_store *store_obj);
     void print_output_to_file(PWA_alignment *PWA_obj);
+    void write_alignment_results(ostream &output_file,
+                                 PWA_alignment *PWA_obj);
     char *remove_hidden_end_characters(char *file_name);
 
+    void open_record_stream(void);
+    bool get_next_record(string &name, string &sequence);
+    void close_record_stream(void);
+
     char *input_filename;
     char *output_filename;
 	char *scoring_filename;
+    char *cache_filename;
+    char *checkpoint_filename;
+    char *progress_filename;
+    char *queries_filename;     // NULL unless --queries was given.
 
 private:
     static const int line_length = 50;
 
+    fstream  record_file;
+    string   pending_name;
+    bool     record_pending;
+
 };  // PWA_file
 
 #endif  // PWA_FILE_H
@@ -0,0 +1,592 @@
+/*=======================================================================*/
+/* Filename: PWA_incremental.cpp                                         */
+/*=======================================================================*/
+/* Incremental re-alignment of a pair whose sequences were edited at     */
+/* the end. Cell (i, j) of the nw matrix only depends on the first j     */
+/* characters of sequence 1 and the first i of sequence 2, so the        */
+/* top-left region covered by the unchanged prefixes is the same as in   */
+/* the previous run. Only the changed region, the rows below it and the  */
+/* columns to its right, is filled and held in memory.                   */
+/*                                                                       */
+/* After each run, every interval-th row and column of the matrix are    */
+/* saved to a checkpoint file. The interval is a power of two of at      */
+/* least 64, grown with sqrt(n * m / (n + m)), so the checkpoint holds   */
+/* about 2 * n * m / interval cells. On the next run, the reused region  */
+/* is rounded to these lines: its last row and column are all the fill   */
+/* of the changed region needs, and the traceback, where it enters the   */
+/* reused region, rebuilds the steps of one interval-square block at a   */
+/* time from the lines around it, about (n + m) * interval cells in all. */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_incremental.h"
+#include "PWA_message.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const char checkpoint_magic[8] = {'P','W','A','I','N','C','3','\n'};
+
+// Smallest distance between checkpoint lines.
+static const int min_interval = 64;
+
+
+/*=======================================================================*/
+/* Function: write_string() / read_string()                              */
+/*-----------------------------------------------------------------------*/
+/* Write and read a length-prefixed string in the checkpoint file.       */
+/*=======================================================================*/
+static void write_string(fstream &file, const string &text)
+{
+    long length = text.length();
+
+    file.write((char*)&length, sizeof(length));
+    file.write(text.data(), length);
+
+}   // End write_string().
+
+
+static bool read_string(fstream &file, string &text)
+{
+    long length = 0;
+
+    file.read((char*)&length, sizeof(length));
+    if (!file || (length < 0))
+    {
+        return (0);
+    }
+
+    text.resize(length);
+    if (length > 0)
+    {
+        file.read(&text[0], length);
+    }
+
+    return (!file.fail());
+
+}   // End read_string().
+
+
+/*=======================================================================*/
+/* Function: write_vector() / read_vector()                              */
+/*-----------------------------------------------------------------------*/
+/* Write and read a length-prefixed vector of int in the checkpoint      */
+/* file. read_vector() fails on a length other than expected_size, so a  */
+/* corrupt file never allocates more than its header promises.           */
+/*=======================================================================*/
+static void write_vector(fstream &file, const vector<int> &values)
+{
+    long size = values.size();
+
+    file.write((char*)&size, sizeof(size));
+    file.write((char*)values.data(), size * sizeof(int));
+
+}   // End write_vector().
+
+
+static bool read_vector(fstream &file, vector<int> &values,
+                        long expected_size)
+{
+    long size = 0;
+
+    file.read((char*)&size, sizeof(size));
+    if (!file || (size != expected_size))
+    {
+        return (0);
+    }
+
+    values.resize(size);
+    file.read((char*)values.data(), size * sizeof(int));
+
+    return (!file.fail());
+
+}   // End read_vector().
+
+
+/*=======================================================================*/
+/* Constructor: PWA_incremental                                          */
+/*-----------------------------------------------------------------------*/
+/* Initializes an incremental alignment with no checkpoint file.         */
+/*=======================================================================*/
+PWA_incremental::PWA_incremental()
+{
+    checkpoint_filename = NULL;
+    rows_reused         = 0;
+    columns_reused      = 0;
+
+    score_table  = NULL;
+    gap_penalty  = -2;
+    width        = 0;
+    height       = 0;
+    interval     = min_interval;
+    block_top    = -1;
+    block_left   = -1;
+
+    old_width    = 0;
+    old_height   = 0;
+    old_interval = 0;
+
+}   // End PWA_incremental::PWA_incremental().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::begin_incremental_alignment()                */
+/*-----------------------------------------------------------------------*/
+/* Aligns the first pair of PWA_obj with the nw recurrence, filling only */
+/* the part of the matrix that the checkpoint of the previous run does   */
+/* not cover, saves a new checkpoint, and stores the alignment in        */
+/* PWA_obj exactly as trace_back_steps() and compute_alignment_score()   */
+/* would have stored it.                                                 */
+/*=======================================================================*/
+void PWA_incremental::begin_incremental_alignment(PWA_alignment *PWA_obj,
+                                                  PWA_message   *msg_obj)
+{
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    sequence_1  = PWA_obj->sequences_vector[0];
+    sequence_2  = PWA_obj->sequences_vector[1];
+    score_table = PWA_obj->score_table.data();
+    gap_penalty = PWA_obj->get_gap_penalty();
+    width       = sequence_1.length() + 1;
+    height      = sequence_2.length() + 1;
+    interval    = choose_interval();
+
+    rows_reused    = 0;
+    columns_reused = 0;
+    if (load_checkpoint(PWA_obj))
+    {
+        find_reusable_region();
+    }
+
+    fill_changed_region();
+
+    save_checkpoint(PWA_obj, msg_obj);
+
+    PWA_obj->apply_cigar_string(trace_back_steps());
+    PWA_obj->compute_alignment_score();
+
+    msg_obj->print_incremental_summary(rows_reused, height - 1,
+                                       columns_reused, width - 1);
+
+}   // End PWA_incremental::begin_incremental_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::choose_interval()                            */
+/*-----------------------------------------------------------------------*/
+/* Returns the distance between checkpoint lines for the current pair.   */
+/* The checkpoint costs about 2 * n * m / interval cells and the         */
+/* traceback rebuilds about (n + m) * interval, so the interval grows    */
+/* with sqrt(n * m / (n + m)). It is rounded up to a power of two so     */
+/* that small edits keep the interval, and with it the checkpoint, of    */
+/* the previous run.                                                     */
+/*=======================================================================*/
+int PWA_incremental::choose_interval(void)
+{
+    double balance = sqrt((double)width * height / (width + height));
+    int    result  = min_interval;
+
+    while (result < balance)
+    {
+        result *= 2;
+    }
+
+    return (result);
+
+}   // End PWA_incremental::choose_interval().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::load_checkpoint()                            */
+/*-----------------------------------------------------------------------*/
+/* Reads the checkpoint of the previous run. Returns 0 if there is no    */
+/* checkpoint, if it cannot be read, or if it was made with a different  */
+/* scoring scheme or interval, in which case nothing can be reused.      */
+/*=======================================================================*/
+bool PWA_incremental::load_checkpoint(PWA_alignment *PWA_obj)
+{
+    fstream checkpoint_file;
+    char    magic[8];
+    string  scoring_scheme = "";
+
+    checkpoint_file.open(checkpoint_filename, fstream::in | fstream::binary);
+    if (checkpoint_file.fail())
+    {
+        return (0);
+    }
+
+    checkpoint_file.read(magic, sizeof(magic));
+    if (!checkpoint_file ||
+        !equal(magic, magic + sizeof(magic), checkpoint_magic))
+    {
+        return (0);
+    }
+
+    checkpoint_file.read((char*)&old_interval, sizeof(old_interval));
+    if (!checkpoint_file || (old_interval != interval) ||
+        !read_string(checkpoint_file, scoring_scheme) ||
+        (scoring_scheme != PWA_obj->get_scoring_scheme()) ||
+        !read_string(checkpoint_file, old_sequence_1) ||
+        !read_string(checkpoint_file, old_sequence_2))
+    {
+        return (0);
+    }
+
+    old_width  = old_sequence_1.length() + 1;
+    old_height = old_sequence_2.length() + 1;
+
+    long old_rows    = ((old_height - 1) / old_interval) + 1;
+    long old_columns = ((old_width - 1) / old_interval) + 1;
+
+    return (read_vector(checkpoint_file, old_row_checkpoints,
+                        old_rows * old_width) &&
+            read_vector(checkpoint_file, old_column_checkpoints,
+                        old_columns * old_height));
+
+}   // End PWA_incremental::load_checkpoint().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::find_reusable_region()                       */
+/*-----------------------------------------------------------------------*/
+/* All cells up to the common prefix lengths are unchanged. The region   */
+/* is rounded down to the last checkpoint row and column, whose values   */
+/* are needed to restart the fill. If either prefix is shorter than one  */
+/* interval, there is nothing to reuse.                                  */
+/*=======================================================================*/
+void PWA_incremental::find_reusable_region(void)
+{
+    size_t prefix_1 = 0;
+    size_t prefix_2 = 0;
+
+    while ((prefix_1 < sequence_1.length()) &&
+           (prefix_1 < old_sequence_1.length()) &&
+           (sequence_1[prefix_1] == old_sequence_1[prefix_1]))
+    {
+        prefix_1++;
+    }
+
+    while ((prefix_2 < sequence_2.length()) &&
+           (prefix_2 < old_sequence_2.length()) &&
+           (sequence_2[prefix_2] == old_sequence_2[prefix_2]))
+    {
+        prefix_2++;
+    }
+
+    columns_reused = (prefix_1 / interval) * interval;
+    rows_reused    = (prefix_2 / interval) * interval;
+
+    if ((columns_reused == 0) || (rows_reused == 0))
+    {
+        columns_reused = 0;
+        rows_reused    = 0;
+    }
+
+}   // End PWA_incremental::find_reusable_region().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::get_cell_score()                             */
+/*-----------------------------------------------------------------------*/
+/* Returns the score of cell (i, j) from the scores of its diagonal,     */
+/* left and up neighbours, and stores in step the direction it came      */
+/* from, chosen in the same order as get_step_direction(): diagonal,     */
+/* left, then up.                                                        */
+/*=======================================================================*/
+int PWA_incremental::get_cell_score(int diagonal, int left, int up,
+                                    int i, int j, char *step)
+{
+    int char_1 = (unsigned char)sequence_1[j-1];
+    int char_2 = (unsigned char)sequence_2[i-1];
+
+    diagonal += score_table[(char_1 << 8) | char_2];
+    left     += gap_penalty;
+    up       += gap_penalty;
+
+    int best = max(max(diagonal, left), up);
+
+    if (best == diagonal)
+    {
+        *step = 'D';
+    }
+    else if (best == left)
+    {
+        *step = 'L';
+    }
+    else
+    {
+        *step = 'U';
+    }
+
+    return (best);
+
+}   // End PWA_incremental::get_cell_score().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::get_row_offset()                             */
+/*-----------------------------------------------------------------------*/
+/* Returns where the steps of row i (from 1) start in steps. Rows 1 to   */
+/* rows_reused hold columns columns_reused + 1 to width - 1, and the     */
+/* rows below them columns 1 to width - 1.                               */
+/*=======================================================================*/
+long PWA_incremental::get_row_offset(int i)
+{
+    long right_width = width - 1 - columns_reused;
+
+    if (i <= rows_reused)
+    {
+        return ((long)(i - 1) * right_width);
+    }
+
+    return (((long)rows_reused * right_width) +
+            ((long)(i - rows_reused - 1) * (width - 1)));
+
+}   // End PWA_incremental::get_row_offset().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::fill_changed_region()                        */
+/*-----------------------------------------------------------------------*/
+/* Fills the matrix one row at a time, keeping two rows of scores, the   */
+/* steps of the changed region and the checkpoint lines of the whole     */
+/* matrix. In rows 1 to rows_reused only the columns right of the        */
+/* reused region are computed, starting from the old checkpoint of       */
+/* column columns_reused; row rows_reused is then completed from the     */
+/* old checkpoint of that row for the rows below. The checkpoint lines   */
+/* inside the reused region are copied from the old checkpoint.          */
+/*=======================================================================*/
+void PWA_incremental::fill_changed_region(void)
+{
+    int rows    = ((height - 1) / interval) + 1;
+    int columns = ((width - 1) / interval) + 1;
+
+    vector<int> previous_row(width);
+    vector<int> current_row(width);
+
+    row_checkpoints.assign((size_t)rows * width, 0);
+    column_checkpoints.assign((size_t)columns * height, 0);
+    steps.resize(get_row_offset(height));
+    block_top  = -1;
+    block_left = -1;
+
+    for (int j = 0; j < width; j++)
+    {
+        previous_row[j]    = j * gap_penalty;
+        row_checkpoints[j] = previous_row[j];
+    }
+    for (int c = 0; c < width; c += interval)
+    {
+        column_checkpoints[(size_t)(c / interval) * height] =
+            previous_row[c];
+    }
+
+    for (int i = 1; i < height; i++)
+    {
+        bool reused       = (i <= rows_reused);
+        int  first_column = reused ? columns_reused : 0;
+        long row_start    = get_row_offset(i) - (first_column + 1);
+
+        current_row[first_column] = reused
+            ? old_column_checkpoints[(size_t)(first_column / interval) *
+                                     old_height + i]
+            : i * gap_penalty;
+
+        for (int j = first_column + 1; j < width; j++)
+        {
+            current_row[j] = get_cell_score(previous_row[j-1],
+                                            current_row[j-1],
+                                            previous_row[j], i, j,
+                                            &steps[row_start + j]);
+        }
+
+        if (reused && ((i % interval) == 0))
+        {
+            const int *old_row = &old_row_checkpoints[(size_t)
+                                 (i / interval) * old_width];
+            copy(old_row, old_row + columns_reused, current_row.begin());
+        }
+
+        for (int c = 0; c < width; c += interval)
+        {
+            column_checkpoints[(size_t)(c / interval) * height + i] =
+                (reused && (c < columns_reused))
+                ? old_column_checkpoints[(size_t)(c / interval) *
+                                         old_height + i]
+                : current_row[c];
+        }
+        if ((i % interval) == 0)
+        {
+            copy(current_row.begin(), current_row.end(),
+                 row_checkpoints.begin() + (size_t)(i / interval) * width);
+        }
+
+        previous_row.swap(current_row);
+    }
+
+}   // End PWA_incremental::fill_changed_region().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::fill_reused_block()                          */
+/*-----------------------------------------------------------------------*/
+/* Rebuilds block_steps for the interval-square block of the reused      */
+/* region below row top and right of column left. Its top row and left   */
+/* column are checkpoint lines, so the block gives the same steps as     */
+/* the full fill.                                                        */
+/*=======================================================================*/
+void PWA_incremental::fill_reused_block(int top, int left)
+{
+    vector<int> row(row_checkpoints.begin() +
+                        (size_t)(top / interval) * width + left,
+                    row_checkpoints.begin() +
+                        (size_t)(top / interval) * width + left +
+                        interval + 1);
+    const int *column = &column_checkpoints[(size_t)(left / interval) *
+                                            height + top];
+
+    block_steps.resize((size_t)interval * interval);
+
+    for (int r = 1; r <= interval; r++)
+    {
+        int diagonal = row[0];
+
+        row[0] = column[r];
+        for (int c = 1; c <= interval; c++)
+        {
+            int up = row[c];
+
+            row[c] = get_cell_score(diagonal, row[c-1], up,
+                                    top + r, left + c,
+                                    &block_steps[(size_t)(r - 1) *
+                                                 interval + (c - 1)]);
+            diagonal = up;
+        }
+    }
+
+    block_top  = top;
+    block_left = left;
+
+}   // End PWA_incremental::fill_reused_block().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::get_step()                                   */
+/*-----------------------------------------------------------------------*/
+/* Returns the step of cell (i, j), i and j from 1: from steps in the    */
+/* changed region, or from the rebuilt block holding it in the reused    */
+/* region, rebuilding that block first if needed.                        */
+/*=======================================================================*/
+char PWA_incremental::get_step(int i, int j)
+{
+    if ((i > rows_reused) || (j > columns_reused))
+    {
+        int first_column = (i <= rows_reused) ? columns_reused + 1 : 1;
+        return (steps[get_row_offset(i) + (j - first_column)]);
+    }
+
+    int top  = ((i - 1) / interval) * interval;
+    int left = ((j - 1) / interval) * interval;
+
+    if ((top != block_top) || (left != block_left))
+    {
+        fill_reused_block(top, left);
+    }
+
+    return (block_steps[(size_t)(i - top - 1) * interval +
+                        (j - left - 1)]);
+
+}   // End PWA_incremental::get_step().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::trace_back_steps()                           */
+/*-----------------------------------------------------------------------*/
+/* Follows the steps from the last cell to the origin, row 0 and column  */
+/* 0 stepping left and up, and returns the alignment as a string of      */
+/* steps for apply_cigar_string().                                       */
+/*=======================================================================*/
+string PWA_incremental::trace_back_steps(void)
+{
+    string reversed_steps = "";
+    int    i = height - 1;
+    int    j = width - 1;
+
+    while ((i > 0) && (j > 0))
+    {
+        char step = get_step(i, j);
+
+        if (step == 'D')
+        {
+            reversed_steps.push_back('M');
+            i--;
+            j--;
+        }
+        else if (step == 'L')
+        {
+            reversed_steps.push_back('D');
+            j--;
+        }
+        else
+        {
+            reversed_steps.push_back('I');
+            i--;
+        }
+    }
+    reversed_steps.append(j, 'D');
+    reversed_steps.append(i, 'I');
+
+    return (string(reversed_steps.rbegin(), reversed_steps.rend()));
+
+}   // End PWA_incremental::trace_back_steps().
+
+
+/*=======================================================================*/
+/* Method: PWA_incremental::save_checkpoint()                            */
+/*-----------------------------------------------------------------------*/
+/* Saves the interval, the scoring scheme, both sequences and the        */
+/* checkpoint lines for the next run. The steps are not saved; the next  */
+/* traceback rebuilds the few blocks it needs. The file is written to a  */
+/* temporary name first so that a failed run keeps the previous          */
+/* checkpoint.                                                           */
+/*=======================================================================*/
+void PWA_incremental::save_checkpoint(PWA_alignment *PWA_obj,
+                                      PWA_message   *msg_obj)
+{
+    fstream checkpoint_file;
+    string  tmp_filename = string(checkpoint_filename) + ".tmp";
+
+    checkpoint_file.open(tmp_filename.c_str(),
+                         fstream::out | fstream::trunc | fstream::binary);
+    if (checkpoint_file.fail())
+    {
+        msg_obj->print_checkpoint_write_error(checkpoint_filename);
+        return;
+    }
+
+    checkpoint_file.write(checkpoint_magic, sizeof(checkpoint_magic));
+    checkpoint_file.write((char*)&interval, sizeof(interval));
+    write_string(checkpoint_file, PWA_obj->get_scoring_scheme());
+    write_string(checkpoint_file, sequence_1);
+    write_string(checkpoint_file, sequence_2);
+    write_vector(checkpoint_file, row_checkpoints);
+    write_vector(checkpoint_file, column_checkpoints);
+
+    checkpoint_file.close();
+    if (checkpoint_file.fail() ||
+        (rename(tmp_filename.c_str(), checkpoint_filename) != 0))
+    {
+        remove(tmp_filename.c_str());
+        msg_obj->print_checkpoint_write_error(checkpoint_filename);
+    }
+
+}   // End PWA_incremental::save_checkpoint().
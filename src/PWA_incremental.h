@@ -0,0 +1,63 @@
+#ifndef PWA_INCREMENTAL_H
+#define PWA_INCREMENTAL_H
+
+#include "PWA_alignment.h"
+#include "PWA_message.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_incremental
+{
+public:
+    PWA_incremental();
+    void begin_incremental_alignment(PWA_alignment *PWA_obj,
+                                     PWA_message   *msg_obj);
+
+    char *checkpoint_filename;
+    int   rows_reused;
+    int   columns_reused;
+
+private:
+    int  choose_interval(void);
+    bool load_checkpoint(PWA_alignment *PWA_obj);
+    void find_reusable_region(void);
+    void fill_changed_region(void);
+    void save_checkpoint(PWA_alignment *PWA_obj, PWA_message *msg_obj);
+    string trace_back_steps(void);
+    char get_step(int i, int j);
+    void fill_reused_block(int top, int left);
+    int  get_cell_score(int diagonal, int left, int up, int i, int j,
+                        char *step);
+    long get_row_offset(int i);
+
+    string       sequence_1;    // Columns of the matrix.
+    string       sequence_2;    // Rows of the matrix.
+    const int   *score_table;
+    int          gap_penalty;
+    int          width, height;
+    int          interval;      // Distance between checkpoint lines.
+
+    // Every interval-th row and column of the matrix, in full.
+    vector<int>  row_checkpoints;
+    vector<int>  column_checkpoints;
+
+    // Steps of the changed region only, row by row (see
+    // get_row_offset()), and of the last reused block rebuilt.
+    vector<char> steps;
+    vector<char> block_steps;
+    int          block_top, block_left;
+
+    // Checkpoint of the previous run.
+    string       old_sequence_1;
+    string       old_sequence_2;
+    int          old_width, old_height;
+    int          old_interval;
+    vector<int>  old_row_checkpoints;
+    vector<int>  old_column_checkpoints;
+
+};  // PWA_incremental
+
+#endif  // PWA_INCREMENTAL_H
@@ -0,0 +1,247 @@
+/*=======================================================================*/
+/* Filename: PWA_interleave.cpp                                          */
+/*=======================================================================*/
+/* Fills the nw matrices of a group of independent batch pairs together. */
+/* A single fill waits on memory for every new row it writes and for     */
+/* the rows of the previous one that have left the cache. Here each      */
+/* pair is a lane that fills segment_cells cells and then yields to the  */
+/* next lane, after prefetching the cells it will read and write when    */
+/* its turn comes again. While the other lanes compute, the prefetches   */
+/* complete, so the stalls of one alignment are hidden behind the work   */
+/* of the others.                                                        */
+/*                                                                       */
+/* Every lane fills its own matrix and steps exactly as                  */
+/* PWA_alignment::fill_alignment_matrix() does, so the alignments are    */
+/* the same as those of the nw engine, one pair at a time.               */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_interleave.h"
+#include "PWA_scheduler.h"
+#include "PWA_strand.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+// Ints and bytes per cache line.
+static const int line_ints  = 16;
+static const int line_bytes = 64;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_interleave                                           */
+/*-----------------------------------------------------------------------*/
+/* Initializes an interleaver with no lanes.                             */
+/*=======================================================================*/
+PWA_interleave::PWA_interleave()
+{
+    lanes.reserve(group_size);
+
+}   // End PWA_interleave::PWA_interleave().
+
+
+/*=======================================================================*/
+/* Method: PWA_interleave::can_interleave()                              */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if the pair of PWA_obj would be aligned by the in-memory nw */
+/* fill without any per-pair checks (cache, planner, diagonal filter,    */
+/* minimum score, limits or profile), and its matrix is medium-sized:    */
+/* too large to stay in cache, too small to be filled in tiles.          */
+/*=======================================================================*/
+bool PWA_interleave::can_interleave(PWA_alignment *PWA_obj)
+{
+    long cells = (long)(PWA_obj->sequences_vector[0].length() + 1) *
+                 (PWA_obj->sequences_vector[1].length() + 1);
+
+    if ((PWA_obj->engine != "nw") || !PWA_obj->traceback_filename.empty() ||
+        (PWA_obj->cache_obj != NULL) || (PWA_obj->planner_obj != NULL) ||
+        (PWA_obj->diagonal_obj != NULL) || (PWA_obj->profile_obj != NULL) ||
+        (PWA_obj->min_score_specified == 1) ||
+        (PWA_obj->time_limit > 0) || (PWA_obj->cell_limit > 0))
+    {
+        return (0);
+    }
+
+    if ((PWA_obj->scheduler_obj != NULL) &&
+        PWA_obj->scheduler_obj->can_fill_in_tiles(cells))
+    {
+        return (0);
+    }
+
+    return ((cells >= min_cells) && (cells <= max_cells));
+
+}   // End PWA_interleave::can_interleave().
+
+
+/*=======================================================================*/
+/* Method: PWA_interleave::begin_interleaved_alignments()                */
+/*-----------------------------------------------------------------------*/
+/* Aligns the pair of each object in group, which must all pass          */
+/* can_interleave(), and stores each alignment and score in its object,  */
+/* as begin_PWA_alignment() would.                                       */
+/*=======================================================================*/
+void PWA_interleave::begin_interleaved_alignments(
+    vector<PWA_alignment*> &group)
+{
+    lanes.clear();
+    for (size_t g = 0; g < group.size(); g++)
+    {
+        PWA_lane lane;
+        set_up_lane(group[g], lane);
+        if (lane.row < lane.height)
+        {
+            lanes.push_back(lane);
+            prefetch_segment(lane);
+        }
+    }
+
+    // Round robin until every lane is done; a finished lane leaves.
+    while (!lanes.empty())
+    {
+        size_t k = 0;
+        while (k < lanes.size())
+        {
+            fill_segment(lanes[k]);
+            if (lanes[k].row < lanes[k].height)
+            {
+                prefetch_segment(lanes[k]);
+                k++;
+            }
+            else
+            {
+                lanes.erase(lanes.begin() + k);
+            }
+        }
+    }
+
+    for (size_t g = 0; g < group.size(); g++)
+    {
+        PWA_alignment *PWA_obj = group[g];
+
+        PWA_obj->steps_count = (long)PWA_obj->width * PWA_obj->height;
+        PWA_obj->trace_back_steps();
+        PWA_obj->compute_alignment_score();
+    }
+
+}   // End PWA_interleave::begin_interleaved_alignments().
+
+
+/*=======================================================================*/
+/* Method: PWA_interleave::set_up_lane()                                 */
+/*-----------------------------------------------------------------------*/
+/* Chooses the strand of PWA_obj if asked to, sizes its matrix, fills    */
+/* the first row and column, and points lane at the first other cell.    */
+/*=======================================================================*/
+void PWA_interleave::set_up_lane(PWA_alignment *PWA_obj, PWA_lane &lane)
+{
+    if (PWA_obj->both_strands == 1)
+    {
+        PWA_strand strand_obj;
+        strand_obj.choose_strand(PWA_obj);
+    }
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    PWA_obj->resize_alignment_matrix();
+
+    lane.PWA_obj     = PWA_obj;
+    lane.matrix      = PWA_obj->alignment_matrix;
+    lane.steps       = PWA_obj->steps_buffer;
+    lane.sequence_1  = PWA_obj->sequences_vector[0].data();
+    lane.sequence_2  = PWA_obj->sequences_vector[1].data();
+    lane.score_table = PWA_obj->score_table.data();
+    lane.gap_penalty = PWA_obj->gap_penalty;
+    lane.width       = PWA_obj->width;
+    lane.height      = PWA_obj->height;
+    lane.row         = 1;
+    lane.column      = 1;
+
+    for (int j = 0; j < lane.width; j++)
+    {
+        lane.matrix[0][j] = j * lane.gap_penalty;
+        lane.steps[j]     = 'L';
+    }
+    for (int i = 1; i < lane.height; i++)
+    {
+        lane.matrix[i][0] = i * lane.gap_penalty;
+        lane.steps[(long)i * lane.width] = 'U';
+    }
+
+    // A single column has nothing left to fill.
+    if (lane.width == 1)
+    {
+        lane.row = lane.height;
+    }
+
+}   // End PWA_interleave::set_up_lane().
+
+
+/*=======================================================================*/
+/* Method: PWA_interleave::fill_segment()                                */
+/*-----------------------------------------------------------------------*/
+/* Fills up to segment_cells cells of the current row of lane, choosing  */
+/* the diagonal, then left, then up step on ties, and moves the lane on  */
+/* (to the next row at the end of this one).                             */
+/*=======================================================================*/
+void PWA_interleave::fill_segment(PWA_lane &lane)
+{
+    int   i        = lane.row;
+    int  *row      = lane.matrix[i];
+    int  *previous = lane.matrix[i-1];
+    char *steps    = lane.steps + ((long)i * lane.width);
+    int   char_2   = (unsigned char)lane.sequence_2[i-1];
+    int   last     = min(lane.width, lane.column + segment_cells);
+
+    for (int j = lane.column; j < last; j++)
+    {
+        int char_1   = (unsigned char)lane.sequence_1[j-1];
+        int diagonal = previous[j-1] + lane.score_table[(char_1 << 8) | char_2];
+        int left     = row[j-1] + lane.gap_penalty;
+        int up       = previous[j] + lane.gap_penalty;
+        int best     = max(max(diagonal, left), up);
+
+        row[j]   = best;
+        steps[j] = (best == diagonal) ? 'D' : (best == left) ? 'L' : 'U';
+    }
+
+    lane.column = last;
+    if (lane.column == lane.width)
+    {
+        lane.row++;
+        lane.column = 1;
+    }
+
+}   // End PWA_interleave::fill_segment().
+
+
+/*=======================================================================*/
+/* Method: PWA_interleave::prefetch_segment()                            */
+/*-----------------------------------------------------------------------*/
+/* Asks for the cache lines the next fill_segment() of lane reads (the   */
+/* previous row and sequence 1) and writes (its row and steps).          */
+/*=======================================================================*/
+void PWA_interleave::prefetch_segment(const PWA_lane &lane)
+{
+    int   i        = lane.row;
+    int  *row      = lane.matrix[i];
+    int  *previous = lane.matrix[i-1];
+    char *steps    = lane.steps + ((long)i * lane.width);
+    int   last     = min(lane.width, lane.column + segment_cells);
+
+    for (int j = lane.column; j < last + line_ints - 1; j += line_ints)
+    {
+        int k = min(j, last - 1);
+        __builtin_prefetch(&previous[k], 0);
+        __builtin_prefetch(&row[k], 1);
+    }
+    for (int j = lane.column; j < last + line_bytes - 1; j += line_bytes)
+    {
+        int k = min(j, last - 1);
+        __builtin_prefetch(&steps[k], 1);
+        __builtin_prefetch(&lane.sequence_1[k - 1], 0);
+    }
+
+}   // End PWA_interleave::prefetch_segment().
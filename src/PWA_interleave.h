@@ -0,0 +1,48 @@
+#ifndef PWA_INTERLEAVE_H
+#define PWA_INTERLEAVE_H
+
+#include "PWA_alignment.h"
+
+#include <vector>
+
+using namespace std;
+
+// One alignment of a group and the next cell of its matrix to fill.
+struct PWA_lane
+{
+    PWA_alignment *PWA_obj;
+    int       **matrix;
+    char       *steps;          // D, L or U for each cell, row by row.
+    const char *sequence_1;     // Columns of the matrix.
+    const char *sequence_2;     // Rows of the matrix.
+    const int  *score_table;    // See PWA_alignment::build_score_table().
+    int         gap_penalty;
+    int         width, height;
+    int         row, column;
+};
+
+class PWA_interleave
+{
+public:
+    PWA_interleave();
+    static bool can_interleave(PWA_alignment *PWA_obj);
+    void begin_interleaved_alignments(vector<PWA_alignment*> &group);
+
+    // Alignments filled together, and cells filled before switching.
+    static const int  group_size    = 4;
+    static const int  segment_cells = 256;
+
+    // Smaller matrices stay in cache anyway; larger ones are tiled.
+    static const long min_cells     = 65536;
+    static const long max_cells     = 4000000;
+
+private:
+    void set_up_lane(PWA_alignment *PWA_obj, PWA_lane &lane);
+    void fill_segment(PWA_lane &lane);
+    void prefetch_segment(const PWA_lane &lane);
+
+    vector<PWA_lane> lanes;     // Alignments still being filled.
+
+};  // PWA_interleave
+
+#endif  // PWA_INTERLEAVE_H
@@ -0,0 +1,426 @@
+/*=======================================================================*/
+/* Filename: PWA_linear.cpp                                              */
+/*=======================================================================*/
+/* Linear-space engines. begin_linear_alignment() uses Hirschberg's      */
+/* divide-and-conquer algorithm: the middle row of the matrix is split   */
+/* at the column where the forward scores of the upper half and the      */
+/* reverse scores of the lower half add up to the best total, and both   */
+/* halves are aligned recursively. Only a few rows of scores are held    */
+/* at a time, at the cost of computing each cell about twice.            */
+/*                                                                       */
+/* begin_score_only() computes only the final score, keeping one row.    */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_linear.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_linear                                               */
+/*-----------------------------------------------------------------------*/
+/* Initializes an empty linear-space engine.                             */
+/*=======================================================================*/
+PWA_linear::PWA_linear()
+{
+    score_table = NULL;
+    gap_penalty = -2;
+    bound_obj   = NULL;
+    limit_obj   = NULL;
+    stopped     = 0;
+
+}   // End PWA_linear::PWA_linear().
+
+
+/*=======================================================================*/
+/* Method: PWA_linear::begin_linear_alignment()                          */
+/*-----------------------------------------------------------------------*/
+/* Aligns the two sequences of PWA_obj in linear space and stores the    */
+/* alignment and score in PWA_obj. If the time limit of PWA_obj passes   */
+/* first, sets status_over_limit and stores nothing.                     */
+/*=======================================================================*/
+void PWA_linear::begin_linear_alignment(PWA_alignment *PWA_obj)
+{
+    set_up_sequences(PWA_obj);
+
+    steps.clear();
+    steps.reserve(sequence_1.length() + sequence_2.length());
+
+    align_region(0, sequence_2.length(), 0, sequence_1.length());
+
+    if (stopped)
+    {
+        PWA_obj->alignment_status = PWA_alignment::status_over_limit;
+        return;
+    }
+
+    PWA_obj->apply_cigar_string(steps);
+    PWA_obj->alignment_score = get_steps_score();
+
+}   // End PWA_linear::begin_linear_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_linear::begin_score_only()                                */
+/*-----------------------------------------------------------------------*/
+/* Computes only the alignment score of the two sequences of PWA_obj,    */
+/* which is the last cell of the last row. With min_score_specified,     */
+/* stops as soon as the minimum score can no longer be reached; with a   */
+/* time limit, as soon as it has passed.                                 */
+/*=======================================================================*/
+void PWA_linear::begin_score_only(PWA_alignment *PWA_obj)
+{
+    vector<int> row;
+
+    set_up_sequences(PWA_obj);
+
+    if (PWA_obj->min_score_specified == 1)
+    {
+        bound_obj = PWA_obj;
+    }
+
+    if (!compute_forward_row(0, sequence_2.length(),
+                             0, sequence_1.length(), row))
+    {
+        PWA_obj->alignment_status = stopped
+                                  ? PWA_alignment::status_over_limit
+                                  : PWA_alignment::status_below_min_score;
+        return;
+    }
+
+    PWA_obj->alignment_score = row[sequence_1.length()];
+    PWA_obj->number_aligned  = 0;
+    PWA_obj->score_only      = 1;
+
+}   // End PWA_linear::begin_score_only().
+
+
+/*=======================================================================*/
+/* Method: PWA_linear::set_up_sequences()                                */
+/*-----------------------------------------------------------------------*/
+/* Copies the sequences, scoring settings and time limit from PWA_obj.   */
+/*=======================================================================*/
+void PWA_linear::set_up_sequences(PWA_alignment *PWA_obj)
+{
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    sequence_1  = PWA_obj->sequences_vector[0];
+    sequence_2  = PWA_obj->sequences_vector[1];
+    score_table = PWA_obj->score_table.data();
+    gap_penalty = PWA_obj->get_gap_penalty();
+
+    if (PWA_obj->time_limit > 0)
+    {
+        limit_obj = PWA_obj;
+    }
+
+}   // End PWA_linear::set_up_sequences().
+
+
+/*=======================================================================*/
+/* Method: PWA_linear::compute_forward_row()                             */
+/*-----------------------------------------------------------------------*/
+/* Fills row with the last row of the matrix aligning rows row_start to  */
+/* row_end - 1 of sequence_2 against columns column_start to             */
+/* column_end - 1 of sequence_1: row[k] is the best score of aligning    */
+/* those rows with the first k of those columns. Returns 0 if bound_obj  */
+/* is set and the rows were abandoned below its minimum score, or if     */
+/* the time limit passed (stopped is then set).                          */
+/*=======================================================================*/
+bool PWA_linear::compute_forward_row(int row_start, int row_end,
+                                     int column_start, int column_end,
+                                     vector<int> &row)
+{
+    int columns = column_end - column_start;
+
+    row.resize(columns + 1);
+    for (int k = 0; k <= columns; k++)
+    {
+        row[k] = k * gap_penalty;
+    }
+
+    for (int i = row_start; i < row_end; i++)
+    {
+        int char_2   = (unsigned char)sequence_2[i];
+        int diagonal = row[0];
+
+        row[0] = (i - row_start + 1) * gap_penalty;
+
+        for (int k = 1; k <= columns; k++)
+        {
+            int char_1 = (unsigned char)sequence_1[column_start + k - 1];
+            int up     = row[k];
+            int score  = diagonal + score_table[(char_1 << 8) | char_2];
+
+            score    = max(score, row[k-1] + gap_penalty);
+            score    = max(score, up + gap_penalty);
+            diagonal = up;
+            row[k]   = score;
+        }
+
+        if ((bound_obj != NULL) &&
+            !bound_obj->can_reach_min_score(row.data(), columns,
+                                            row_end - i - 1))
+        {
+            return (0);
+        }
+
+        if ((limit_obj != NULL) && limit_obj->exceeds_time_limit())
+        {
+            stopped = 1;
+            return (0);
+        }
+    }
+
+    return (1);
+
+}   // End PWA_linear::compute_forward_row().
+
+
+/*=======================================================================*/
+/* Method: PWA_linear::compute_reverse_row()                             */
+/*-----------------------------------------------------------------------*/
+/* Same as compute_forward_row(), but aligning the sequences from their  */
+/* ends: row[k] is the best score of aligning rows row_start to          */
+/* row_end - 1 with the last k of the columns. Stops early, setting      */
+/* stopped, if the time limit passes.                                    */
+/*=======================================================================*/
+void PWA_linear::compute_reverse_row(int row_start, int row_end,
+                                     int column_start, int column_end,
+                                     vector<int> &row)
+{
+    int columns = column_end - column_start;
+
+    row.resize(columns + 1);
+    for (int k = 0; k <= columns; k++)
+    {
+        row[k] = k * gap_penalty;
+    }
+
+    for (int i = row_end - 1; i >= row_start; i--)
+    {
+        int char_2   = (unsigned char)sequence_2[i];
+        int diagonal = row[0];
+
+        row[0] = (row_end - i) * gap_penalty;
+
+        for (int k = 1; k <= columns; k++)
+        {
+            int char_1 = (unsigned char)sequence_1[column_end - k];
+            int up     = row[k];
+            int score  = diagonal + score_table[(char_1 << 8) | char_2];
+
+            score    = max(score, row[k-1] + gap_penalty);
+            score    = max(score, up + gap_penalty);
+            diagonal = up;
+            row[k]   = score;
+        }
+
+        if ((limit_obj != NULL) && limit_obj->exceeds_time_limit())
+        {
+            stopped = 1;
+            return;
+        }
+    }
+
+}   // End PWA_linear::compute_reverse_row().
+
+
+/*=======================================================================*/
+/* Method: PWA_linear::align_region()                                    */
+/*-----------------------------------------------------------------------*/
+/* Appends to steps the optimal alignment of the given rows of           */
+/* sequence_2 and columns of sequence_1. Small regions are aligned       */
+/* directly; larger regions are split at the middle row. Does nothing    */
+/* once stopped.                                                         */
+/*=======================================================================*/
+void PWA_linear::align_region(int row_start, int row_end,
+                              int column_start, int column_end)
+{
+    int rows    = row_end - row_start;
+    int columns = column_end - column_start;
+
+    if (stopped)
+    {
+        return;
+    }
+    if (rows == 0)
+    {
+        steps.append(columns, 'D');
+        return;
+    }
+    if (columns == 0)
+    {
+        steps.append(rows, 'I');
+        return;
+    }
+    if ((rows == 1) ||
+        ((long)(rows + 1) * (columns + 1) <= small_region_cells))
+    {
+        align_small_region(row_start, row_end, column_start, column_end);
+        return;
+    }
+
+    int middle_row   = row_start + (rows / 2);
+    int split_column = column_start;
+    {
+        vector<int> forward_row;
+        vector<int> reverse_row;
+        int best_score = 0;
+
+        compute_forward_row(row_start, middle_row,
+                            column_start, column_end, forward_row);
+        compute_reverse_row(middle_row, row_end,
+                            column_start, column_end, reverse_row);
+        if (stopped)
+        {
+            return;
+        }
+
+        for (int k = 0; k <= columns; k++)
+        {
+            int score = forward_row[k] + reverse_row[columns - k];
+
+            if ((k == 0) || (score > best_score))
+            {
+                best_score   = score;
+                split_column = column_start + k;
+            }
+        }
+    }
+
+    align_region(row_start, middle_row, column_start, split_column);
+    align_region(middle_row, row_end, split_column, column_end);
+
+}   // End PWA_linear::align_region().
+
+
+/*=======================================================================*/
+/* Method: PWA_linear::align_small_region()                              */
+/*-----------------------------------------------------------------------*/
+/* Aligns a small region with a full matrix and appends the steps found  */
+/* by tracing back from its bottom-right corner. Directions are chosen   */
+/* in the same order as get_step_direction(): diagonal, left, then up.   */
+/*=======================================================================*/
+void PWA_linear::align_small_region(int row_start, int row_end,
+                                    int column_start, int column_end)
+{
+    int rows    = row_end - row_start;
+    int columns = column_end - column_start;
+    int width   = columns + 1;
+
+    vector<int>  scores((size_t)(rows + 1) * width);
+    vector<char> directions((size_t)(rows + 1) * width);
+
+    for (int j = 0; j <= columns; j++)
+    {
+        scores[j]     = j * gap_penalty;
+        directions[j] = 'L';
+    }
+
+    for (int i = 1; i <= rows; i++)
+    {
+        int char_2 = (unsigned char)sequence_2[row_start + i - 1];
+
+        scores[i * width]     = i * gap_penalty;
+        directions[i * width] = 'U';
+
+        for (int j = 1; j <= columns; j++)
+        {
+            int char_1   = (unsigned char)sequence_1[column_start + j - 1];
+            int diagonal = scores[(i-1) * width + j - 1] +
+                           score_table[(char_1 << 8) | char_2];
+            int left     = scores[i * width + j - 1] + gap_penalty;
+            int up       = scores[(i-1) * width + j] + gap_penalty;
+            int best     = max(max(diagonal, left), up);
+
+            scores[i * width + j] = best;
+            if (best == diagonal)
+            {
+                directions[i * width + j] = 'D';
+            }
+            else if (best == left)
+            {
+                directions[i * width + j] = 'L';
+            }
+            else
+            {
+                directions[i * width + j] = 'U';
+            }
+        }
+    }
+
+    // Trace back and append the steps in forward order.
+    string region_steps = "";
+    int i = rows;
+    int j = columns;
+
+    while ((i > 0) || (j > 0))
+    {
+        char direction = directions[i * width + j];
+
+        if (direction == 'D')
+        {
+            region_steps.push_back('M');
+            i--;
+            j--;
+        }
+        else if (direction == 'L')
+        {
+            region_steps.push_back('D');
+            j--;
+        }
+        else
+        {
+            region_steps.push_back('I');
+            i--;
+        }
+    }
+
+    steps.append(region_steps.rbegin(), region_steps.rend());
+
+}   // End PWA_linear::align_small_region().
+
+
+/*=======================================================================*/
+/* Method: PWA_linear::get_steps_score()                                 */
+/*-----------------------------------------------------------------------*/
+/* Returns the score of the alignment in steps.                          */
+/*=======================================================================*/
+int PWA_linear::get_steps_score(void)
+{
+    int    score      = 0;
+    size_t position_1 = 0;
+    size_t position_2 = 0;
+
+    for (size_t k = 0; k < steps.length(); k++)
+    {
+        if (steps[k] == 'M')
+        {
+            int char_1 = (unsigned char)sequence_1[position_1++];
+            int char_2 = (unsigned char)sequence_2[position_2++];
+
+            score += score_table[(char_1 << 8) | char_2];
+        }
+        else if (steps[k] == 'D')
+        {
+            score += gap_penalty;
+            position_1++;
+        }
+        else
+        {
+            score += gap_penalty;
+            position_2++;
+        }
+    }
+
+    return (score);
+
+}   // End PWA_linear::get_steps_score().
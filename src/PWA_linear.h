@@ -0,0 +1,46 @@
+#ifndef PWA_LINEAR_H
+#define PWA_LINEAR_H
+
+#include "PWA_alignment.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_linear
+{
+public:
+    PWA_linear();
+    void begin_linear_alignment(PWA_alignment *PWA_obj);
+    void begin_score_only(PWA_alignment *PWA_obj);
+
+private:
+    void set_up_sequences(PWA_alignment *PWA_obj);
+    bool compute_forward_row(int row_start, int row_end,
+                             int column_start, int column_end,
+                             vector<int> &row);
+    void compute_reverse_row(int row_start, int row_end,
+                             int column_start, int column_end,
+                             vector<int> &row);
+    void align_region(int row_start, int row_end,
+                      int column_start, int column_end);
+    void align_small_region(int row_start, int row_end,
+                            int column_start, int column_end);
+    int  get_steps_score(void);
+
+    // Regions up to this many cells are aligned with a full matrix.
+    static const long small_region_cells = 16384;
+
+    string      sequence_1;     // Columns of the matrix.
+    string      sequence_2;     // Rows of the matrix.
+    const int  *score_table;
+    int         gap_penalty;
+    PWA_alignment *bound_obj;   // Checks min_score after each row.
+    PWA_alignment *limit_obj;   // Checks time_limit after each row.
+    bool        stopped;        // The time limit has passed.
+    string      steps;          // M, D or I for each alignment column.
+
+};  // PWA_linear
+
+#endif  // PWA_LINEAR_H
@@ -6,17 +6,339 @@
 /* alignment based on the user's command-line option selections.         */
 /*=======================================================================*/
 #include "PWA_alignment.h"
+#include "PWA_benchmark.h"
+#include "PWA_cache.h"
+#include "PWA_diagonal.h"
 #include "PWA_file.h"
+#include "PWA_incremental.h"
 #include "PWA_message.h"
 #include "PWA_option.h"
+#include "PWA_pipeline.h"
+#include "PWA_planner.h"
+#include "PWA_prefilter.h"
+#include "PWA_profile.h"
+#include "PWA_shard.h"
 #include "PWA_time.h"
 
 #include <iostream>
 #include <stdlib.h>
+#include <string.h>
 
 using namespace std;
 
 
+/*=======================================================================*/
+/* Function: align_sequences()                                           */
+/*-----------------------------------------------------------------------*/
+/* Aligns the sequences in the input file with PWA_obj. By default only  */
+/* the first pair is aligned; in batch mode the first sequence is        */
+/* aligned against every other sequence through the pipeline, or with    */
+/* --queries, every sequence against each query of the queries file. In  */
+/* incremental mode the first pair is aligned reusing the checkpoint of  */
+/* the previous run.                                                     */
+/*                                                                       */
+/* With a memory budget, a planner chooses the engine for each pair and  */
+/* the chosen plan is reported before the alignment starts.              */
+/*                                                                       */
+/* If a cache file was specified, results of earlier runs are reused     */
+/* and new results are saved to it once all alignments are done.         */
+/*                                                                       */
+/* With --matrix, all-vs-all mode writes a binary score or distance      */
+/* matrix instead of the alignments, using the score-only engine unless  */
+/* another was chosen.                                                   */
+/*                                                                       */
+/* With --diagonal-filter, nucleotide pairs are screened by an ungapped  */
+/* diagonal scan first, and the pairs it decided are reported at the     */
+/* end.                                                                  */
+/*                                                                       */
+/* With --profile, hardware counters are read around reading the input,  */
+/* each phase of the alignment (or the whole batch pipeline, whose       */
+/* phases overlap) and writing the output, and reported at the end.      */
+/*=======================================================================*/
+static void align_sequences(PWA_option    *option_obj,
+                            PWA_file      *file_obj,
+                            PWA_message   *msg_obj,
+                            PWA_alignment *PWA_obj)
+{
+    PWA_cache   *cache_obj   = NULL;
+    PWA_profile *profile_obj = NULL;
+    PWA_diagonal *diagonal_obj = NULL;
+
+    if (option_obj->profile_specified == 1)
+    {
+        profile_obj = new PWA_profile();
+        profile_obj->open_counters();
+    }
+
+    if (file_obj->cache_filename != NULL)
+    {
+        cache_obj = new PWA_cache();
+
+        if (option_obj->cache_size_mb > 0)
+        {
+            cache_obj->max_cache_bytes = option_obj->cache_size_mb *
+                                         1024 * 1024;
+        }
+
+        cache_obj->load_cache(file_obj->cache_filename);
+        cache_obj->set_scoring_scheme(PWA_obj);
+        PWA_obj->cache_obj = cache_obj;
+    }
+
+    if (option_obj->max_memory_bytes > 0)
+    {
+        PWA_planner *planner_obj = new PWA_planner();
+
+        planner_obj->max_memory_bytes  = option_obj->max_memory_bytes;
+        planner_obj->memory_per_thread = option_obj->max_memory_bytes;
+        planner_obj->band_width        = option_obj->band_width;
+        planner_obj->traceback_on_disk =
+            !option_obj->traceback_filename.empty();
+        PWA_obj->planner_obj = planner_obj;
+    }
+
+    if ((option_obj->diagonal_filter_specified == 1) &&
+        (option_obj->chosen_option == 'n'))
+    {
+        diagonal_obj = new PWA_diagonal();
+        diagonal_obj->min_diagonal_score = option_obj->min_diagonal_score;
+        PWA_obj->diagonal_obj = diagonal_obj;
+    }
+
+    if ((option_obj->batch_specified == 1) ||
+        (option_obj->all_vs_all_specified == 1) ||
+        (file_obj->queries_filename != NULL))
+    {
+        PWA_pipeline *pipeline_obj = new PWA_pipeline();
+
+        if (profile_obj != NULL)
+        {
+            profile_obj->begin_phase("batch");
+        }
+        // Workers add their own profiles to it (see PWA_pipeline).
+        PWA_obj->profile_obj = profile_obj;
+
+        if (option_obj->number_of_threads > 0)
+        {
+            pipeline_obj->number_of_threads = option_obj->number_of_threads;
+            pipeline_obj->threads_specified = 1;
+        }
+        pipeline_obj->pin_threads    = option_obj->pin_threads;
+        pipeline_obj->report_workers = option_obj->profile_specified;
+        pipeline_obj->interleave_pairs = option_obj->interleave_pairs;
+
+        if (option_obj->number_of_shards > 0)
+        {
+            pipeline_obj->shard_obj = new PWA_shard();
+            pipeline_obj->shard_obj->shard_index = option_obj->shard_index;
+            pipeline_obj->shard_obj->number_of_shards =
+                option_obj->number_of_shards;
+        }
+
+        if (file_obj->progress_filename != NULL)
+        {
+            pipeline_obj->progress_filename = file_obj->progress_filename;
+            pipeline_obj->resume_specified  = option_obj->resume_specified;
+        }
+
+        if (option_obj->all_vs_all_specified == 1)
+        {
+            PWA_prefilter *prefilter_obj = new PWA_prefilter();
+            if (option_obj->min_similarity >= 0)
+            {
+                prefilter_obj->min_similarity = option_obj->min_similarity;
+            }
+
+            if (option_obj->matrix_specified == 1)
+            {
+                // Only scores are kept, and nw gives the same ones.
+                if (PWA_obj->engine == "nw")
+                {
+                    PWA_obj->engine = "score";
+                }
+                pipeline_obj->run_score_matrix(file_obj, PWA_obj,
+                                               prefilter_obj, msg_obj,
+                                               option_obj->matrix_type);
+            }
+            else
+            {
+                pipeline_obj->run_all_vs_all(file_obj, PWA_obj,
+                                             prefilter_obj, msg_obj);
+            }
+        }
+        else if (file_obj->queries_filename != NULL)
+        {
+            pipeline_obj->run_multi_query(file_obj, PWA_obj, msg_obj);
+        }
+        else
+        {
+            pipeline_obj->run_one_vs_many(file_obj, PWA_obj, msg_obj);
+        }
+    }
+    else if (file_obj->checkpoint_filename != NULL)
+    {
+        PWA_incremental *incremental_obj = new PWA_incremental();
+        incremental_obj->checkpoint_filename = file_obj->checkpoint_filename;
+
+        if (profile_obj != NULL)
+        {
+            profile_obj->begin_phase("read input");
+        }
+        file_obj->get_contents_from_file(PWA_obj);
+        if (PWA_obj->sequences_vector.size() < 2)
+        {
+            msg_obj->print_not_enough_sequences();
+        }
+
+        if (profile_obj != NULL)
+        {
+            profile_obj->begin_phase("incremental");
+        }
+        incremental_obj->begin_incremental_alignment(PWA_obj, msg_obj);
+
+        if (profile_obj != NULL)
+        {
+            profile_obj->begin_phase("write output");
+        }
+        file_obj->print_output_to_file(PWA_obj);
+    }
+    else
+    {
+        if (profile_obj != NULL)
+        {
+            profile_obj->begin_phase("read input");
+        }
+        file_obj->get_contents_from_file(PWA_obj);
+        if (PWA_obj->sequences_vector.size() < 2)
+        {
+            msg_obj->print_not_enough_sequences();
+        }
+
+        if (profile_obj != NULL)
+        {
+            profile_obj->end_phase();
+        }
+
+        if (PWA_obj->planner_obj != NULL)
+        {
+            long predicted_bytes = 0;
+            string engine = PWA_obj->planner_obj->plan_alignment(
+                                PWA_obj->sequences_vector[0].length(),
+                                PWA_obj->sequences_vector[1].length(),
+                                &predicted_bytes);
+
+            msg_obj->print_memory_plan(engine, predicted_bytes,
+                                       option_obj->max_memory_bytes, 1);
+            if (predicted_bytes > option_obj->max_memory_bytes)
+            {
+                msg_obj->print_memory_exceeded(predicted_bytes,
+                                               option_obj->max_memory_bytes);
+            }
+        }
+
+        PWA_obj->profile_obj = profile_obj;
+        PWA_obj->begin_PWA_alignment(msg_obj);
+
+        if (profile_obj != NULL)
+        {
+            profile_obj->begin_phase("write output");
+        }
+        file_obj->print_output_to_file(PWA_obj);
+    }
+
+    if (cache_obj != NULL)
+    {
+        cache_obj->save_cache(msg_obj);
+        msg_obj->print_cache_summary(cache_obj->cache_hits,
+                                     cache_obj->cache_misses);
+    }
+
+    if (diagonal_obj != NULL)
+    {
+        msg_obj->print_diagonal_summary(diagonal_obj->pairs_accepted,
+                                        diagonal_obj->pairs_rejected,
+                                        diagonal_obj->min_diagonal_score);
+    }
+
+    if (profile_obj != NULL)
+    {
+        profile_obj->close_counters();
+        msg_obj->print_profile_report(profile_obj->get_report());
+    }
+
+}   // End align_sequences().
+
+
+/*=======================================================================*/
+/* Function: run_benchmark()                                             */
+/*-----------------------------------------------------------------------*/
+/* Runs the --benchmark corpus through every engine, checks the engines  */
+/* agree with nw and the diagonal filter keeps the related pairs, and    */
+/* either compares the results with the baseline file                    */
+/* or, with --update-baseline, writes it. Returns 1 if nothing           */
+/* regressed.                                                            */
+/*=======================================================================*/
+static bool run_benchmark(PWA_option  *option_obj,
+                          PWA_file    *file_obj,
+                          PWA_message *msg_obj)
+{
+    PWA_benchmark benchmark_obj;
+    PWA_alignment nucleotide_obj;
+    PWA_alignment protein_obj;
+    string baseline_filename = option_obj->benchmark_filename;
+    int regressions = 0;
+
+    if (option_obj->time_tolerance >= 0)
+    {
+        benchmark_obj.time_tolerance = option_obj->time_tolerance / 100;
+    }
+    if (option_obj->memory_tolerance >= 0)
+    {
+        benchmark_obj.memory_tolerance = option_obj->memory_tolerance / 100;
+    }
+
+    // The default for a pwa built in src/.
+    if (file_obj->scoring_filename == NULL)
+    {
+        file_obj->scoring_filename =
+            strdup("../scoring_matrices/BLOSUM62.txt");
+    }
+    file_obj->get_scoring_map(&protein_obj);
+
+    if ((option_obj->update_baseline == 0) &&
+        !benchmark_obj.load_baseline(baseline_filename))
+    {
+        msg_obj->print_baseline_error(baseline_filename);
+    }
+
+    benchmark_obj.build_corpus();
+    benchmark_obj.run_benchmark(&nucleotide_obj, &protein_obj);
+
+    int mismatches = benchmark_obj.check_scores();
+    int rejections = benchmark_obj.check_diagonal_filter(&nucleotide_obj);
+    if (option_obj->update_baseline == 1)
+    {
+        if ((mismatches == 0) && (rejections == 0) &&
+            !benchmark_obj.save_baseline(baseline_filename))
+        {
+            msg_obj->print_baseline_error(baseline_filename);
+        }
+    }
+    else
+    {
+        regressions = benchmark_obj.compare_with_baseline();
+    }
+
+    msg_obj->print_benchmark_report(benchmark_obj.get_report());
+    msg_obj->print_benchmark_summary(regressions, mismatches, rejections,
+                                     baseline_filename,
+                                     option_obj->update_baseline);
+
+    return ((regressions == 0) && (mismatches == 0) && (rejections == 0));
+
+}   // End run_benchmark().
+
+
 /*=======================================================================*/
 /* Function: main()                                                      */
 /*-----------------------------------------------------------------------*/
@@ -31,19 +353,39 @@ int main(int argc, char *argv[])
 
     option_obj->parse_command_line(argc, argv, file_obj, msg_obj);
 
-    if (option_obj->chosen_option == 'n')
+    if (!option_obj->benchmark_filename.empty())
+    {
+        // Scripts check the exit status, so it says whether it passed.
+        return (run_benchmark(option_obj, file_obj, msg_obj) ? 0 : 2);
+    }
+
+    if (option_obj->merge_shards > 0)
+    {
+        PWA_shard shard_obj;
+        shard_obj.merge_shards(file_obj->output_filename,
+                               option_obj->merge_shards, msg_obj);
+    }
+    else if (option_obj->chosen_option == 'n')
     {
         msg_obj->print_option_selected("Nucleotide",
                                        file_obj->input_filename);
 
         PWA_alignment *nucleotide_obj = new PWA_alignment();
+        nucleotide_obj->engine = option_obj->engine;
+        nucleotide_obj->band_width = option_obj->band_width;
+        nucleotide_obj->xdrop      = option_obj->xdrop;
+        nucleotide_obj->both_strands = option_obj->both_strands;
+        nucleotide_obj->traceback_filename = option_obj->traceback_filename;
+        nucleotide_obj->min_score_specified = option_obj->min_score_specified;
+        nucleotide_obj->min_score  = option_obj->min_score;
+        nucleotide_obj->time_limit = option_obj->time_limit;
+        nucleotide_obj->cell_limit = option_obj->cell_limit;
+        nucleotide_obj->limit_fallback = option_obj->limit_fallback;
 
         // Note: 'scoring_specified' is 0 because no scoring matrix
         // for nucleotide PWA in this project.
 
-        file_obj->get_contents_from_file(nucleotide_obj);
-        nucleotide_obj->begin_PWA_alignment(msg_obj);
-        file_obj->print_output_to_file(nucleotide_obj);
+        align_sequences(option_obj, file_obj, msg_obj, nucleotide_obj);
     }
     else if (option_obj->chosen_option == 'p')
     {
@@ -51,15 +393,22 @@ int main(int argc, char *argv[])
                                        file_obj->input_filename);
 
         PWA_alignment *protein_obj = new PWA_alignment();
+        protein_obj->engine = option_obj->engine;
+        protein_obj->band_width = option_obj->band_width;
+        protein_obj->xdrop      = option_obj->xdrop;
+        protein_obj->traceback_filename = option_obj->traceback_filename;
+        protein_obj->min_score_specified = option_obj->min_score_specified;
+        protein_obj->min_score  = option_obj->min_score;
+        protein_obj->time_limit = option_obj->time_limit;
+        protein_obj->cell_limit = option_obj->cell_limit;
+        protein_obj->limit_fallback = option_obj->limit_fallback;
 
         if (option_obj->scoring_specified == 1)
         {
             file_obj->get_scoring_map(protein_obj);
         }
 
-        file_obj->get_contents_from_file(protein_obj);
-        protein_obj->begin_PWA_alignment(msg_obj);
-        file_obj->print_output_to_file(protein_obj);
+        align_sequences(option_obj, file_obj, msg_obj, protein_obj);
     }
     else
     {
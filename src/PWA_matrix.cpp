@@ -0,0 +1,252 @@
+/*=======================================================================*/
+/* Filename: PWA_matrix.cpp                                              */
+/*=======================================================================*/
+/* Writes the binary all-vs-all matrix of --matrix. The file is laid     */
+/* out so that it can be mapped and indexed directly:                    */
+/*     header: a PWA_matrix_header (64 bytes);                           */
+/*     values: one 4-byte value per pair (i, j), i < j, row by row:      */
+/*             (0, 1), ..., (0, n-1), (1, 2), ..., (n-2, n-1);           */
+/*     names:  the record names in input order, each ending in '\n'.     */
+/* Values are int32 scores or float32 distances, as value_type says.     */
+/*                                                                       */
+/* The file is sized when it is created, so every block of rows has a    */
+/* fixed place in it and workers write their own blocks with pwrite(),   */
+/* in any order and without locking.                                     */
+/*=======================================================================*/
+#include "PWA_matrix.h"
+#include "PWA_store.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// Passed by reference (push_back()), so it needs a definition.
+const int32_t PWA_matrix::missing_score;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_matrix                                               */
+/*-----------------------------------------------------------------------*/
+/* Initializes a score matrix with no file open.                         */
+/*=======================================================================*/
+PWA_matrix::PWA_matrix()
+{
+    value_type    = value_score;
+    matrix_fd     = -1;
+    record_count  = 0;
+    values_offset = 0;
+
+}   // End PWA_matrix::PWA_matrix().
+
+
+/*=======================================================================*/
+/* Destructor: PWA_matrix                                                */
+/*-----------------------------------------------------------------------*/
+/* Closes the file if it is still open.                                  */
+/*=======================================================================*/
+PWA_matrix::~PWA_matrix()
+{
+    if (matrix_fd >= 0)
+    {
+        close(matrix_fd);
+    }
+
+}   // End PWA_matrix::~PWA_matrix().
+
+
+/*=======================================================================*/
+/* Method: PWA_matrix::create_matrix_file()                              */
+/*-----------------------------------------------------------------------*/
+/* Creates filename for the records of store_obj, writes the header and  */
+/* the names, and reserves the space of every value. Returns 0 if the    */
+/* file cannot be created or the disk has no room for it.                */
+/*=======================================================================*/
+bool PWA_matrix::create_matrix_file(const char *filename,
+                                    PWA_store *store_obj)
+{
+    PWA_matrix_header header;
+    string names = "";
+    string name  = "";
+
+    record_count  = store_obj->get_record_count();
+    values_offset = sizeof(header);
+
+    for (long i = 0; i < record_count; i++)
+    {
+        store_obj->get_name(i, name);
+        names += name + "\n";
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "PWAMATRX", sizeof(header.magic));
+    header.version       = 1;
+    header.value_type    = value_type;
+    header.record_count  = record_count;
+    header.values_offset = values_offset;
+    header.names_offset  = values_offset +
+                           get_value_index(record_count - 1, 0) *
+                           sizeof(int32_t);
+    header.names_bytes   = names.length();
+
+    matrix_fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (matrix_fd < 0)
+    {
+        return (0);
+    }
+
+    if ((posix_fallocate(matrix_fd, 0,
+                         header.names_offset + header.names_bytes) != 0) ||
+        (pwrite(matrix_fd, &header, sizeof(header), 0) !=
+         (ssize_t)sizeof(header)) ||
+        (pwrite(matrix_fd, names.data(), names.length(),
+                header.names_offset) != (ssize_t)names.length()))
+    {
+        return (0);
+    }
+
+    return (1);
+
+}   // End PWA_matrix::create_matrix_file().
+
+
+/*=======================================================================*/
+/* Method: PWA_matrix::set_self_scores()                                 */
+/*-----------------------------------------------------------------------*/
+/* Stores the score of each record aligned with itself, which distances  */
+/* are relative to.                                                      */
+/*=======================================================================*/
+void PWA_matrix::set_self_scores(const vector<int> &scores)
+{
+    self_scores = scores;
+
+}   // End PWA_matrix::set_self_scores().
+
+
+/*=======================================================================*/
+/* Method: PWA_matrix::get_value_index()                                 */
+/*-----------------------------------------------------------------------*/
+/* Returns the position, in values, of the pair (row, column), row <     */
+/* column. Row r holds n - 1 - r values, so the rows before it hold      */
+/*     r * (n - 1) - r * (r - 1) / 2                                     */
+/* values. get_value_index(n - 1, 0) is the number of values.            */
+/*=======================================================================*/
+long PWA_matrix::get_value_index(long row, long column)
+{
+    long row_start = (row * (record_count - 1)) - ((row * (row - 1)) / 2);
+
+    if (column <= row)
+    {
+        return (row_start);
+    }
+
+    return (row_start + (column - row - 1));
+
+}   // End PWA_matrix::get_value_index().
+
+
+/*=======================================================================*/
+/* Method: PWA_matrix::write_rows()                                      */
+/*-----------------------------------------------------------------------*/
+/* Writes scores, the values of whole rows from first_row on, to their   */
+/* place in the file, converting them to distances if asked to. The      */
+/* rows of one call are next to each other in the file, so this is a     */
+/* single write. Returns 0 if it fails.                                  */
+/*=======================================================================*/
+bool PWA_matrix::write_rows(long first_row, const vector<int> &scores)
+{
+    vector<int32_t> values(scores.size());
+
+    if (value_type == value_distance)
+    {
+        long row    = first_row;
+        long column = first_row + 1;
+
+        for (size_t k = 0; k < scores.size(); k++)
+        {
+            float distance = get_distance(row, column, scores[k]);
+            memcpy(&values[k], &distance, sizeof(distance));
+
+            if (++column == record_count)
+            {
+                row++;
+                column = row + 1;
+            }
+        }
+    }
+    else
+    {
+        for (size_t k = 0; k < scores.size(); k++)
+        {
+            values[k] = scores[k];
+        }
+    }
+
+    const char *bytes  = (const char *)values.data();
+    size_t      length = values.size() * sizeof(int32_t);
+    off_t       offset = values_offset +
+                         get_value_index(first_row, first_row + 1) *
+                         sizeof(int32_t);
+
+    while (length > 0)
+    {
+        ssize_t written = pwrite(matrix_fd, bytes, length, offset);
+        if (written <= 0)
+        {
+            return (0);
+        }
+        bytes  += written;
+        length -= written;
+        offset += written;
+    }
+
+    return (1);
+
+}   // End PWA_matrix::write_rows().
+
+
+/*=======================================================================*/
+/* Method: PWA_matrix::close_matrix_file()                               */
+/*-----------------------------------------------------------------------*/
+/* Closes the file. Returns 0 if not everything reached it.              */
+/*=======================================================================*/
+bool PWA_matrix::close_matrix_file(void)
+{
+    int status = close(matrix_fd);
+    matrix_fd = -1;
+
+    return (status == 0);
+
+}   // End PWA_matrix::close_matrix_file().
+
+
+/*=======================================================================*/
+/* Method: PWA_matrix::get_distance()                                    */
+/*-----------------------------------------------------------------------*/
+/* Returns the distance of the pair (row, column) with the given score:  */
+/*     1 - score / sqrt(self score of row * self score of column),       */
+/* limited to 0 to 1, so identical records are 0 apart and pairs that    */
+/* score 0 or less are 1 apart. A pair that was not aligned is NaN.      */
+/*=======================================================================*/
+float PWA_matrix::get_distance(long row, long column, int score)
+{
+    if (score == missing_score)
+    {
+        return (NAN);
+    }
+
+    if ((self_scores[row] <= 0) || (self_scores[column] <= 0))
+    {
+        return (1);
+    }
+
+    double self     = (double)self_scores[row] * self_scores[column];
+    double distance = 1 - (score / sqrt(self));
+
+    return ((float)fmin(1, fmax(0, distance)));
+
+}   // End PWA_matrix::get_distance().
@@ -0,0 +1,53 @@
+#ifndef PWA_MATRIX_H
+#define PWA_MATRIX_H
+
+#include "PWA_store.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// First 64 bytes of a matrix file, in the byte order of the machine
+// that wrote it.
+struct PWA_matrix_header
+{
+    char    magic[8];       // "PWAMATRX"
+    int32_t version;        // 1
+    int32_t value_type;     // PWA_matrix::value_score or value_distance
+    int64_t record_count;
+    int64_t values_offset;  // Bytes from the start of the file.
+    int64_t names_offset;
+    int64_t names_bytes;
+    int64_t reserved[2];
+};
+
+class PWA_matrix
+{
+public:
+    PWA_matrix();
+    ~PWA_matrix();
+    bool create_matrix_file(const char *filename, PWA_store *store_obj);
+    void set_self_scores(const vector<int> &scores);
+    long get_value_index(long row, long column);
+    bool write_rows(long first_row, const vector<int> &scores);
+    bool close_matrix_file(void);
+
+    int value_type;         // value_score or value_distance
+
+    static const int     value_score    = 0;    // int32 scores
+    static const int     value_distance = 1;    // float32 distances
+    static const int32_t missing_score  = INT32_MIN;   // Pair not aligned.
+
+private:
+    float get_distance(long row, long column, int score);
+
+    int  matrix_fd;         // -1 when no file is open.
+    long record_count;
+    long values_offset;
+    vector<int> self_scores;    // Each record against itself.
+
+};  // PWA_matrix
+
+#endif  // PWA_MATRIX_H
@@ -7,6 +7,7 @@
 #include "PWA_time.h"
 
 #include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <stdlib.h>
 #include <string>
@@ -54,6 +55,22 @@ void PWA_message::print_help_message(void)
     cout << endl;
     cout <<  "   ./PWA [-h] [-n FILE] [-p FILE]";
     cout << " [-s FILE] [-o FILE]" << endl;
+    cout <<  "         [--batch] [--threads N] [--queries FILE]" << endl;
+    cout <<  "         [--all-vs-all] [--min-similarity F]" << endl;
+    cout <<  "         [--matrix score|distance]" << endl;
+    cout <<  "         [--min-score S] [--both-strands]" << endl;
+    cout <<  "         [--diagonal-filter S]" << endl;
+    cout <<  "         [--time-limit SECONDS] [--cell-limit N]" << endl;
+    cout <<  "         [--on-limit banded|fail]" << endl;
+    cout <<  "         [--shard i/N] [--merge N]" << endl;
+    cout <<  "         [--progress FILE] [--resume]" << endl;
+    cout <<  "         [--cache FILE] [--cache-size MB]" << endl;
+    cout <<  "         [--incremental FILE] [--engine NAME]" << endl;
+    cout <<  "         [--band W] [--xdrop X] [--max-memory SIZE]" << endl;
+    cout <<  "         [--traceback-file FILE] [--profile] [--pin]" << endl;
+    cout <<  "         [--interleave]" << endl;
+    cout <<  "         [--benchmark FILE] [--update-baseline]" << endl;
+    cout <<  "         [--tolerance PCT] [--memory-tolerance PCT]" << endl;
     cout << endl;
 
     cout << "Options:" << endl;
@@ -85,13 +102,277 @@ void PWA_message::print_help_message(void)
     cout << "                     WARNING: If the output file chosen";
     cout << " already" << endl;
     cout << "                     exists, it will be overwritten.";
-    cout << endl << endl;
+    cout << endl;
+
+    cout << "    --batch        : Aligns the first sequence in FILE";
+    cout << " against" << endl;
+    cout << "                     every other sequence in FILE. Records";
+    cout << " are" << endl;
+    cout << "                     streamed, aligned in parallel and";
+    cout << " written" << endl;
+    cout << "                     in input order." << endl;
+
+    cout << "    --queries FILE : Aligns every sequence in the input";
+    cout << " FILE" << endl;
+    cout << "                     against each query in this FILE,";
+    cout << endl;
+    cout << "                     reading the input once. The results";
+    cout << endl;
+    cout << "                     of query k go to OUTPUT.qk, in input";
+    cout << endl;
+    cout << "                     order. --shard and --progress do not";
+    cout << endl;
+    cout << "                     apply." << endl;
+
+    cout << "    --all-vs-all   : Aligns every pair of sequences in";
+    cout << " FILE" << endl;
+    cout << "                     whose estimated k-mer similarity is";
+    cout << " at" << endl;
+    cout << "                     least F (see --min-similarity).";
+    cout << endl;
+
+    cout << "    --min-similarity F: Skips all-vs-all pairs whose";
+    cout << " MinHash" << endl;
+    cout << "                     Jaccard estimate is below F";
+    cout << " (default:" << endl;
+    cout << "                     0.05). 0 aligns every pair." << endl;
+
+    cout << "    --matrix score|distance: With --all-vs-all, writes only";
+    cout << endl;
+    cout << "                     the score of each pair (int32) or its";
+    cout << endl;
+    cout << "                     distance (float32) to -o FILE as a";
+    cout << endl;
+    cout << "                     binary upper-triangle matrix (see";
+    cout << endl;
+    cout << "                     README). --shard and --progress do";
+    cout << endl;
+    cout << "                     not apply." << endl;
+
+    cout << "    --min-score S  : Abandons pairs as soon as their score";
+    cout << endl;
+    cout << "                     can no longer reach S. In batch and";
+    cout << endl;
+    cout << "                     all-vs-all mode they are not written.";
+    cout << endl;
+
+    cout << "    --diagonal-filter S: Nucleotides only: scans the";
+    cout << " diagonals" << endl;
+    cout << "                     near the main one, 32 bases at a time,";
+    cout << endl;
+    cout << "                     before aligning. Pairs with no ungapped";
+    cout << endl;
+    cout << "                     segment scoring S are rejected (not";
+    cout << endl;
+    cout << "                     written in batch mode); equal-length";
+    cout << endl;
+    cout << "                     pairs whose ungapped alignment must be";
+    cout << endl;
+    cout << "                     optimal are accepted without aligning.";
+    cout << endl;
+
+    cout << "    --time-limit SECONDS: Stops any alignment still running";
+    cout << endl;
+    cout << "                     after SECONDS (banded alignments, the";
+    cout << endl;
+    cout << "                     fallback, are never stopped).";
+    cout << endl;
+
+    cout << "    --cell-limit N : Does not start full-matrix alignments";
+    cout << " of" << endl;
+    cout << "                     more than N cells, and stops wfa and";
+    cout << endl;
+    cout << "                     --xdrop overlap alignments after N cells.";
+    cout << endl;
+
+    cout << "    --on-limit ACTION: What to do with a pair over either";
+    cout << " limit:" << endl;
+    cout << "                       banded : align it with the banded";
+    cout << " engine" << endl;
+    cout << "                                instead (default)" << endl;
+    cout << "                       fail   : write a note instead of an";
+    cout << endl;
+    cout << "                                alignment" << endl;
+
+    cout << "    --both-strands : Nucleotides only: also aligns the";
+    cout << " reverse" << endl;
+    cout << "                     complement of the second sequence";
+    cout << " and" << endl;
+    cout << "                     reports the strand that scores best.";
+    cout << endl;
+
+    cout << "    --shard i/N    : Batch and all-vs-all only: aligns only";
+    cout << " the" << endl;
+    cout << "                     i-th of N shares of the pairs, balanced";
+    cout << endl;
+    cout << "                     by matrix size, into OUTPUT.i-of-N.";
+    cout << endl;
+
+    cout << "    --merge N      : Merges OUTPUT.1-of-N to OUTPUT.N-of-N";
+    cout << endl;
+    cout << "                     into OUTPUT (see -o) and exits.";
+    cout << endl;
+
+    cout << "    --progress FILE: Batch and all-vs-all only: saves the";
+    cout << " progress" << endl;
+    cout << "                     of the run to FILE every 1000 pairs";
+    cout << " or" << endl;
+    cout << "                     60 seconds." << endl;
+
+    cout << "    --resume       : With --progress: continues the run";
+    cout << " recorded" << endl;
+    cout << "                     in FILE, appending to its output.";
+    cout << endl;
+
+    cout << "    --threads N    : Uses N worker threads in batch and";
+    cout << endl;
+    cout << "                     all-vs-all mode (default: one per";
+    cout << " CPU)." << endl;
+    cout << "    --pin          : Batch and all-vs-all only: pins each";
+    cout << " worker" << endl;
+    cout << "                     thread to one CPU. Memory a worker";
+    cout << endl;
+    cout << "                     touches first is on its NUMA node;";
+    cout << endl;
+    cout << "                     tiles of large pairs land on the node";
+    cout << endl;
+    cout << "                     of whichever worker computes them.";
+    cout << endl;
+    cout << "    --interleave   : Batch and all-vs-all only: fills the nw";
+    cout << endl;
+    cout << "                     matrices of up to 4 medium-sized pairs";
+    cout << endl;
+    cout << "                     together, prefetching each one's rows";
+    cout << endl;
+    cout << "                     while the others are computed." << endl;
+
+    cout << "    --cache FILE   : Reuses alignments saved in FILE by";
+    cout << " earlier" << endl;
+    cout << "                     runs and saves new ones to it.";
+    cout << endl;
+
+    cout << "    --cache-size MB: Maximum size of the cache FILE";
+    cout << endl;
+    cout << "                     (default: 256). Least recently used";
+    cout << endl;
+    cout << "                     alignments are removed first." << endl;
+
+    cout << "    --incremental FILE: Saves the alignment matrix";
+    cout << " checkpoints" << endl;
+    cout << "                     in FILE and, on the next run, only";
+    cout << endl;
+    cout << "                     recomputes the part affected by";
+    cout << " edits" << endl;
+    cout << "                     to the ends of the sequences. Nw";
+    cout << " only;" << endl;
+    cout << "                     cannot be combined with --batch,";
+    cout << endl;
+    cout << "                     --engine, --min-score, the filters,";
+    cout << endl;
+    cout << "                     limits, --cache or --max-memory.";
+    cout << endl;
+
+    cout << "    --engine NAME  : Alignment engine to use:" << endl;
+    cout << "                       nw     : full Needleman-Wunsch";
+    cout << " matrix" << endl;
+    cout << "                                (default)" << endl;
+    cout << "                       banded : only a band of W cells";
+    cout << " around" << endl;
+    cout << "                                the diagonal (see --band)";
+    cout << endl;
+    cout << "                       linear : linear-space (Hirschberg)";
+    cout << endl;
+    cout << "                       score  : alignment score only";
+    cout << endl;
+    cout << "                       wfa    : wavefront alignment, fast";
+    cout << " for" << endl;
+    cout << "                                very similar sequences";
+    cout << endl;
+    cout << "                                (+1/-1 scoring only)";
+    cout << endl;
+    cout << "                       overlap: free end gaps, for";
+    cout << " overlapping" << endl;
+    cout << "                                reads (see --xdrop)";
+    cout << endl;
+    cout << "                       diff   : nw on 8-bit score";
+    cout << " differences," << endl;
+    cout << "                                16 cells per vector";
+    cout << endl;
+    cout << "                                operation" << endl;
+    cout << "                       russians: nw by lookup of 2x2";
+    cout << " blocks" << endl;
+    cout << "                                (+1/-1 scoring, gap -1";
+    cout << " to -4;" << endl;
+    cout << "                                4 cells per lookup,";
+    cout << " still" << endl;
+    cout << "                                O(n * m))" << endl;
+
+    cout << "    --band W       : Band width of the banded engine";
+    cout << " (default:" << endl;
+    cout << "                     100). With --max-memory, also allows";
+    cout << endl;
+    cout << "                     the planner to choose the banded";
+    cout << " engine." << endl;
+
+    cout << "    --xdrop X      : Overlap engine only: stops exploring";
+    cout << endl;
+    cout << "                     cells more than X below the best";
+    cout << " score" << endl;
+    cout << "                     seen (default: 0, explore all).";
+    cout << endl;
+
+    cout << "    --max-memory SIZE: Memory budget, e.g. 512M or 4G.";
+    cout << " The" << endl;
+    cout << "                     engine (and number of batch threads)";
+    cout << endl;
+    cout << "                     is chosen to fit in SIZE, replacing";
+    cout << endl;
+    cout << "                     --engine." << endl;
+    cout << "    --traceback-file FILE: Keeps the steps of the nw engine";
+    cout << endl;
+    cout << "                     in a memory-mapped scratch file next";
+    cout << endl;
+    cout << "                     to FILE instead of in memory, for";
+    cout << endl;
+    cout << "                     exact alignments larger than RAM.";
+    cout << endl;
+    cout << "    --profile      : Reports time, cycles, instructions, IPC";
+    cout << endl;
+    cout << "                     and cache and branch misses per phase";
+    cout << endl;
+    cout << "                     (hardware counters where available).";
+    cout << endl;
+    cout << "                     In batch mode, also reports each";
+    cout << " worker's" << endl;
+    cout << "                     pairs, tiles, steals and utilization.";
+    cout << endl;
+    cout << "    --benchmark FILE: Times every engine on a built-in";
+    cout << " corpus," << endl;
+    cout << "                     checks their scores against nw and";
+    cout << endl;
+    cout << "                     compares time, GCUPS and peak memory";
+    cout << endl;
+    cout << "                     with the baseline FILE. Exits with 2";
+    cout << " on" << endl;
+    cout << "                     any regression. Proteins are scored";
+    cout << " with -s" << endl;
+    cout << "                     (default:";
+    cout << " ../scoring_matrices/BLOSUM62.txt)." << endl;
+    cout << "    --update-baseline: With --benchmark: writes FILE";
+    cout << " instead." << endl;
+    cout << "    --tolerance PCT: Allowed slowdown (default: 20)." << endl;
+    cout << "    --memory-tolerance PCT: Allowed peak memory growth";
+    cout << endl;
+    cout << "                     (default: 10)." << endl;
+    cout << endl;
 
     cout << "Examples to run PWA:" << endl;
     cout << "    ./PWA -h" << endl;
     cout << "    ./PWA -n DNA_sequences.txt -o my_alignment.txt";
     cout << endl;
     cout << "    ./PWA -p protein_sequences.txt -s BLOSUM.txt";
+    cout << endl;
+    cout << "    ./PWA -n DNA_sequences.txt --batch --threads 8";
     cout << endl << endl;
 
     cout << "Default output saved to ./PWA_output.txt.";
@@ -193,3 +474,588 @@ void PWA_message::end_PWA(PWA_time *time_obj, char *output_filename)
 
 }   // End PWA_message::end_PWA().
 
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_not_enough_sequences()                     */
+/*-----------------------------------------------------------------------*/
+/* If the input file does not contain a sequence to align, prints this   */
+/* message and exits.                                                    */
+/*=======================================================================*/
+void PWA_message::print_not_enough_sequences(void)
+{
+    cout << "ERROR: The input file does not contain any sequences";
+    cout << endl;
+    cout << "       to align." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_not_enough_sequences().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_unknown_engine()                           */
+/*-----------------------------------------------------------------------*/
+/* If the engine named with --engine does not exist, prints this         */
+/* message and exits.                                                    */
+/*=======================================================================*/
+void PWA_message::print_unknown_engine(string engine)
+{
+    cout << "ERROR: Unknown alignment engine '" << engine << "'.";
+    cout << endl;
+    cout << "       Please refer to the help message (-h) for the";
+    cout << endl;
+    cout << "       available engines." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_unknown_engine().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_unknown_limit_action()                     */
+/*-----------------------------------------------------------------------*/
+/* If the action named with --on-limit is neither banded nor fail,       */
+/* prints this message and exits.                                        */
+/*=======================================================================*/
+void PWA_message::print_unknown_limit_action(string action)
+{
+    cout << "ERROR: Unknown --on-limit action '" << action << "'.";
+    cout << endl;
+    cout << "       Please use banded or fail." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_unknown_limit_action().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_unknown_matrix_type()                      */
+/*-----------------------------------------------------------------------*/
+/* If the value named with --matrix is neither score nor distance,       */
+/* prints this message and exits.                                        */
+/*=======================================================================*/
+void PWA_message::print_unknown_matrix_type(string type)
+{
+    cout << "ERROR: Unknown --matrix value '" << type << "'." << endl;
+    cout << "       Please use score or distance." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_unknown_matrix_type().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_invalid_shard()                            */
+/*-----------------------------------------------------------------------*/
+/* If --shard is not followed by i/N with 1 <= i <= N, prints this       */
+/* message and exits.                                                    */
+/*=======================================================================*/
+void PWA_message::print_invalid_shard(string shard)
+{
+    cout << "ERROR: Invalid shard '" << shard << "'. Use --shard i/N";
+    cout << endl;
+    cout << "       with 1 <= i <= N, e.g. --shard 3/8." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_invalid_shard().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_missing_shard()                            */
+/*-----------------------------------------------------------------------*/
+/* If a shard output to be merged does not exist (the shard has not      */
+/* finished), prints this message and exits without merging.             */
+/*=======================================================================*/
+void PWA_message::print_missing_shard(string shard_filename)
+{
+    cout << "ERROR: Shard output '" << shard_filename << "' not found.";
+    cout << endl;
+    cout << "       All shards must finish before merging." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_missing_shard().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_merge_summary()                            */
+/*-----------------------------------------------------------------------*/
+/* Prints how many shard outputs were merged and where.                  */
+/*=======================================================================*/
+void PWA_message::print_merge_summary(int number_of_shards,
+                                      const char *output_filename)
+{
+    cout << "Merged " << number_of_shards << " shard output(s) into ";
+    cout << output_filename << "." << endl;
+
+}   // End PWA_message::print_merge_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_cannot_resume()                            */
+/*-----------------------------------------------------------------------*/
+/* If the output of a resumed run is missing or shorter than its         */
+/* progress file records, or cannot be truncated to that length, prints  */
+/* this message and exits.                                               */
+/*=======================================================================*/
+void PWA_message::print_cannot_resume(string output_filename)
+{
+    cout << "ERROR: Output '" << output_filename << "' does not match";
+    cout << " the progress" << endl;
+    cout << "       file. Run again without --resume." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_cannot_resume().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_invalid_progress()                         */
+/*-----------------------------------------------------------------------*/
+/* If the progress file of a resumed run cannot be read or is corrupt,   */
+/* prints this message and exits.                                        */
+/*=======================================================================*/
+void PWA_message::print_invalid_progress(string progress_filename)
+{
+    cout << "ERROR: Progress file '" << progress_filename << "' cannot";
+    cout << " be read or" << endl;
+    cout << "       is corrupt. Run again without --resume." << endl;
+    cout << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_invalid_progress().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_progress_mismatch()                        */
+/*-----------------------------------------------------------------------*/
+/* If the progress file of a resumed run was written for another input,  */
+/* other options or another shard, prints this message and exits.        */
+/*=======================================================================*/
+void PWA_message::print_progress_mismatch(string progress_filename)
+{
+    cout << "ERROR: Progress file '" << progress_filename << "' was";
+    cout << " written for a" << endl;
+    cout << "       different input, options or shard. Run again with";
+    cout << " the" << endl;
+    cout << "       same ones, or without --resume." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_progress_mismatch().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_resume_summary()                           */
+/*-----------------------------------------------------------------------*/
+/* Prints where a resumed run continues from.                            */
+/*=======================================================================*/
+void PWA_message::print_resume_summary(long tasks_written, long output_bytes)
+{
+    cout << "Resuming after " << tasks_written << " pair(s) (";
+    cout << output_bytes << " bytes of output)." << endl;
+
+}   // End PWA_message::print_resume_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_batch_summary()                            */
+/*-----------------------------------------------------------------------*/
+/* Prints the number of pairs aligned in batch mode and the number of    */
+/* worker threads used.                                                  */
+/*=======================================================================*/
+void PWA_message::print_batch_summary(long pairs_aligned,
+                                      int number_of_threads)
+{
+    cout << "Batch alignment finished: " << pairs_aligned;
+    cout << " pair(s) aligned using " << number_of_threads;
+    cout << " worker thread(s)." << endl;
+
+}   // End PWA_message::print_batch_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_query_summary()                            */
+/*-----------------------------------------------------------------------*/
+/* Prints how many queries the input records were aligned with in one    */
+/* pass (--queries), and where each query's results are.                 */
+/*=======================================================================*/
+void PWA_message::print_query_summary(int number_of_queries, long records,
+                                      const char *output_filename)
+{
+    cout << "Queries: " << records << " record(s) read once for ";
+    cout << number_of_queries << " query(ies), written to ";
+    cout << output_filename << ".q1 to " << output_filename << ".q";
+    cout << number_of_queries << "." << endl;
+
+}   // End PWA_message::print_query_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_prefilter_summary()                        */
+/*-----------------------------------------------------------------------*/
+/* Prints how many all-vs-all pairs the prefilter skipped.               */
+/*=======================================================================*/
+void PWA_message::print_prefilter_summary(long pairs_skipped,
+                                          double min_similarity)
+{
+    cout << "Prefilter: " << pairs_skipped << " pair(s) skipped with";
+    cout << " estimated similarity below " << min_similarity << "." << endl;
+
+}   // End PWA_message::print_prefilter_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_matrix_summary()                           */
+/*-----------------------------------------------------------------------*/
+/* Prints the size and location of the all-vs-all matrix of --matrix.    */
+/*=======================================================================*/
+void PWA_message::print_matrix_summary(long record_count,
+                                       const char *output_filename)
+{
+    cout << "Matrix: " << record_count << " x " << record_count;
+    cout << " record(s) written to " << output_filename << "." << endl;
+
+}   // End PWA_message::print_matrix_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_matrix_file_error()                        */
+/*-----------------------------------------------------------------------*/
+/* If the matrix file of --matrix cannot be created, sized or written,   */
+/* prints this message and exits.                                        */
+/*=======================================================================*/
+void PWA_message::print_matrix_file_error(const char *output_filename)
+{
+    cout << "ERROR: Cannot write the matrix file '" << output_filename;
+    cout << "'." << endl;
+    cout << "       Check that the directory exists and has enough";
+    cout << " space." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_matrix_file_error().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_min_score_summary()                        */
+/*-----------------------------------------------------------------------*/
+/* Prints how many pairs were abandoned below the minimum score (and     */
+/* left out of the output) in batch and all-vs-all mode.                 */
+/*=======================================================================*/
+void PWA_message::print_min_score_summary(long pairs_below_min_score,
+                                          int min_score)
+{
+    cout << "Minimum score: " << pairs_below_min_score << " pair(s)";
+    cout << " below " << min_score << " abandoned and not written.";
+    cout << endl;
+
+}   // End PWA_message::print_min_score_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_limit_summary()                            */
+/*-----------------------------------------------------------------------*/
+/* Prints how many pairs ran over --time-limit or --cell-limit, and how  */
+/* many of those were aligned with the banded engine instead.            */
+/*=======================================================================*/
+void PWA_message::print_limit_summary(long pairs_over_limit,
+                                      long pairs_banded_fallback)
+{
+    cout << "Limits: " << pairs_over_limit + pairs_banded_fallback;
+    cout << " pair(s) over the time or cell limit, ";
+    cout << pairs_banded_fallback << " aligned with the banded engine";
+    cout << " instead." << endl;
+
+}   // End PWA_message::print_limit_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_cache_summary()                            */
+/*-----------------------------------------------------------------------*/
+/* Prints how many alignments were taken from the cache and how many     */
+/* had to be computed.                                                   */
+/*=======================================================================*/
+void PWA_message::print_cache_summary(long cache_hits, long cache_misses)
+{
+    cout << "Alignment cache: " << cache_hits << " reused, ";
+    cout << cache_misses << " computed." << endl;
+
+}   // End PWA_message::print_cache_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_cache_write_error()                        */
+/*-----------------------------------------------------------------------*/
+/* If the cache file cannot be written, prints this warning. The run     */
+/* itself is not affected; the earlier cache file, if any, is kept.      */
+/*=======================================================================*/
+void PWA_message::print_cache_write_error(string cache_filename)
+{
+    cout << "WARNING: Failed to write cache file ";
+    cout << "'" << cache_filename << "'." << endl << endl;
+
+}   // End PWA_message::print_cache_write_error().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_diagonal_summary()                         */
+/*-----------------------------------------------------------------------*/
+/* Prints how many pairs the diagonal filter accepted with their         */
+/* ungapped alignment and how many it rejected (and left out of the      */
+/* batch output).                                                        */
+/*=======================================================================*/
+void PWA_message::print_diagonal_summary(long pairs_accepted,
+                                         long pairs_rejected,
+                                         int min_diagonal_score)
+{
+    cout << "Diagonal filter: " << pairs_accepted << " pair(s) accepted";
+    cout << " ungapped, " << pairs_rejected << " rejected below ";
+    cout << min_diagonal_score << "." << endl;
+
+}   // End PWA_message::print_diagonal_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_checkpoint_write_error()                   */
+/*-----------------------------------------------------------------------*/
+/* If the --incremental checkpoint cannot be written, prints this        */
+/* warning. The alignment is still output; the next run reuses the       */
+/* previous checkpoint, if any.                                          */
+/*=======================================================================*/
+void PWA_message::print_checkpoint_write_error(string checkpoint_filename)
+{
+    cout << "WARNING: Failed to write checkpoint file ";
+    cout << "'" << checkpoint_filename << "'." << endl << endl;
+
+}   // End PWA_message::print_checkpoint_write_error().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_incremental_conflict()                     */
+/*-----------------------------------------------------------------------*/
+/* If --incremental is combined with an option it cannot honour, prints  */
+/* this message and exits.                                               */
+/*=======================================================================*/
+void PWA_message::print_incremental_conflict(string option)
+{
+    cout << "ERROR: --incremental cannot be combined with " << option;
+    cout << "." << endl;
+    cout << "       It aligns the first pair with the nw engine only.";
+    cout << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_incremental_conflict().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_incremental_summary()                      */
+/*-----------------------------------------------------------------------*/
+/* Prints how much of the alignment matrix was reused from the           */
+/* checkpoint of the previous run.                                       */
+/*=======================================================================*/
+void PWA_message::print_incremental_summary(int rows_reused, int rows,
+                                            int columns_reused,
+                                            int columns)
+{
+    cout << "Incremental alignment: reused " << rows_reused;
+    cout << " of " << rows << " rows and " << columns_reused;
+    cout << " of " << columns << " columns." << endl;
+
+}   // End PWA_message::print_incremental_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_memory_plan()                              */
+/*-----------------------------------------------------------------------*/
+/* Prints the engine and number of threads chosen by the planner and     */
+/* the predicted peak memory of one alignment.                           */
+/*=======================================================================*/
+void PWA_message::print_memory_plan(string engine, long predicted_bytes,
+                                    long max_memory_bytes,
+                                    int number_of_threads)
+{
+    cout << fixed << setprecision(1);
+    cout << "Memory plan: engine '" << engine << "', ";
+    cout << number_of_threads << " thread(s)." << endl;
+    cout << "             Predicted peak ";
+    cout << (predicted_bytes / 1048576.0) << " MB per alignment, budget ";
+    cout << (max_memory_bytes / 1048576.0) << " MB." << endl << endl;
+
+}   // End PWA_message::print_memory_plan().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_memory_exceeded()                          */
+/*-----------------------------------------------------------------------*/
+/* If even the smallest engine does not fit in the memory budget,        */
+/* prints this message and exits.                                        */
+/*=======================================================================*/
+void PWA_message::print_memory_exceeded(long predicted_bytes,
+                                        long max_memory_bytes)
+{
+    cout << fixed << setprecision(1);
+    cout << "ERROR: The alignment needs at least ";
+    cout << (predicted_bytes / 1048576.0) << " MB," << endl;
+    cout << "       more than the memory budget of ";
+    cout << (max_memory_bytes / 1048576.0) << " MB." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_memory_exceeded().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_traceback_file_error()                     */
+/*-----------------------------------------------------------------------*/
+/* If the scratch file for the traceback cannot be created or is too     */
+/* large for its file system, prints this message and exits.             */
+/*=======================================================================*/
+void PWA_message::print_traceback_file_error(string traceback_filename)
+{
+    cout << "ERROR: Cannot create the traceback scratch file next to '";
+    cout << traceback_filename << "'." << endl;
+    cout << "       Check that the directory exists and has enough";
+    cout << " space." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_traceback_file_error().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_profile_report()                           */
+/*-----------------------------------------------------------------------*/
+/* Prints the phase table of --profile (see PWA_profile::get_report()).  */
+/*=======================================================================*/
+void PWA_message::print_profile_report(string report)
+{
+    cout << report << endl;
+
+}   // End PWA_message::print_profile_report().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_worker_report()                            */
+/*-----------------------------------------------------------------------*/
+/* Prints the per-worker utilization table of a batch run with --profile */
+/* (see PWA_scheduler::get_report()).                                    */
+/*=======================================================================*/
+void PWA_message::print_worker_report(string report)
+{
+    cout << report << endl;
+
+}   // End PWA_message::print_worker_report().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_benchmark_report()                         */
+/*-----------------------------------------------------------------------*/
+/* Prints the result table of --benchmark (see                           */
+/* PWA_benchmark::get_report()).                                         */
+/*=======================================================================*/
+void PWA_message::print_benchmark_report(string report)
+{
+    cout << report << endl;
+
+}   // End PWA_message::print_benchmark_report().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_benchmark_summary()                        */
+/*-----------------------------------------------------------------------*/
+/* Prints whether the benchmark passed: no regressions against the       */
+/* baseline, no engine disagreeing with nw and no related pair rejected  */
+/* by the diagonal filter. With update_baseline, reports the new         */
+/* baseline instead, which is only written if both checks pass.          */
+/*=======================================================================*/
+void PWA_message::print_benchmark_summary(int regressions, int mismatches,
+                                          int rejections,
+                                          string baseline_filename,
+                                          bool update_baseline)
+{
+    if (mismatches > 0)
+    {
+        cout << "FAILED: " << mismatches << " engine score(s) differ";
+        cout << " from nw." << endl;
+    }
+    if (rejections > 0)
+    {
+        cout << "FAILED: " << rejections << " related pair(s) rejected";
+        cout << " by the diagonal filter." << endl;
+    }
+
+    if (update_baseline == 1)
+    {
+        if ((mismatches == 0) && (rejections == 0))
+        {
+            cout << "Baseline saved to " << baseline_filename << ".";
+            cout << endl;
+        }
+        else
+        {
+            cout << "Baseline " << baseline_filename << " not updated.";
+            cout << endl;
+        }
+    }
+    else if (regressions > 0)
+    {
+        cout << "FAILED: " << regressions << " regression(s) against";
+        cout << " " << baseline_filename << "." << endl;
+    }
+    else if ((mismatches == 0) && (rejections == 0))
+    {
+        cout << "Benchmark passed against " << baseline_filename << ".";
+        cout << endl;
+    }
+
+}   // End PWA_message::print_benchmark_summary().
+
+
+/*=======================================================================*/
+/* Method: PWA_message::print_baseline_error()                           */
+/*-----------------------------------------------------------------------*/
+/* If the benchmark baseline file cannot be read (or, with               */
+/* --update-baseline, written), prints this message and exits.           */
+/*=======================================================================*/
+void PWA_message::print_baseline_error(string baseline_filename)
+{
+    cout << "ERROR: Cannot open benchmark baseline '" << baseline_filename;
+    cout << "'." << endl;
+    cout << "       Create it with --update-baseline." << endl << endl;
+
+    cout << "Exiting ..." << endl << endl;
+
+    exit(-1);
+
+}   // End PWA_message::print_baseline_error().
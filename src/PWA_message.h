@@ -18,6 +18,50 @@ public:
     void print_option_selected(string option, \
                                char *input_filename);
     void print_no_option(void);
+    void print_not_enough_sequences(void);
+    void print_unknown_engine(string engine);
+    void print_unknown_limit_action(string action);
+    void print_unknown_matrix_type(string type);
+    void print_invalid_shard(string shard);
+    void print_missing_shard(string shard_filename);
+    void print_merge_summary(int number_of_shards,
+                             const char *output_filename);
+    void print_cannot_resume(string output_filename);
+    void print_invalid_progress(string progress_filename);
+    void print_progress_mismatch(string progress_filename);
+    void print_resume_summary(long tasks_written, long output_bytes);
+    void print_batch_summary(long pairs_aligned, int number_of_threads);
+    void print_query_summary(int number_of_queries, long records,
+                             const char *output_filename);
+    void print_prefilter_summary(long pairs_skipped,
+                                 double min_similarity);
+    void print_matrix_summary(long record_count,
+                              const char *output_filename);
+    void print_matrix_file_error(const char *output_filename);
+    void print_min_score_summary(long pairs_below_min_score,
+                                 int min_score);
+    void print_limit_summary(long pairs_over_limit,
+                             long pairs_banded_fallback);
+    void print_cache_summary(long cache_hits, long cache_misses);
+    void print_cache_write_error(string cache_filename);
+    void print_diagonal_summary(long pairs_accepted, long pairs_rejected,
+                                int min_diagonal_score);
+    void print_checkpoint_write_error(string checkpoint_filename);
+    void print_incremental_conflict(string option);
+    void print_incremental_summary(int rows_reused, int rows,
+                                   int columns_reused, int columns);
+    void print_memory_plan(string engine, long predicted_bytes,
+                           long max_memory_bytes, int number_of_threads);
+    void print_memory_exceeded(long predicted_bytes,
+                               long max_memory_bytes);
+    void print_traceback_file_error(string traceback_filename);
+    void print_profile_report(string report);
+    void print_worker_report(string report);
+    void print_benchmark_report(string report);
+    void print_benchmark_summary(int regressions, int mismatches,
+                                 int rejections, string baseline_filename,
+                                 bool update_baseline);
+    void print_baseline_error(string baseline_filename);
     void end_PWA(PWA_time *time_obj, char *output_filename);
 
 };  // PWA_message
@@ -6,8 +6,10 @@
 /* user.                                                                 */
 /*=======================================================================*/
 #include "PWA_file.h"
+#include "PWA_matrix.h"
 #include "PWA_message.h"
 #include "PWA_option.h"
+#include "PWA_shard.h"
 
 #include <cstring>
 #include <iostream>
@@ -24,12 +26,44 @@ using namespace std;
 /* option has been chosen.                                               */
 /*                                                                       */
 /* Also initializes scoring_specified as FALSE to indicate that no       */
-/* specific scoring matrix file has yet been specified.                  */
+/* specific scoring matrix file has yet been specified, and              */
+/* batch_specified as FALSE so that only the first pair is aligned.      */
 /*=======================================================================*/
 PWA_option::PWA_option()
 {
     chosen_option = 'x';
     scoring_specified = 0;
+    batch_specified   = 0;
+    all_vs_all_specified = 0;
+    min_similarity    = -1;
+    matrix_specified  = 0;
+    matrix_type       = PWA_matrix::value_score;
+    min_score_specified = 0;
+    min_score         = 0;
+    diagonal_filter_specified = 0;
+    min_diagonal_score = 0;
+    time_limit        = 0;
+    cell_limit        = 0;
+    limit_fallback    = 1;
+    number_of_threads = 0;
+    cache_size_mb     = 0;
+    engine            = "nw";
+    band_width        = 0;
+    xdrop             = 0;
+    both_strands      = 0;
+    shard_index       = 0;
+    number_of_shards  = 0;
+    merge_shards      = 0;
+    resume_specified  = 0;
+    max_memory_bytes  = 0;
+    traceback_filename = "";
+    profile_specified = 0;
+    pin_threads       = 0;
+    interleave_pairs  = 0;
+    benchmark_filename = "";
+    update_baseline   = 0;
+    time_tolerance    = -1;
+    memory_tolerance  = -1;
 
 }   // End PWA_option::PWA_option().
 
@@ -85,14 +119,209 @@ void PWA_option::parse_command_line(int argc, char *argv[],
             file_obj->output_filename = strdup(argv[i+1]);
             i++;
         }
+        else if (strcmp(argv[i], "--batch") == 0)
+        {
+            batch_specified = 1;
+        }
+        else if (strcmp(argv[i], "--queries") == 0)
+        {
+            file_obj->queries_filename = strdup(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--all-vs-all") == 0)
+        {
+            all_vs_all_specified = 1;
+        }
+        else if (strcmp(argv[i], "--min-similarity") == 0)
+        {
+            min_similarity = atof(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--matrix") == 0)
+        {
+            matrix_specified = 1;
+            if (strcmp(argv[i+1], "score") == 0)
+            {
+                matrix_type = PWA_matrix::value_score;
+            }
+            else if (strcmp(argv[i+1], "distance") == 0)
+            {
+                matrix_type = PWA_matrix::value_distance;
+            }
+            else
+            {
+                msg_obj->print_unknown_matrix_type(argv[i+1]);
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--min-score") == 0)
+        {
+            min_score_specified = 1;
+            min_score = atoi(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--diagonal-filter") == 0)
+        {
+            diagonal_filter_specified = 1;
+            min_diagonal_score = atoi(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--time-limit") == 0)
+        {
+            time_limit = atof(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--cell-limit") == 0)
+        {
+            cell_limit = atol(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--on-limit") == 0)
+        {
+            if (strcmp(argv[i+1], "banded") == 0)
+            {
+                limit_fallback = 1;
+            }
+            else if (strcmp(argv[i+1], "fail") == 0)
+            {
+                limit_fallback = 0;
+            }
+            else
+            {
+                msg_obj->print_unknown_limit_action(argv[i+1]);
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            number_of_threads = atoi(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--pin") == 0)
+        {
+            pin_threads = 1;
+        }
+        else if (strcmp(argv[i], "--interleave") == 0)
+        {
+            interleave_pairs = 1;
+        }
+        else if (strcmp(argv[i], "--benchmark") == 0)
+        {
+            benchmark_filename = argv[i+1];
+            i++;
+        }
+        else if (strcmp(argv[i], "--update-baseline") == 0)
+        {
+            update_baseline = 1;
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0)
+        {
+            time_tolerance = atof(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--memory-tolerance") == 0)
+        {
+            memory_tolerance = atof(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--cache") == 0)
+        {
+            file_obj->cache_filename = strdup(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--cache-size") == 0)
+        {
+            cache_size_mb = atol(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--engine") == 0)
+        {
+            engine = argv[i+1];
+            if ((engine != "nw") && (engine != "banded") &&
+                (engine != "linear") && (engine != "score") &&
+                (engine != "wfa") && (engine != "overlap") &&
+                (engine != "diff") && (engine != "russians"))
+            {
+                msg_obj->print_unknown_engine(engine);
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--band") == 0)
+        {
+            band_width = atoi(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--both-strands") == 0)
+        {
+            both_strands = 1;
+        }
+        else if (strcmp(argv[i], "--shard") == 0)
+        {
+            PWA_shard shard_obj;
+            if (!shard_obj.parse_shard(argv[i+1]))
+            {
+                msg_obj->print_invalid_shard(argv[i+1]);
+            }
+            shard_index      = shard_obj.shard_index;
+            number_of_shards = shard_obj.number_of_shards;
+            i++;
+        }
+        else if (strcmp(argv[i], "--merge") == 0)
+        {
+            merge_shards = atoi(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--xdrop") == 0)
+        {
+            xdrop = atoi(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--max-memory") == 0)
+        {
+            max_memory_bytes = parse_memory_size(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--profile") == 0)
+        {
+            profile_specified = 1;
+        }
+        else if (strcmp(argv[i], "--traceback-file") == 0)
+        {
+            traceback_filename = argv[i+1];
+            i++;
+        }
+        else if (strcmp(argv[i], "--incremental") == 0)
+        {
+            file_obj->checkpoint_filename = strdup(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--progress") == 0)
+        {
+            file_obj->progress_filename = strdup(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "--resume") == 0)
+        {
+            resume_specified = 1;
+        }
     }   // End for.
 
     // If -o option not selected, sets default output file name.
-    if (file_obj->output_filename == '\0')
+    if (file_obj->output_filename == NULL)
     {
         file_obj->output_filename = strdup("PWA_output.txt");
     }
 
+    // Refuse options --incremental would otherwise silently ignore.
+    if (file_obj->checkpoint_filename != NULL)
+    {
+        string conflict = get_incremental_conflict(file_obj);
+        if (!conflict.empty())
+        {
+            msg_obj->print_incremental_conflict(conflict);
+        }
+    }
+
 }   // End PWA_option::parse_command_line().
 
 
@@ -116,3 +345,96 @@ bool PWA_option::check_if_option_chosen(PWA_message *msg_obj)
 
 }   // End PWA_option::check_if_option_chosen().
 
+
+
+/*=======================================================================*/
+/* Method: PWA_option::get_incremental_conflict()                        */
+/*-----------------------------------------------------------------------*/
+/* Returns the first option given that --incremental cannot honour, or   */
+/* "" if there is none. The incremental engine aligns the first pair     */
+/* with the nw recurrence only, reusing the matrix of the previous run,  */
+/* so it cannot run in batch mode, with another engine, screen or        */
+/* reverse the pair first, stop it on a limit, or take it from a cache.  */
+/*=======================================================================*/
+string PWA_option::get_incremental_conflict(PWA_file *file_obj)
+{
+    if (batch_specified == 1)
+    {
+        return ("--batch");
+    }
+    if (all_vs_all_specified == 1)
+    {
+        return ("--all-vs-all");
+    }
+    if (file_obj->queries_filename != NULL)
+    {
+        return ("--queries");
+    }
+    if (engine != "nw")
+    {
+        return ("--engine " + engine);
+    }
+    if (min_score_specified == 1)
+    {
+        return ("--min-score");
+    }
+    if (both_strands == 1)
+    {
+        return ("--both-strands");
+    }
+    if (diagonal_filter_specified == 1)
+    {
+        return ("--diagonal-filter");
+    }
+    if (time_limit > 0)
+    {
+        return ("--time-limit");
+    }
+    if (cell_limit > 0)
+    {
+        return ("--cell-limit");
+    }
+    if (file_obj->cache_filename != NULL)
+    {
+        return ("--cache");
+    }
+    if (max_memory_bytes > 0)
+    {
+        return ("--max-memory");
+    }
+    if (!traceback_filename.empty())
+    {
+        return ("--traceback-file");
+    }
+
+    return ("");
+
+}   // End PWA_option::get_incremental_conflict().
+
+
+/*=======================================================================*/
+/* Method: PWA_option::parse_memory_size()                               */
+/*-----------------------------------------------------------------------*/
+/* Converts a memory size such as "512M" or "4G" to bytes. The suffixes  */
+/* K, M, G and T are powers of 1024; a plain number is in bytes.         */
+/*=======================================================================*/
+long PWA_option::parse_memory_size(char *text)
+{
+    const char *suffixes = "KMGT";
+    const char *found    = NULL;
+    char *suffix = NULL;
+    double size  = strtod(text, &suffix);
+
+    // K is 1024 once, M twice, and so on.
+    if (*suffix != '\0')
+    {
+        found = strchr(suffixes, toupper(*suffix));
+    }
+    for (const char *k = suffixes; (found != NULL) && (k <= found); k++)
+    {
+        size *= 1024;
+    }
+
+    return ((long)size);
+
+}   // End PWA_option::parse_memory_size().
@@ -4,6 +4,10 @@
 #include "PWA_file.h"
 #include "PWA_message.h"
 
+#include <string>
+
+using namespace std;
+
 class PWA_option
 {
 public:
@@ -14,11 +18,45 @@ public:
                             PWA_message *msg_obj);
 
     bool scoring_specified;
+    bool batch_specified;
+    bool all_vs_all_specified;
+    double min_similarity;  // Below 0 for the prefilter default
+    bool matrix_specified;
+    int  matrix_type;       // PWA_matrix::value_score or value_distance
+    bool min_score_specified;
+    int  min_score;
+    bool diagonal_filter_specified;
+    int  min_diagonal_score;
+    double time_limit;      // Seconds per alignment, 0 for none
+    long cell_limit;        // Cells per alignment, 0 for none
+    bool limit_fallback;    // Banded (1) or give up (0) over a limit
+    int  number_of_threads; // 0 for one per CPU
+    long cache_size_mb;     // 0 for default cache size
+    string engine;          // nw, banded, linear, score, wfa, overlap, diff,
+                            // russians
+    int  band_width;        // 0 for default band width
+    int  xdrop;             // 0 for no X-drop pruning
+    bool both_strands;
+    int  shard_index;       // 1 to number_of_shards
+    int  number_of_shards;  // 0 if not sharded
+    int  merge_shards;      // Number of shard outputs to merge, or 0
+    bool resume_specified;
+    long max_memory_bytes;  // 0 for no memory budget
+    string traceback_filename;  // "" to keep nw steps in memory
+    bool profile_specified;
+    bool pin_threads;
+    bool interleave_pairs;
+    string benchmark_filename;  // "" for no benchmark
+    bool update_baseline;
+    double time_tolerance;      // Percent; below 0 for the default
+    double memory_tolerance;    // Percent; below 0 for the default
     char chosen_option; // n for nucleotide, p for protein,
                         // x for none chosen
 
 private:
     bool check_if_option_chosen(PWA_message *msg_obj);
+    string get_incremental_conflict(PWA_file *file_obj);
+    long parse_memory_size(char *text);
 
 };  // PWA_option
 
@@ -0,0 +1,301 @@
+/*=======================================================================*/
+/* Filename: PWA_overlap.cpp                                             */
+/*=======================================================================*/
+/* Overlap (semi-global) alignment engine. Gaps at either end of either  */
+/* sequence are free, so the alignment may start on the first row or     */
+/* column of the matrix and end on the last row or column, as when the   */
+/* end of one read overlaps the start of another.                        */
+/*                                                                       */
+/* With an X-drop (xdrop > 0), cells scoring more than xdrop below the   */
+/* best score seen so far are pruned, and each row is only computed      */
+/* between the first and last cell that survived in the row above (and   */
+/* as far right as a gap from a surviving cell allows). Once a good      */
+/* overlap has been found, only a narrow strip around it is computed.    */
+/*                                                                       */
+/* The cell_limit and time_limit of the alignment are checked after      */
+/* each row, against the cells actually computed, so that a pruned strip */
+/* is only stopped if it really grows past the limit.                    */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_overlap.h"
+
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Score of pruned cells and cells that were not computed.
+static const int pruned = INT_MIN / 4;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_overlap                                              */
+/*-----------------------------------------------------------------------*/
+/* Initializes an empty overlap engine.                                  */
+/*=======================================================================*/
+PWA_overlap::PWA_overlap()
+{
+    cells_computed = 0;
+    score_table    = NULL;
+    gap_penalty    = -2;
+    xdrop          = 0;
+    best_score     = 0;
+    best_row       = 0;
+    best_column    = 0;
+    limit_obj      = NULL;
+
+}   // End PWA_overlap::PWA_overlap().
+
+
+/*=======================================================================*/
+/* Method: PWA_overlap::begin_overlap_alignment()                        */
+/*-----------------------------------------------------------------------*/
+/* Finds the best overlap alignment of the two sequences of PWA_obj and  */
+/* stores it in PWA_obj. The overhanging ends are shown as gaps, which   */
+/* do not count towards the score. If a limit is passed first,           */
+/* alignment_status is set to status_over_limit instead.                 */
+/*=======================================================================*/
+void PWA_overlap::begin_overlap_alignment(PWA_alignment *PWA_obj)
+{
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    sequence_1  = PWA_obj->sequences_vector[0];
+    sequence_2  = PWA_obj->sequences_vector[1];
+    score_table = PWA_obj->score_table.data();
+    gap_penalty = PWA_obj->get_gap_penalty();
+    xdrop       = PWA_obj->xdrop;
+    limit_obj   = PWA_obj;
+
+    if (!fill_strip())
+    {
+        PWA_obj->alignment_status = PWA_alignment::status_over_limit;
+        return;
+    }
+
+    PWA_obj->apply_cigar_string(trace_back_strip());
+    PWA_obj->alignment_score = best_score;
+
+}   // End PWA_overlap::begin_overlap_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_overlap::fill_strip()                                     */
+/*-----------------------------------------------------------------------*/
+/* Computes the matrix one row at a time. The first row and column are   */
+/* 0 (free leading gaps). Directions are chosen in the same order as     */
+/* get_step_direction(): diagonal, left, then up. Each row is computed   */
+/* from the first to one past the last surviving cell of the row above,  */
+/* and further right while a gap from a surviving cell survives. Once    */
+/* no cell of a row survives, the rows below are not computed at all.    */
+/* Returns 0 if the limits of limit_obj were passed first.               */
+/*=======================================================================*/
+bool PWA_overlap::fill_strip(void)
+{
+    int columns   = sequence_1.length();
+    int rows      = sequence_2.length();
+    int best_seen = 0;
+    int up_lo     = 0;          // Surviving cells of the row above.
+    int up_hi     = columns;
+
+    vector<int> previous_row(columns + 1, 0);
+    vector<int> current_row(columns + 1, pruned);
+
+    first_column.assign(1, 0);
+    last_column.assign(1, columns);
+    row_offset.assign(1, 0);
+    steps.assign(columns + 1, 'L');
+    cells_computed = columns + 1;
+
+    // An empty overlap: all of sequence 1, then all of sequence 2.
+    best_score  = 0;
+    best_row    = 0;
+    best_column = columns;
+
+    for (int i = 1; i <= rows; i++)
+    {
+        int  char_2   = (unsigned char)sequence_2[i-1];
+        int  limit    = (xdrop > 0) ? best_seen - xdrop : pruned;
+        bool start_alive = (0 >= limit);
+        int  lo       = start_alive ? 0 : up_lo;
+        int  hi       = min(up_hi + 1, columns);
+        int  alive_lo = -1;
+        int  alive_hi = -1;
+
+        if ((up_lo > up_hi) && !start_alive)
+        {
+            // Nothing can be reached any more.
+            break;
+        }
+
+        row_offset.push_back(steps.size());
+
+        for (int j = lo; j <= columns; j++)
+        {
+            int  diagonal = pruned;
+            int  left     = pruned;
+            int  up       = pruned;
+            int  best     = 0;
+            char step     = 'U';
+
+            if ((j > hi) && ((alive_hi != j - 1) ||
+                             (current_row[j-1] + gap_penalty < limit)))
+            {
+                break;
+            }
+            hi = max(hi, j);
+
+            if (j > 0)
+            {
+                if ((j - 1 >= up_lo) && (j - 1 <= up_hi))
+                {
+                    int char_1 = (unsigned char)sequence_1[j-1];
+                    diagonal   = previous_row[j-1] +
+                                 score_table[(char_1 << 8) | char_2];
+                }
+                if (j > lo)
+                {
+                    left = current_row[j-1] + gap_penalty;
+                }
+                if ((j >= up_lo) && (j <= up_hi))
+                {
+                    up = previous_row[j] + gap_penalty;
+                }
+
+                best = max(max(diagonal, left), up);
+                if (best == diagonal)
+                {
+                    step = 'D';
+                }
+                else if (best == left)
+                {
+                    step = 'L';
+                }
+            }
+
+            if (best < limit)
+            {
+                best = pruned;
+            }
+            else
+            {
+                if (alive_lo < 0)
+                {
+                    alive_lo = j;
+                }
+                alive_hi  = j;
+                best_seen = max(best_seen, best);
+            }
+
+            current_row[j] = best;
+            steps.push_back(step);
+        }
+
+        first_column.push_back(lo);
+        last_column.push_back(hi);
+        cells_computed += hi - lo + 1;
+
+        // Free trailing gaps: the alignment may end in the last column
+        // or anywhere in the last row.
+        if ((hi == columns) && (current_row[columns] != pruned))
+        {
+            check_end_cell(i, columns, current_row[columns]);
+        }
+        for (int j = lo; (i == rows) && (j <= hi); j++)
+        {
+            if (current_row[j] != pruned)
+            {
+                check_end_cell(i, j, current_row[j]);
+            }
+        }
+
+        // Only cells from alive_lo to alive_hi are read in the next row.
+        up_lo = (alive_lo < 0) ? 1 : alive_lo;
+        up_hi = (alive_lo < 0) ? 0 : alive_hi;
+        previous_row.swap(current_row);
+
+        if ((limit_obj->cell_limit > 0) &&
+            (cells_computed > limit_obj->cell_limit))
+        {
+            return (0);
+        }
+
+        if (limit_obj->exceeds_time_limit())
+        {
+            return (0);
+        }
+    }
+
+    return (1);
+
+}   // End PWA_overlap::fill_strip().
+
+
+/*=======================================================================*/
+/* Method: PWA_overlap::check_end_cell()                                 */
+/*-----------------------------------------------------------------------*/
+/* Keeps cell (i, j) as the end of the alignment if it scores better     */
+/* than the best end cell so far.                                        */
+/*=======================================================================*/
+void PWA_overlap::check_end_cell(int i, int j, int score)
+{
+    if (score > best_score)
+    {
+        best_score  = score;
+        best_row    = i;
+        best_column = j;
+    }
+
+}   // End PWA_overlap::check_end_cell().
+
+
+/*=======================================================================*/
+/* Method: PWA_overlap::trace_back_strip()                               */
+/*-----------------------------------------------------------------------*/
+/* Traces back from the best end cell to the first row or column and     */
+/* returns the whole alignment, overhangs included, as a string of       */
+/* steps for apply_cigar_string().                                       */
+/*=======================================================================*/
+string PWA_overlap::trace_back_strip(void)
+{
+    string reversed_steps = "";
+    int i = best_row;
+    int j = best_column;
+
+    // Trailing overhang.
+    reversed_steps.append(sequence_1.length() - j, 'D');
+    reversed_steps.append(sequence_2.length() - i, 'I');
+
+    while ((i > 0) && (j > 0))
+    {
+        char direction = steps[row_offset[i] + j - first_column[i]];
+
+        if (direction == 'D')
+        {
+            reversed_steps.push_back('M');
+            i--;
+            j--;
+        }
+        else if (direction == 'L')
+        {
+            reversed_steps.push_back('D');
+            j--;
+        }
+        else
+        {
+            reversed_steps.push_back('I');
+            i--;
+        }
+    }
+
+    // Leading overhang.
+    reversed_steps.append(i, 'I');
+    reversed_steps.append(j, 'D');
+
+    return (string(reversed_steps.rbegin(), reversed_steps.rend()));
+
+}   // End PWA_overlap::trace_back_strip().
@@ -0,0 +1,43 @@
+#ifndef PWA_OVERLAP_H
+#define PWA_OVERLAP_H
+
+#include "PWA_alignment.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_overlap
+{
+public:
+    PWA_overlap();
+    void begin_overlap_alignment(PWA_alignment *PWA_obj);
+
+    long cells_computed;
+
+private:
+    bool fill_strip(void);
+    void check_end_cell(int i, int j, int score);
+    string trace_back_strip(void);
+
+    string       sequence_1;    // Columns of the matrix.
+    string       sequence_2;    // Rows of the matrix.
+    const int   *score_table;
+    int          gap_penalty;
+    int          xdrop;         // 0 for no pruning.
+
+    PWA_alignment *limit_obj;   // Checks the limits after each row.
+
+    int          best_score;    // Best end cell so far.
+    int          best_row;
+    int          best_column;
+
+    vector<int>  first_column;  // First column computed, per row.
+    vector<int>  last_column;   // Last column computed, per row.
+    vector<long> row_offset;    // Start of each row in steps.
+    vector<char> steps;         // D, L or U for each computed cell.
+
+};  // PWA_overlap
+
+#endif  // PWA_OVERLAP_H
@@ -0,0 +1,1417 @@
+/*=======================================================================*/
+/* Filename: PWA_pipeline.cpp                                            */
+/*=======================================================================*/
+/* Runs batch (one-vs-many) pairwise sequence alignment as a pipeline:   */
+/* a reader thread streams FASTA records into a bounded queue, a pool    */
+/* of worker threads aligns each record against the first (query)        */
+/* record, and a writer thread writes the results in input order. In     */
+/* all-vs-all mode the reader is replaced by a stage that queues the     */
+/* pairs of records that pass the MinHash prefilter. With a shard_obj,   */
+/* only the pairs of that shard are queued (see PWA_shard).              */
+/*                                                                       */
+/* Workers get their pairs from a work-stealing scheduler, which also    */
+/* shares the matrix fill of large pairs between them (see               */
+/* PWA_scheduler), so one long pair does not leave the others idle.      */
+/*                                                                       */
+/* With a progress_filename, the writer periodically flushes the output  */
+/* and records how many tasks (in queue order) are written and how many  */
+/* bytes that is. A run with resume_specified truncates the output to    */
+/* that size, drops the tasks already written and appends the rest. As   */
+/* the queue order only depends on the input and options, the resumed    */
+/* output is the same as that of an uninterrupted run. The progress      */
+/* file records a fingerprint of the input, options and shard, and a     */
+/* resume with any of them changed is refused. The output is synced to   */
+/* disk before each progress file that counts it.                        */
+/*                                                                       */
+/* With --queries, every record streamed from the input is aligned with  */
+/* each query in turn by the same worker, while it is still in cache,    */
+/* and each query's results go to a file of their own. The input is read */
+/* once, however many queries there are.                                 */
+/*                                                                       */
+/* For a score matrix there is no writer: each task is a block of rows   */
+/* of the matrix, and the worker that aligns it writes it straight to    */
+/* its own part of the file (see PWA_matrix).                            */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_diagonal.h"
+#include "PWA_file.h"
+#include "PWA_interleave.h"
+#include "PWA_matrix.h"
+#include "PWA_message.h"
+#include "PWA_pipeline.h"
+#include "PWA_prefilter.h"
+#include "PWA_profile.h"
+#include "PWA_scheduler.h"
+#include "PWA_shard.h"
+#include "PWA_store.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_pipeline                                             */
+/*-----------------------------------------------------------------------*/
+/* Uses one worker per hardware thread by default. queue_capacity is     */
+/* the maximum number of records that may be read but not yet written,   */
+/* which bounds the memory used by the pipeline regardless of the size   */
+/* of the input file.                                                    */
+/*=======================================================================*/
+PWA_pipeline::PWA_pipeline()
+{
+    number_of_threads = thread::hardware_concurrency();
+    if (number_of_threads < 1)
+    {
+        number_of_threads = 1;
+    }
+
+    threads_specified = 0;
+    queue_capacity  = 64;
+    pairs_aligned   = 0;
+    pairs_below_min_score = 0;
+    pairs_over_limit      = 0;
+    pairs_banded_fallback = 0;
+    pairs_skipped   = 0;
+    shard_obj       = NULL;
+
+    progress_filename  = NULL;
+    resume_specified   = 0;
+    checkpoint_pairs   = 1000;
+    checkpoint_seconds = 60;
+    pin_threads        = 0;
+    report_workers     = 0;
+    interleave_pairs   = 0;
+    matrix_write_failed = 0;
+    multi_query        = 0;
+    resume_index       = 0;
+    output_bytes       = 0;
+
+    tasks_in_flight = 0;
+    tasks_read      = 0;
+    reading_done    = 0;
+    store_obj       = NULL;
+
+}   // End PWA_pipeline::PWA_pipeline().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::run_one_vs_many()                               */
+/*-----------------------------------------------------------------------*/
+/* Reads the first record of the input file as the query, then starts    */
+/* the reader, worker and writer stages and waits for them to finish.    */
+/* PWA_obj is only used as a template: each worker copies its settings   */
+/* into its own PWA_alignment object.                                    */
+/*=======================================================================*/
+void PWA_pipeline::run_one_vs_many(PWA_file *file_obj,
+                                   PWA_alignment *PWA_obj,
+                                   PWA_message *msg_obj)
+{
+    if (shard_obj != NULL)
+    {
+        measure_one_vs_many(file_obj);
+    }
+
+    file_obj->open_record_stream();
+
+    query_names.assign(1, "");
+    query_sequences.assign(1, "");
+    if (!file_obj->get_next_record(query_names[0], query_sequences[0]))
+    {
+        msg_obj->print_not_enough_sequences();
+    }
+
+    if (PWA_obj->planner_obj != NULL)
+    {
+        plan_batch_memory(PWA_obj->planner_obj, msg_obj,
+                          query_sequences[0].length());
+    }
+
+    run_stages(file_obj, PWA_obj, NULL, msg_obj);
+    file_obj->close_record_stream();
+
+    msg_obj->print_batch_summary(pairs_aligned, number_of_threads);
+    if (PWA_obj->min_score_specified == 1)
+    {
+        msg_obj->print_min_score_summary(pairs_below_min_score,
+                                         PWA_obj->min_score);
+    }
+    if ((PWA_obj->time_limit > 0) || (PWA_obj->cell_limit > 0))
+    {
+        msg_obj->print_limit_summary(pairs_over_limit,
+                                     pairs_banded_fallback);
+    }
+
+}   // End PWA_pipeline::run_one_vs_many().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::run_multi_query()                               */
+/*-----------------------------------------------------------------------*/
+/* Loads every record of file_obj->queries_filename as a query, then     */
+/* streams every record of the input file through all of them: the       */
+/* results of query k are written, in input order, to                    */
+/* get_query_filename(output, k). Shards and checkpoints do not apply.   */
+/*=======================================================================*/
+void PWA_pipeline::run_multi_query(PWA_file *file_obj,
+                                   PWA_alignment *PWA_obj,
+                                   PWA_message *msg_obj)
+{
+    PWA_file  query_file;
+    PWA_store queries;
+    long      longest = 0;
+
+    query_file.input_filename = file_obj->queries_filename;
+    query_file.load_sequence_store(&queries);
+    if (queries.get_record_count() < 1)
+    {
+        msg_obj->print_not_enough_sequences();
+    }
+
+    // Decoded once, for every pair they are in.
+    query_names.resize(queries.get_record_count());
+    query_sequences.resize(queries.get_record_count());
+    for (long k = 0; k < queries.get_record_count(); k++)
+    {
+        queries.get_name(k, query_names[k]);
+        queries.get_sequence(k, query_sequences[k]);
+        longest = max(longest, (long)query_sequences[k].length());
+    }
+    multi_query       = 1;
+    shard_obj         = NULL;
+    progress_filename = NULL;
+    resume_specified  = 0;
+
+    if (PWA_obj->planner_obj != NULL)
+    {
+        plan_batch_memory(PWA_obj->planner_obj, msg_obj, longest);
+    }
+
+    file_obj->open_record_stream();
+    run_stages(file_obj, PWA_obj, NULL, msg_obj);
+    file_obj->close_record_stream();
+
+    msg_obj->print_batch_summary(pairs_aligned, number_of_threads);
+    if (PWA_obj->min_score_specified == 1)
+    {
+        msg_obj->print_min_score_summary(pairs_below_min_score,
+                                         PWA_obj->min_score);
+    }
+    if ((PWA_obj->time_limit > 0) || (PWA_obj->cell_limit > 0))
+    {
+        msg_obj->print_limit_summary(pairs_over_limit,
+                                     pairs_banded_fallback);
+    }
+    msg_obj->print_query_summary(query_names.size(), tasks_read,
+                                 file_obj->output_filename);
+
+}   // End PWA_pipeline::run_multi_query().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::run_all_vs_all()                                */
+/*-----------------------------------------------------------------------*/
+/* Loads every record into a sequence store, sketches them, and aligns   */
+/* each pair of records that prefilter_obj lets through. Pairs are       */
+/* written in order: (1, 2), (1, 3), ..., (2, 3), ...                    */
+/*=======================================================================*/
+void PWA_pipeline::run_all_vs_all(PWA_file *file_obj,
+                                  PWA_alignment *PWA_obj,
+                                  PWA_prefilter *prefilter_obj,
+                                  PWA_message *msg_obj)
+{
+    PWA_store records;
+    long longest = 0;
+
+    file_obj->load_sequence_store(&records);
+    if (records.get_record_count() < 2)
+    {
+        msg_obj->print_not_enough_sequences();
+    }
+    store_obj = &records;
+
+    if (PWA_obj->planner_obj != NULL)
+    {
+        for (long i = 0; i < records.get_record_count(); i++)
+        {
+            longest = max(longest, records.get_length(i));
+        }
+        plan_batch_memory(PWA_obj->planner_obj, msg_obj, longest);
+    }
+
+    if (shard_obj != NULL)
+    {
+        measure_all_vs_all();
+    }
+
+    prefilter_obj->sketch_records(&records);
+    run_stages(file_obj, PWA_obj, prefilter_obj, msg_obj);
+    store_obj = NULL;
+
+    msg_obj->print_batch_summary(pairs_aligned, number_of_threads);
+    if (PWA_obj->min_score_specified == 1)
+    {
+        msg_obj->print_min_score_summary(pairs_below_min_score,
+                                         PWA_obj->min_score);
+    }
+    if ((PWA_obj->time_limit > 0) || (PWA_obj->cell_limit > 0))
+    {
+        msg_obj->print_limit_summary(pairs_over_limit,
+                                     pairs_banded_fallback);
+    }
+    msg_obj->print_prefilter_summary(pairs_skipped,
+                                     prefilter_obj->min_similarity);
+
+}   // End PWA_pipeline::run_all_vs_all().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::run_score_matrix()                              */
+/*-----------------------------------------------------------------------*/
+/* Like run_all_vs_all(), but only keeps the score of each pair, and     */
+/* writes the scores (or distances, by value_type) to a binary matrix    */
+/* in the output file instead of the alignments. Pairs the prefilter     */
+/* skips, or that end without a score, are missing_score (NaN as a       */
+/* distance). Shards and checkpoints do not apply.                       */
+/*=======================================================================*/
+void PWA_pipeline::run_score_matrix(PWA_file *file_obj,
+                                    PWA_alignment *PWA_obj,
+                                    PWA_prefilter *prefilter_obj,
+                                    PWA_message *msg_obj, int value_type)
+{
+    PWA_store  records;
+    PWA_matrix matrix_obj;
+
+    file_obj->load_sequence_store(&records);
+    if (records.get_record_count() < 2)
+    {
+        msg_obj->print_not_enough_sequences();
+    }
+    store_obj = &records;
+
+    matrix_obj.value_type = value_type;
+    if (!matrix_obj.create_matrix_file(file_obj->output_filename, &records))
+    {
+        msg_obj->print_matrix_file_error(file_obj->output_filename);
+    }
+
+    if (value_type == PWA_matrix::value_distance)
+    {
+        // Each record scores best against itself without gaps.
+        vector<int> self_scores(records.get_record_count(), 0);
+        string sequence = "";
+
+        if (PWA_obj->score_table.empty())
+        {
+            PWA_obj->build_score_table();
+        }
+        for (long i = 0; i < records.get_record_count(); i++)
+        {
+            records.get_sequence(i, sequence);
+            for (size_t k = 0; k < sequence.length(); k++)
+            {
+                int c = (unsigned char)sequence[k];
+                self_scores[i] += PWA_obj->score_table[(c << 8) | c];
+            }
+        }
+        matrix_obj.set_self_scores(self_scores);
+    }
+
+    prefilter_obj->sketch_records(&records);
+
+    scheduler_obj.pin_threads = pin_threads;
+    scheduler_obj.start(number_of_threads);
+    queue_row_blocks();
+
+    vector<thread> workers;
+    for (int i = 0; i < number_of_threads; i++)
+    {
+        workers.push_back(thread(&PWA_pipeline::matrix_stage, this,
+                                 PWA_obj, prefilter_obj, &matrix_obj, i));
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    store_obj = NULL;
+
+    if (!matrix_obj.close_matrix_file() || (matrix_write_failed == 1))
+    {
+        msg_obj->print_matrix_file_error(file_obj->output_filename);
+    }
+
+    if (report_workers == 1)
+    {
+        msg_obj->print_worker_report(scheduler_obj.get_report());
+    }
+
+    msg_obj->print_batch_summary(pairs_aligned, number_of_threads);
+    if (PWA_obj->min_score_specified == 1)
+    {
+        msg_obj->print_min_score_summary(pairs_below_min_score,
+                                         PWA_obj->min_score);
+    }
+    if ((PWA_obj->time_limit > 0) || (PWA_obj->cell_limit > 0))
+    {
+        msg_obj->print_limit_summary(pairs_over_limit,
+                                     pairs_banded_fallback);
+    }
+    msg_obj->print_prefilter_summary(pairs_skipped,
+                                     prefilter_obj->min_similarity);
+    msg_obj->print_matrix_summary(records.get_record_count(),
+                                  file_obj->output_filename);
+
+}   // End PWA_pipeline::run_score_matrix().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::run_stages()                                    */
+/*-----------------------------------------------------------------------*/
+/* Opens the output file, starts the producer, worker and writer stages  */
+/* and waits for them to finish. The producer is the reader stage, or    */
+/* the pair stage if prefilter_obj is given. A shard writes its own      */
+/* file, which only gets its final name once the shard is complete.      */
+/*=======================================================================*/
+void PWA_pipeline::run_stages(PWA_file *file_obj, PWA_alignment *PWA_obj,
+                              PWA_prefilter *prefilter_obj,
+                              PWA_message *msg_obj)
+{
+    fstream output_file;
+    char *output_buffer = new char[output_buffer_size];
+    string output_filename = file_obj->output_filename;
+    string shard_filename  = "";
+
+    if (shard_obj != NULL)
+    {
+        shard_filename  = shard_obj->get_shard_filename(
+                              file_obj->output_filename,
+                              shard_obj->shard_index);
+        output_filename = shard_filename + ".tmp";
+    }
+
+    output_path     = output_filename;
+    run_fingerprint = get_run_fingerprint(file_obj, PWA_obj, prefilter_obj);
+    if (resume_specified == 1)
+    {
+        load_progress(msg_obj);
+    }
+
+    // Large buffer so the writer issues few, big writes.
+    output_file.rdbuf()->pubsetbuf(output_buffer, output_buffer_size);
+    if (multi_query == 1)
+    {
+        open_query_files(file_obj);
+    }
+    else if (resume_index > 0)
+    {
+        // Anything after the last checkpoint is written again.
+        if (truncate(output_filename.c_str(), output_bytes) != 0)
+        {
+            msg_obj->print_cannot_resume(output_filename);
+        }
+        output_file.open(output_filename.c_str(),
+                         fstream::out | fstream::app);
+    }
+    else
+    {
+        output_file.open(output_filename.c_str(),
+                         fstream::out | fstream::trunc);
+    }
+    if (multi_query == 0)
+    {
+        file_obj->check_file_status(output_file,
+                                    (char *)output_filename.c_str());
+    }
+
+    // Every worker needs a pair in flight, and one more to move on to
+    // (or a group of them when interleaving).
+    queue_capacity = max(queue_capacity, 2 * number_of_threads);
+    if (interleave_pairs == 1)
+    {
+        queue_capacity = max(queue_capacity,
+                             2 * PWA_interleave::group_size *
+                             number_of_threads);
+    }
+    scheduler_obj.pin_threads = pin_threads;
+    scheduler_obj.start(number_of_threads);
+
+    thread producer;
+    if (prefilter_obj == NULL)
+    {
+        producer = thread(&PWA_pipeline::reader_stage, this, file_obj);
+    }
+    else
+    {
+        producer = thread(&PWA_pipeline::pair_stage, this, prefilter_obj);
+    }
+    thread writer(&PWA_pipeline::writer_stage, this, ref(output_file));
+
+    vector<thread> workers;
+    for (int i = 0; i < number_of_threads; i++)
+    {
+        workers.push_back(thread(&PWA_pipeline::worker_stage, this,
+                                 file_obj, PWA_obj, i));
+    }
+
+    producer.join();
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    writer.join();
+
+    output_file.close();
+    delete[] output_buffer;
+    close_query_files();
+
+    if (report_workers == 1)
+    {
+        msg_obj->print_worker_report(scheduler_obj.get_report());
+    }
+
+    if (shard_obj != NULL)
+    {
+        rename(output_filename.c_str(), shard_filename.c_str());
+    }
+
+}   // End PWA_pipeline::run_stages().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::measure_one_vs_many()                           */
+/*-----------------------------------------------------------------------*/
+/* Reads the input once to add up the cells of every query-target pair,  */
+/* which the shards are balanced on. Only the lengths are kept.          */
+/*=======================================================================*/
+void PWA_pipeline::measure_one_vs_many(PWA_file *file_obj)
+{
+    string name     = "";
+    string sequence = "";
+    long   query_length = 0;
+
+    shard_obj->total_cells = 0;
+    file_obj->open_record_stream();
+
+    if (file_obj->get_next_record(name, sequence))
+    {
+        query_length = sequence.length();
+    }
+    while (file_obj->get_next_record(name, sequence))
+    {
+        shard_obj->total_cells += (query_length + 1) *
+                                  ((long)sequence.length() + 1);
+    }
+
+    file_obj->close_record_stream();
+
+}   // End PWA_pipeline::measure_one_vs_many().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::measure_all_vs_all()                            */
+/*-----------------------------------------------------------------------*/
+/* Adds up the cells of every pair of stored records. Pairs the          */
+/* prefilter will skip are included, so that every shard computes the    */
+/* same split without running the prefilter on every row.                */
+/*=======================================================================*/
+void PWA_pipeline::measure_all_vs_all(void)
+{
+    long later_weight = 0;
+
+    shard_obj->total_cells = 0;
+    for (long i = store_obj->get_record_count() - 1; i >= 0; i--)
+    {
+        long weight = store_obj->get_length(i) + 1;
+
+        shard_obj->total_cells += weight * later_weight;
+        later_weight += weight;
+    }
+
+}   // End PWA_pipeline::measure_all_vs_all().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::plan_batch_memory()                             */
+/*-----------------------------------------------------------------------*/
+/* Splits the memory budget between the worker threads. Unless the user  */
+/* fixed the number of threads, the planner chooses it, taking pairs of  */
+/* the given length as typical. Each worker then plans each of its       */
+/* pairs within its share of the budget; the plan for a typical pair is  */
+/* reported here.                                                        */
+/*=======================================================================*/
+void PWA_pipeline::plan_batch_memory(PWA_planner *planner_obj,
+                                     PWA_message *msg_obj, long length)
+{
+    long   predicted_bytes = 0;
+    string engine          = "";
+
+    if (threads_specified == 0)
+    {
+        number_of_threads = planner_obj->plan_threads(length, length,
+                                                      number_of_threads);
+    }
+
+    planner_obj->memory_per_thread = planner_obj->max_memory_bytes /
+                                     number_of_threads;
+
+    engine = planner_obj->plan_alignment(length, length, &predicted_bytes);
+    msg_obj->print_memory_plan(engine, predicted_bytes,
+                               planner_obj->max_memory_bytes,
+                               number_of_threads);
+
+}   // End PWA_pipeline::plan_batch_memory().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::reader_stage()                                  */
+/*-----------------------------------------------------------------------*/
+/* Streams the remaining records into the scheduler. Blocks while        */
+/* queue_capacity records are already in flight, so a slow worker or     */
+/* writer stops the reader instead of letting memory grow. Records of    */
+/* other shards are read and dropped.                                    */
+/*=======================================================================*/
+void PWA_pipeline::reader_stage(PWA_file *file_obj)
+{
+    string name     = "";
+    string sequence = "";
+    long   query_weight = 0;
+    long   start_cells  = 0;
+
+    for (size_t k = 0; k < query_sequences.size(); k++)
+    {
+        query_weight += query_sequences[k].length() + 1;
+    }
+
+    while (file_obj->get_next_record(name, sequence))
+    {
+        long pair_cells = query_weight * ((long)sequence.length() + 1);
+
+        start_cells += pair_cells;
+        if ((shard_obj != NULL) &&
+            !shard_obj->owns_pair(start_cells - pair_cells, pair_cells))
+        {
+            continue;
+        }
+
+        PWA_task *task = new PWA_task;
+        task->record_1 = -1;
+        task->record_2 = -1;
+        task->name.swap(name);
+        task->sequence.swap(sequence);
+
+        queue_task(task);
+    }
+
+    finish_reading();
+
+}   // End PWA_pipeline::reader_stage().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::pair_stage()                                    */
+/*-----------------------------------------------------------------------*/
+/* Queues every pair of stored records that passes the prefilter and     */
+/* counts the others in pairs_skipped. The sequences are decoded by the  */
+/* workers, so a queued pair costs only a few bytes until it is aligned. */
+/*                                                                       */
+/* With a shard, rows of pairs wholly before the shard are passed over   */
+/* and the stage stops at the first row wholly after it. In the pair     */
+/* order (i, i+1), ..., (i, n-1), the pair (i, j) starts at              */
+/*     row_start + weight[i] * (weight[i+1] + ... + weight[j-1])         */
+/* cells, where weight[k] is the length of record k plus 1.              */
+/*=======================================================================*/
+void PWA_pipeline::pair_stage(PWA_prefilter *prefilter_obj)
+{
+    long         records = store_obj->get_record_count();
+    vector<long> partners;
+    vector<long> weight_before(records + 1, 0);
+    long         row_start = 0;
+
+    for (long k = 0; k < records; k++)
+    {
+        weight_before[k+1] = weight_before[k] + store_obj->get_length(k) + 1;
+    }
+
+    for (long i = 0; i + 1 < records; i++)
+    {
+        long weight    = store_obj->get_length(i) + 1;
+        long row_cells = weight * (weight_before[records] -
+                                   weight_before[i+1]);
+        long in_shard  = 0;
+        long queued    = 0;
+
+        if (shard_obj != NULL)
+        {
+            long last_start = row_start + weight *
+                              (weight_before[records-1] - weight_before[i+1]);
+            long last_cells = weight * (store_obj->get_length(records-1) + 1);
+            long first_cells = weight * (store_obj->get_length(i+1) + 1);
+
+            if (shard_obj->get_pair_shard(row_start, first_cells) >
+                shard_obj->shard_index)
+            {
+                break;
+            }
+            if (shard_obj->get_pair_shard(last_start, last_cells) <
+                shard_obj->shard_index)
+            {
+                row_start += row_cells;
+                continue;
+            }
+        }
+
+        prefilter_obj->get_candidate_pairs(i, partners);
+
+        for (long j = i + 1, p = 0; j < records; j++)
+        {
+            long start_cells = row_start + weight *
+                               (weight_before[j] - weight_before[i+1]);
+            long pair_cells  = weight * (store_obj->get_length(j) + 1);
+            bool candidate   = ((size_t)p < partners.size()) &&
+                               (partners[p] == j);
+
+            p += candidate;
+            if ((shard_obj != NULL) &&
+                !shard_obj->owns_pair(start_cells, pair_cells))
+            {
+                continue;
+            }
+
+            in_shard++;
+            if (candidate)
+            {
+                PWA_task *task = new PWA_task;
+                task->record_1 = i;
+                task->record_2 = j;
+
+                queue_task(task);
+                queued++;
+            }
+        }
+
+        pairs_skipped += in_shard - queued;
+        row_start     += row_cells;
+    }
+
+    finish_reading();
+
+}   // End PWA_pipeline::pair_stage().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::queue_task()                                    */
+/*-----------------------------------------------------------------------*/
+/* Numbers task and hands it to the scheduler. Blocks while              */
+/* queue_capacity tasks are already in flight. Tasks written before a    */
+/* resume are numbered and dropped.                                      */
+/*=======================================================================*/
+void PWA_pipeline::queue_task(PWA_task *task)
+{
+    unique_lock<mutex> lock(pipeline_mutex);
+
+    if (tasks_read < resume_index)
+    {
+        tasks_read++;
+        delete task;
+        return;
+    }
+
+    slot_free.wait(lock, [this]
+                   { return tasks_in_flight < queue_capacity; });
+
+    task->index = tasks_read++;
+    tasks_in_flight++;
+    lock.unlock();
+
+    scheduler_obj.push_task(task);
+
+}   // End PWA_pipeline::queue_task().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::finish_reading()                                */
+/*-----------------------------------------------------------------------*/
+/* Tells the workers and the writer that no more tasks will be queued.   */
+/*=======================================================================*/
+void PWA_pipeline::finish_reading(void)
+{
+    scheduler_obj.close();
+
+    lock_guard<mutex> lock(pipeline_mutex);
+    reading_done = 1;
+    task_finished.notify_all();
+
+}   // End PWA_pipeline::finish_reading().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::worker_stage()                                  */
+/*-----------------------------------------------------------------------*/
+/* Aligns the pairs the scheduler gives worker until the producer is     */
+/* done and no pairs are left, helping other workers with the tiles of   */
+/* their large pairs in between. With interleave_pairs, a medium-sized   */
+/* nw pair is aligned together with up to group_size - 1 other such      */
+/* pairs queued at the time (see PWA_interleave). With several queries,  */
+/* the record of each task is aligned with all of them, one after the    */
+/* other.                                                                */
+/*=======================================================================*/
+void PWA_pipeline::worker_stage(PWA_file *file_obj, PWA_alignment *PWA_obj,
+                                int worker)
+{
+    // Pinned first, so the buffers below are first touched on this node.
+    scheduler_obj.pin_worker(worker);
+
+    PWA_profile  worker_profile;
+    PWA_profile *profile_obj = begin_worker_profile(PWA_obj, worker_profile);
+
+    // One object per lane, each keeping its own matrix.
+    PWA_alignment worker_objs[PWA_interleave::group_size];
+    size_t lanes = ((interleave_pairs == 1) && (multi_query == 0))
+                 ? PWA_interleave::group_size : 1;
+    for (size_t g = 0; g < lanes; g++)
+    {
+        worker_objs[g].copy_settings_from(PWA_obj);
+        worker_objs[g].scheduler_obj = &scheduler_obj;
+        worker_objs[g].worker_index  = worker;
+        worker_objs[g].profile_obj   = profile_obj;
+    }
+    PWA_interleave interleave_obj;
+
+    PWA_task *task = NULL;
+    while ((task = scheduler_obj.get_task(worker)) != NULL)
+    {
+        vector<PWA_task*>      tasks(1, task);
+        vector<PWA_alignment*> group(1, &worker_objs[0]);
+
+        if (multi_query == 1)
+        {
+            task->query_outputs.resize(query_sequences.size());
+            for (size_t k = 0; k < query_sequences.size(); k++)
+            {
+                load_task(task, group[0], k);
+                group[0]->begin_PWA_alignment(NULL);
+                finish_task(file_obj, task, group[0], k);
+            }
+            continue;
+        }
+
+        load_task(task, group[0], 0);
+        if ((lanes > 1) && PWA_interleave::can_interleave(group[0]))
+        {
+            // Only pairs already queued; other pairs are aligned alone.
+            PWA_task *next = NULL;
+            while ((group.size() < lanes) &&
+                   ((next = scheduler_obj.try_get_task(worker)) != NULL))
+            {
+                PWA_alignment *next_obj = &worker_objs[group.size()];
+
+                load_task(next, next_obj, 0);
+                if (PWA_interleave::can_interleave(next_obj))
+                {
+                    tasks.push_back(next);
+                    group.push_back(next_obj);
+                }
+                else
+                {
+                    next_obj->begin_PWA_alignment(NULL);
+                    finish_task(file_obj, next, next_obj, 0);
+                }
+            }
+        }
+
+        if (group.size() == 1)
+        {
+            group[0]->begin_PWA_alignment(NULL);
+        }
+        else
+        {
+            if (profile_obj != NULL)
+            {
+                profile_obj->begin_phase("interleave");
+            }
+            interleave_obj.begin_interleaved_alignments(group);
+            if (profile_obj != NULL)
+            {
+                profile_obj->end_phase();
+            }
+        }
+
+        for (size_t g = 0; g < group.size(); g++)
+        {
+            finish_task(file_obj, tasks[g], group[g], 0);
+        }
+    }
+
+    end_worker_profile(PWA_obj, profile_obj);
+
+}   // End PWA_pipeline::worker_stage().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::begin_worker_profile()                          */
+/*-----------------------------------------------------------------------*/
+/* With --profile, opens the counters of worker_profile for the calling  */
+/* worker thread and returns it, for the worker's alignment objects to   */
+/* profile their phases in; returns NULL otherwise. The profile of       */
+/* PWA_obj is not shared, as phases are not thread safe.                 */
+/*=======================================================================*/
+PWA_profile *PWA_pipeline::begin_worker_profile(PWA_alignment *PWA_obj,
+                                                PWA_profile &worker_profile)
+{
+    if (PWA_obj->profile_obj == NULL)
+    {
+        return (NULL);
+    }
+
+    worker_profile.open_counters();
+    return (&worker_profile);
+
+}   // End PWA_pipeline::begin_worker_profile().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::end_worker_profile()                            */
+/*-----------------------------------------------------------------------*/
+/* Closes the counters of a worker's profile, if any, and adds its       */
+/* phases to the profile of PWA_obj that is reported at the end.         */
+/*=======================================================================*/
+void PWA_pipeline::end_worker_profile(PWA_alignment *PWA_obj,
+                                      PWA_profile *worker_profile)
+{
+    if (worker_profile == NULL)
+    {
+        return;
+    }
+
+    worker_profile->close_counters();
+
+    lock_guard<mutex> lock(pipeline_mutex);
+    PWA_obj->profile_obj->add_profile(*worker_profile);
+
+}   // End PWA_pipeline::end_worker_profile().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::load_task()                                     */
+/*-----------------------------------------------------------------------*/
+/* Resets worker_obj and gives it the names and sequences of task, and,  */
+/* for a pair of stored records, the store they are packed in. In        */
+/* one-vs-many mode, the record of task is paired with the given query.  */
+/*=======================================================================*/
+void PWA_pipeline::load_task(PWA_task *task, PWA_alignment *worker_obj,
+                             int query)
+{
+    worker_obj->reset_alignment();
+    if (task->record_1 < 0)
+    {
+        worker_obj->names_vector.push_back(query_names[query]);
+        worker_obj->names_vector.push_back(task->name);
+        worker_obj->sequences_vector.push_back(query_sequences[query]);
+        worker_obj->sequences_vector.push_back(task->sequence);
+    }
+    else
+    {
+        string name_1     = "";
+        string name_2     = "";
+        string sequence_1 = "";
+        string sequence_2 = "";
+
+        store_obj->get_name(task->record_1, name_1);
+        store_obj->get_name(task->record_2, name_2);
+        store_obj->get_sequence(task->record_1, sequence_1);
+        store_obj->get_sequence(task->record_2, sequence_2);
+
+        worker_obj->names_vector.push_back(name_1);
+        worker_obj->names_vector.push_back(name_2);
+        worker_obj->sequences_vector.push_back(sequence_1);
+        worker_obj->sequences_vector.push_back(sequence_2);
+        worker_obj->store_obj        = store_obj;
+        worker_obj->store_records[0] = task->record_1;
+        worker_obj->store_records[1] = task->record_2;
+    }
+
+}   // End PWA_pipeline::load_task().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::finish_task()                                   */
+/*-----------------------------------------------------------------------*/
+/* Stores the formatted result of worker_obj in task (as the output of   */
+/* query, with several queries), so that the writer only has to copy     */
+/* bytes, and hands task to the writer after its last query. Pairs       */
+/* abandoned below the minimum score or rejected by the diagonal filter  */
+/* are counted but not written; pairs over a time or cell limit are      */
+/* counted and written with a note.                                      */
+/*=======================================================================*/
+void PWA_pipeline::finish_task(PWA_file *file_obj, PWA_task *task,
+                               PWA_alignment *worker_obj, int query)
+{
+    bool last_query      = ((size_t)query + 1 >= query_sequences.size());
+    bool below_min_score = (worker_obj->alignment_status ==
+                            PWA_alignment::status_below_min_score);
+    bool filtered        = (worker_obj->alignment_status ==
+                            PWA_alignment::status_filtered);
+    if (!below_min_score && !filtered)
+    {
+        ostringstream results;
+        file_obj->write_alignment_results(results, worker_obj);
+        if (multi_query == 1)
+        {
+            task->query_outputs[query] = results.str();
+        }
+        else
+        {
+            task->output = results.str();
+        }
+    }
+
+    // The target sequence is no longer needed.
+    if (last_query)
+    {
+        string().swap(task->sequence);
+    }
+
+    lock_guard<mutex> lock(pipeline_mutex);
+    pairs_below_min_score += below_min_score;
+    pairs_over_limit      += (worker_obj->alignment_status ==
+                              PWA_alignment::status_over_limit);
+    pairs_banded_fallback += (worker_obj->alignment_status ==
+                              PWA_alignment::status_banded_fallback);
+    if (last_query)
+    {
+        finished_tasks[task->index] = task;
+        task_finished.notify_one();
+    }
+
+}   // End PWA_pipeline::finish_task().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::writer_stage()                                  */
+/*-----------------------------------------------------------------------*/
+/* Writes finished tasks in input order. Tasks that finish early wait    */
+/* in finished_tasks until all earlier tasks have been written; each     */
+/* written task frees a slot for the reader. Every checkpoint_pairs      */
+/* tasks or checkpoint_seconds, and at the end, the progress is saved.   */
+/*=======================================================================*/
+void PWA_pipeline::writer_stage(fstream &output_file)
+{
+    long next_index      = resume_index;
+    long last_checkpoint = resume_index;
+    chrono::steady_clock::time_point checkpoint_time =
+        chrono::steady_clock::now();
+
+    for (;;)
+    {
+        PWA_task *task = NULL;
+        {
+            unique_lock<mutex> lock(pipeline_mutex);
+            task_finished.wait(lock, [this, next_index]
+                               { return finished_tasks.count(next_index) ||
+                                        (reading_done &&
+                                         next_index >= tasks_read); });
+
+            if (finished_tasks.count(next_index) == 0)
+            {
+                break;
+            }
+            task = finished_tasks[next_index];
+            finished_tasks.erase(next_index);
+        }
+
+        output_file << task->output;
+        output_bytes += task->output.length();
+        for (size_t k = 0; k < task->query_outputs.size(); k++)
+        {
+            *query_files[k] << task->query_outputs[k];
+        }
+        delete task;
+        next_index++;
+
+        if ((progress_filename != NULL) &&
+            ((next_index - last_checkpoint >= checkpoint_pairs) ||
+             (chrono::steady_clock::now() - checkpoint_time >=
+              chrono::seconds(checkpoint_seconds))))
+        {
+            save_progress(output_file, next_index);
+            last_checkpoint = next_index;
+            checkpoint_time = chrono::steady_clock::now();
+        }
+
+        lock_guard<mutex> lock(pipeline_mutex);
+        tasks_in_flight--;
+        pairs_aligned += (multi_query == 1) ? query_sequences.size() : 1;
+        slot_free.notify_one();
+    }
+
+    if (progress_filename != NULL)
+    {
+        save_progress(output_file, next_index);
+    }
+
+}   // End PWA_pipeline::writer_stage().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::open_query_files()                              */
+/*-----------------------------------------------------------------------*/
+/* Creates the output file of each query, named after the output file    */
+/* of file_obj (see get_query_filename()).                               */
+/*=======================================================================*/
+void PWA_pipeline::open_query_files(PWA_file *file_obj)
+{
+    for (size_t k = 0; k < query_sequences.size(); k++)
+    {
+        string filename = get_query_filename(file_obj->output_filename,
+                                             k + 1);
+        fstream *query_file = new fstream(filename.c_str(),
+                                          fstream::out | fstream::trunc);
+
+        file_obj->check_file_status(*query_file, (char *)filename.c_str());
+        query_files.push_back(query_file);
+    }
+
+}   // End PWA_pipeline::open_query_files().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::close_query_files()                             */
+/*-----------------------------------------------------------------------*/
+/* Closes the output files of the queries, if any are open.              */
+/*=======================================================================*/
+void PWA_pipeline::close_query_files(void)
+{
+    for (size_t k = 0; k < query_files.size(); k++)
+    {
+        query_files[k]->close();
+        delete query_files[k];
+    }
+    query_files.clear();
+
+}   // End PWA_pipeline::close_query_files().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::get_query_filename()                            */
+/*-----------------------------------------------------------------------*/
+/* Returns the output filename of query number query (from 1), such as   */
+/* OUTPUT.q3 for the third query.                                        */
+/*=======================================================================*/
+string PWA_pipeline::get_query_filename(const string &output_filename,
+                                        int query)
+{
+    ostringstream filename;
+    filename << output_filename << ".q" << query;
+
+    return (filename.str());
+
+}   // End PWA_pipeline::get_query_filename().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::queue_row_blocks()                              */
+/*-----------------------------------------------------------------------*/
+/* Splits the rows of the score matrix into blocks of consecutive rows   */
+/* and queues each block as one task. A block holds at least one row and */
+/* about 1/16 of a worker's share of the pairs, so the short rows at the */
+/* end are grouped, and there are enough blocks for the workers to steal */
+/* from each other when some rows take longer.                           */
+/*=======================================================================*/
+void PWA_pipeline::queue_row_blocks(void)
+{
+    long records      = store_obj->get_record_count();
+    long pairs        = (records * (records - 1)) / 2;
+    long block_pairs  = max(1L, pairs / (16L * number_of_threads));
+    long blocks       = 0;
+
+    for (long first = 0; first + 1 < records; blocks++)
+    {
+        long last        = first;
+        long block_total = 0;
+
+        while ((last + 1 < records) && (block_total < block_pairs))
+        {
+            block_total += records - 1 - last;
+            last++;
+        }
+
+        PWA_task *task = new PWA_task;
+        task->index    = blocks;
+        task->record_1 = first;
+        task->record_2 = last;
+        scheduler_obj.push_task(task);
+
+        first = last;
+    }
+
+    scheduler_obj.close();
+
+}   // End PWA_pipeline::queue_row_blocks().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::matrix_stage()                                  */
+/*-----------------------------------------------------------------------*/
+/* Scores every pair of each block of rows the scheduler gives worker,   */
+/* and writes the block to matrix_obj. Blocks never overlap in the file, */
+/* so workers need no lock to write; the counts are added up once, at    */
+/* the end.                                                              */
+/*=======================================================================*/
+void PWA_pipeline::matrix_stage(PWA_alignment *PWA_obj,
+                                PWA_prefilter *prefilter_obj,
+                                PWA_matrix *matrix_obj, int worker)
+{
+    scheduler_obj.pin_worker(worker);
+
+    PWA_profile  worker_profile;
+    PWA_alignment worker_obj;
+    worker_obj.copy_settings_from(PWA_obj);
+    worker_obj.scheduler_obj = &scheduler_obj;
+    worker_obj.worker_index  = worker;
+    worker_obj.profile_obj   = begin_worker_profile(PWA_obj, worker_profile);
+
+    long         records = store_obj->get_record_count();
+    vector<long> partners;
+    vector<int>  scores;
+    long aligned         = 0;
+    long below_min_score = 0;
+    long over_limit      = 0;
+    long banded_fallback = 0;
+    long skipped         = 0;
+    bool write_failed    = 0;
+
+    PWA_task *task = NULL;
+    while ((task = scheduler_obj.get_task(worker)) != NULL)
+    {
+        scores.clear();
+        for (long i = task->record_1; i < task->record_2; i++)
+        {
+            prefilter_obj->get_candidate_pairs(i, partners);
+
+            for (long j = i + 1, p = 0; j < records; j++)
+            {
+                if (((size_t)p >= partners.size()) || (partners[p] != j))
+                {
+                    scores.push_back(PWA_matrix::missing_score);
+                    skipped++;
+                    continue;
+                }
+                p++;
+
+                PWA_task pair;
+                pair.record_1 = i;
+                pair.record_2 = j;
+                load_task(&pair, &worker_obj, 0);
+                worker_obj.begin_PWA_alignment(NULL);
+
+                int status = worker_obj.alignment_status;
+                if ((status == PWA_alignment::status_complete) ||
+                    (status == PWA_alignment::status_banded_fallback))
+                {
+                    scores.push_back(worker_obj.alignment_score);
+                }
+                else
+                {
+                    scores.push_back(PWA_matrix::missing_score);
+                }
+
+                aligned++;
+                below_min_score += (status ==
+                                    PWA_alignment::status_below_min_score);
+                over_limit      += (status ==
+                                    PWA_alignment::status_over_limit);
+                banded_fallback += (status ==
+                                    PWA_alignment::status_banded_fallback);
+            }
+        }
+
+        if (!matrix_obj->write_rows(task->record_1, scores))
+        {
+            write_failed = 1;
+        }
+        delete task;
+    }
+
+    end_worker_profile(PWA_obj, worker_obj.profile_obj);
+
+    lock_guard<mutex> lock(pipeline_mutex);
+    pairs_aligned         += aligned;
+    pairs_below_min_score += below_min_score;
+    pairs_over_limit      += over_limit;
+    pairs_banded_fallback += banded_fallback;
+    pairs_skipped         += skipped;
+    matrix_write_failed    = matrix_write_failed || write_failed;
+
+}   // End PWA_pipeline::matrix_stage().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::get_run_fingerprint()                           */
+/*-----------------------------------------------------------------------*/
+/* Returns a hash of everything that decides which tasks a run queues    */
+/* and what it writes for them: the path, size and modification time of  */
+/* the input, the mode, scoring scheme and alignment options, and the    */
+/* shard. A progress file is only valid for a run with the same one.     */
+/*=======================================================================*/
+string PWA_pipeline::get_run_fingerprint(PWA_file *file_obj,
+                                         PWA_alignment *PWA_obj,
+                                         PWA_prefilter *prefilter_obj)
+{
+    ostringstream run;
+    ostringstream fingerprint;
+    struct stat   input_status;
+
+    run << "input=" << file_obj->input_filename;
+    if (stat(file_obj->input_filename, &input_status) == 0)
+    {
+        run << " size=" << (long)input_status.st_size;
+        run << " mtime=" << (long)input_status.st_mtime;
+    }
+
+    run << " mode=" << ((prefilter_obj != NULL) ? "all-vs-all" : "batch");
+    if (prefilter_obj != NULL)
+    {
+        run << " similarity=" << prefilter_obj->min_similarity;
+    }
+    run << " " << PWA_obj->get_scoring_scheme();
+    run << " engine=" << PWA_obj->engine;
+    run << " band=" << PWA_obj->band_width;
+    run << " xdrop=" << PWA_obj->xdrop;
+    run << " strands=" << PWA_obj->both_strands;
+    run << " min_score=" << (PWA_obj->min_score_specified
+                             ? PWA_obj->min_score : 0);
+    run << " time=" << PWA_obj->time_limit;
+    run << " cells=" << PWA_obj->cell_limit;
+    run << " fallback=" << PWA_obj->limit_fallback;
+    if (PWA_obj->diagonal_obj != NULL)
+    {
+        run << " diagonal=" << PWA_obj->diagonal_obj->min_diagonal_score;
+    }
+    if (shard_obj != NULL)
+    {
+        run << " shard=" << shard_obj->shard_index << "/"
+            << shard_obj->number_of_shards;
+    }
+
+    // FNV-1a, 64 bits.
+    unsigned long long hash = 14695981039346656037ULL;
+    string text = run.str();
+    for (size_t k = 0; k < text.length(); k++)
+    {
+        hash = (hash ^ (unsigned char)text[k]) * 1099511628211ULL;
+    }
+    fingerprint << hex << hash;
+
+    return (fingerprint.str());
+
+}   // End PWA_pipeline::get_run_fingerprint().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::load_progress()                                 */
+/*-----------------------------------------------------------------------*/
+/* Reads the number of tasks and output bytes written by an earlier run  */
+/* from progress_filename. Without a progress file the run starts from   */
+/* the beginning. A progress file that cannot be read, is corrupt, or    */
+/* was written by a run with another fingerprint is refused, as is an    */
+/* output shorter than the progress file says, rather than starting      */
+/* over or appending to output of a different run.                       */
+/*=======================================================================*/
+void PWA_pipeline::load_progress(PWA_message *msg_obj)
+{
+    ifstream progress_file;
+    string   magic       = "";
+    string   fingerprint = "";
+    int      version     = 0;
+    struct stat status;
+
+    resume_index = 0;
+    output_bytes = 0;
+
+    if (stat(progress_filename, &status) != 0)
+    {
+        return;
+    }
+
+    progress_file.open(progress_filename);
+    if (!(progress_file >> magic >> version >> fingerprint
+                        >> resume_index >> output_bytes) ||
+        (magic != "PWA_PROGRESS") || (version != 2) ||
+        (resume_index < 0) || (output_bytes < 0))
+    {
+        msg_obj->print_invalid_progress(progress_filename);
+    }
+    if (fingerprint != run_fingerprint)
+    {
+        msg_obj->print_progress_mismatch(progress_filename);
+    }
+
+    if ((stat(output_path.c_str(), &status) != 0) ||
+        (status.st_size < output_bytes))
+    {
+        msg_obj->print_cannot_resume(output_path);
+    }
+
+    msg_obj->print_resume_summary(resume_index, output_bytes);
+
+}   // End PWA_pipeline::load_progress().
+
+
+/*=======================================================================*/
+/* Method: PWA_pipeline::save_progress()                                 */
+/*-----------------------------------------------------------------------*/
+/* Flushes output_file and syncs it to disk, then records the run        */
+/* fingerprint, tasks_written and output_bytes in progress_filename.     */
+/* The progress file is synced too and replaced through a rename, so     */
+/* even after a crash it only describes output that is on disk. If it    */
+/* cannot be written, the previous one, which describes less output, is  */
+/* kept.                                                                 */
+/*=======================================================================*/
+void PWA_pipeline::save_progress(fstream &output_file, long tasks_written)
+{
+    string temporary_filename = string(progress_filename) + ".tmp";
+
+    output_file.flush();
+    int output_fd = open(output_path.c_str(), O_WRONLY);
+    if ((output_fd < 0) || (fsync(output_fd) != 0))
+    {
+        if (output_fd >= 0)
+        {
+            close(output_fd);
+        }
+        return;
+    }
+    close(output_fd);
+
+    ofstream progress_file(temporary_filename.c_str(),
+                           ofstream::out | ofstream::trunc);
+    progress_file << "PWA_PROGRESS 2" << endl;
+    progress_file << run_fingerprint << endl;
+    progress_file << tasks_written << " " << output_bytes << endl;
+    progress_file.close();
+
+    int progress_fd = open(temporary_filename.c_str(), O_WRONLY);
+    bool synced     = (progress_fd >= 0) && (fsync(progress_fd) == 0);
+    if (progress_fd >= 0)
+    {
+        close(progress_fd);
+    }
+
+    if (progress_file.fail() || !synced ||
+        (rename(temporary_filename.c_str(), progress_filename) != 0))
+    {
+        remove(temporary_filename.c_str());
+    }
+
+}   // End PWA_pipeline::save_progress().
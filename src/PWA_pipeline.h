@@ -0,0 +1,136 @@
+#ifndef PWA_PIPELINE_H
+#define PWA_PIPELINE_H
+
+#include "PWA_alignment.h"
+#include "PWA_file.h"
+#include "PWA_matrix.h"
+#include "PWA_message.h"
+#include "PWA_planner.h"
+#include "PWA_prefilter.h"
+#include "PWA_profile.h"
+#include "PWA_scheduler.h"
+#include "PWA_shard.h"
+#include "PWA_store.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// One pair travelling through the pipeline. In one-vs-many mode the
+// target record is carried in name and sequence (and is aligned with
+// every query, with --queries); in all-vs-all mode the pair is record_1
+// and record_2 of the sequence store. For a score matrix, a task is the
+// block of rows record_1 to record_2 - 1.
+struct PWA_task
+{
+    long   index;
+    long   record_1;
+    long   record_2;
+    string name;
+    string sequence;
+    string output;
+    vector<string> query_outputs;   // One per query with --queries.
+};
+
+class PWA_pipeline
+{
+public:
+    PWA_pipeline();
+    void run_one_vs_many(PWA_file *file_obj, PWA_alignment *PWA_obj,
+                         PWA_message *msg_obj);
+    void run_multi_query(PWA_file *file_obj, PWA_alignment *PWA_obj,
+                         PWA_message *msg_obj);
+    void run_all_vs_all(PWA_file *file_obj, PWA_alignment *PWA_obj,
+                        PWA_prefilter *prefilter_obj,
+                        PWA_message *msg_obj);
+    void run_score_matrix(PWA_file *file_obj, PWA_alignment *PWA_obj,
+                          PWA_prefilter *prefilter_obj,
+                          PWA_message *msg_obj, int value_type);
+
+    int  number_of_threads;
+    bool threads_specified;
+    int  queue_capacity;
+    long pairs_aligned;
+    long pairs_below_min_score;
+    long pairs_over_limit;      // Abandoned at --time-limit/--cell-limit.
+    long pairs_banded_fallback; // Aligned with banded at a limit instead.
+    long pairs_skipped;     // By the all-vs-all prefilter.
+    PWA_shard *shard_obj;   // NULL to run every pair.
+
+    char *progress_filename;    // NULL for no checkpoints.
+    bool  resume_specified;
+    long  checkpoint_pairs;     // Checkpoint after this many pairs
+    int   checkpoint_seconds;   // or this many seconds.
+
+    bool pin_threads;       // Pin each worker to a CPU.
+    bool report_workers;    // Print each worker's utilization.
+    bool interleave_pairs;  // Fill medium nw pairs in groups.
+
+private:
+    void run_stages(PWA_file *file_obj, PWA_alignment *PWA_obj,
+                    PWA_prefilter *prefilter_obj, PWA_message *msg_obj);
+    void measure_one_vs_many(PWA_file *file_obj);
+    void measure_all_vs_all(void);
+    void plan_batch_memory(PWA_planner *planner_obj, PWA_message *msg_obj,
+                           long length);
+    void queue_task(PWA_task *task);
+    void finish_reading(void);
+    void reader_stage(PWA_file *file_obj);
+    void pair_stage(PWA_prefilter *prefilter_obj);
+    void worker_stage(PWA_file *file_obj, PWA_alignment *PWA_obj,
+                      int worker);
+    PWA_profile *begin_worker_profile(PWA_alignment *PWA_obj,
+                                      PWA_profile &worker_profile);
+    void end_worker_profile(PWA_alignment *PWA_obj,
+                            PWA_profile *worker_profile);
+    void load_task(PWA_task *task, PWA_alignment *worker_obj, int query);
+    void finish_task(PWA_file *file_obj, PWA_task *task,
+                     PWA_alignment *worker_obj, int query);
+    void writer_stage(fstream &output_file);
+    void open_query_files(PWA_file *file_obj);
+    void close_query_files(void);
+    string get_query_filename(const string &output_filename, int query);
+    void queue_row_blocks(void);
+    void matrix_stage(PWA_alignment *PWA_obj, PWA_prefilter *prefilter_obj,
+                      PWA_matrix *matrix_obj, int worker);
+    string get_run_fingerprint(PWA_file *file_obj, PWA_alignment *PWA_obj,
+                               PWA_prefilter *prefilter_obj);
+    void load_progress(PWA_message *msg_obj);
+    void save_progress(fstream &output_file, long tasks_written);
+
+    // The query of one-vs-many mode, or every query with --queries.
+    vector<string> query_names;
+    vector<string> query_sequences;
+    bool multi_query;       // Each query has its own output file.
+    vector<fstream*> query_files;
+
+    PWA_store *store_obj;   // All-vs-all records; NULL in one-vs-many.
+
+    PWA_scheduler        scheduler_obj;
+    map<long, PWA_task*> finished_tasks;
+
+    mutex              pipeline_mutex;
+    condition_variable task_finished;
+    condition_variable slot_free;
+
+    long tasks_in_flight;
+    long tasks_read;
+    bool reading_done;
+
+    bool matrix_write_failed;
+
+    long resume_index;      // Tasks already written by an earlier run.
+    long output_bytes;      // Bytes of output written so far.
+    string output_path;     // The file output_bytes are counted in.
+    string run_fingerprint; // Input, options and shard of this run.
+
+    static const int output_buffer_size = 1 << 20;
+
+};  // PWA_pipeline
+
+#endif  // PWA_PIPELINE_H
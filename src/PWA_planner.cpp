@@ -0,0 +1,159 @@
+/*=======================================================================*/
+/* Filename: PWA_planner.cpp                                             */
+/*=======================================================================*/
+/* Chooses the alignment engine and number of threads that fit in a      */
+/* memory budget (--max-memory), so that large inputs fall back to       */
+/* engines that need less memory instead of running out of it. The       */
+/* engines are tried from fastest to smallest:                           */
+/*     nw     : full matrix, about 5 bytes per cell (or two rows of      */
+/*              scores and one block of steps with --traceback-file)     */
+/*     banded : only if a band width was given with --band               */
+/*     linear : Hirschberg, a few rows of scores, about twice the time   */
+/*     score  : one row of scores, no alignment                          */
+/*=======================================================================*/
+#include "PWA_arena.h"
+#include "PWA_planner.h"
+#include "PWA_traceback.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace std;
+
+// Memory used by every alignment regardless of engine: the score table,
+// scoring map and stream buffers.
+static const long fixed_bytes = 1L << 20;
+
+// Cells in the small regions PWA_linear aligns with a full matrix.
+static const long linear_region_cells = 16384;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_planner                                              */
+/*-----------------------------------------------------------------------*/
+/* Initializes a planner with no memory budget.                          */
+/*=======================================================================*/
+PWA_planner::PWA_planner()
+{
+    max_memory_bytes  = 0;
+    memory_per_thread = 0;
+    band_width        = 0;
+    traceback_on_disk = 0;
+
+}   // End PWA_planner::PWA_planner().
+
+
+/*=======================================================================*/
+/* Method: PWA_planner::plan_alignment()                                 */
+/*-----------------------------------------------------------------------*/
+/* Returns the fastest engine whose predicted peak memory for a pair of  */
+/* sequences of length_1 and length_2 fits in memory_per_thread, and     */
+/* stores that prediction in predicted_bytes. If nothing fits, returns   */
+/* "score", the smallest engine; the caller can tell from                */
+/* predicted_bytes that it does not fit either.                          */
+/*=======================================================================*/
+string PWA_planner::plan_alignment(long length_1, long length_2,
+                                   long *predicted_bytes)
+{
+    const char *engines[] = {"nw", "banded", "linear", "score"};
+
+    for (int i = 0; i < 4; i++)
+    {
+        string engine = engines[i];
+
+        if ((engine == "banded") && (band_width <= 0))
+        {
+            continue;
+        }
+
+        *predicted_bytes = get_predicted_bytes(engine, length_1, length_2);
+        if (*predicted_bytes <= memory_per_thread)
+        {
+            return (engine);
+        }
+    }
+
+    return ("score");
+
+}   // End PWA_planner::plan_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_planner::plan_threads()                                   */
+/*-----------------------------------------------------------------------*/
+/* Chooses the number of batch worker threads for pairs of about         */
+/* length_1 by length_2. If max_threads full-matrix alignments fit in    */
+/* the budget, all threads are used. If at least half of them fit, that  */
+/* many threads are used, since the full matrix is about twice as fast   */
+/* as the linear-space engine the other threads would need. Otherwise    */
+/* all threads are used and each pair gets a smaller engine.             */
+/*=======================================================================*/
+int PWA_planner::plan_threads(long length_1, long length_2, int max_threads)
+{
+    long full_bytes    = get_predicted_bytes("nw", length_1, length_2);
+    long fitting_pairs = max_memory_bytes / full_bytes;
+
+    if (fitting_pairs >= max_threads)
+    {
+        return (max_threads);
+    }
+    if ((fitting_pairs >= 1) && (fitting_pairs >= max_threads / 2))
+    {
+        return ((int)fitting_pairs);
+    }
+
+    return (max_threads);
+
+}   // End PWA_planner::plan_threads().
+
+
+/*=======================================================================*/
+/* Method: PWA_planner::get_predicted_bytes()                            */
+/*-----------------------------------------------------------------------*/
+/* Returns the predicted peak memory of aligning sequences of length_1   */
+/* (columns) and length_2 (rows) with engine. Every engine also holds    */
+/* copies of both sequences and the three output strings.                */
+/*=======================================================================*/
+long PWA_planner::get_predicted_bytes(string engine, long length_1,
+                                      long length_2)
+{
+    long columns = length_1 + 1;
+    long rows    = length_2 + 1;
+    long bytes   = fixed_bytes + (5 * (length_1 + length_2));
+
+    if ((engine == "nw") && (traceback_on_disk == 1))
+    {
+        // Two score rows and one mapped block of steps.
+        bytes += (2 * columns * sizeof(int)) +
+                 min(PWA_traceback::block_bytes, (columns * rows) / 4);
+    }
+    else if (engine == "nw")
+    {
+        // One int and one step per cell and a pointer per row, in an
+        // arena rounded up to whole huge pages.
+        bytes += (columns * rows * (sizeof(int) + 1)) +
+                 (rows * sizeof(int *)) + PWA_arena::huge_page_bytes;
+    }
+    else if (engine == "banded")
+    {
+        // One step per band cell, band limits per row, two score rows.
+        bytes += (rows * ((2L * band_width) + 1)) + (rows * 16) +
+                 (2 * columns * sizeof(int));
+    }
+    else if (engine == "linear")
+    {
+        // Forward and reverse score rows, one small full-matrix region
+        // and the steps.
+        bytes += (2 * columns * sizeof(int)) +
+                 (linear_region_cells * (sizeof(int) + 1)) +
+                 (length_1 + length_2);
+    }
+    else
+    {
+        // One score row.
+        bytes += columns * sizeof(int);
+    }
+
+    return (bytes);
+
+}   // End PWA_planner::get_predicted_bytes().
@@ -0,0 +1,25 @@
+#ifndef PWA_PLANNER_H
+#define PWA_PLANNER_H
+
+#include <string>
+
+using namespace std;
+
+class PWA_planner
+{
+public:
+    PWA_planner();
+    string plan_alignment(long length_1, long length_2,
+                          long *predicted_bytes);
+    int    plan_threads(long length_1, long length_2, int max_threads);
+    long   get_predicted_bytes(string engine, long length_1,
+                               long length_2);
+
+    long max_memory_bytes;      // Budget for the whole run.
+    long memory_per_thread;     // Budget for one alignment.
+    int  band_width;            // 0 if banded alignment is not allowed.
+    bool traceback_on_disk;     // nw steps go to a scratch file.
+
+};  // PWA_planner
+
+#endif  // PWA_PLANNER_H
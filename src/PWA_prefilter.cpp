@@ -0,0 +1,250 @@
+/*=======================================================================*/
+/* Filename: PWA_prefilter.cpp                                           */
+/*=======================================================================*/
+/* MinHash prefilter for all-vs-all alignment. Each record is reduced   */
+/* to a sketch: the sketch_size smallest hashes of its k-mers. The       */
+/* Jaccard similarity of two records' k-mer sets is estimated from      */
+/* their sketches, and only pairs at or above min_similarity are         */
+/* aligned. Candidate pairs are found through an index from hash to the  */
+/* records sketched with it, so records that share no sketch hash are    */
+/* never compared at all.                                                */
+/*=======================================================================*/
+#include "PWA_prefilter.h"
+#include "PWA_store.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+/*=======================================================================*/
+/* Function: mix_hash()                                                  */
+/*-----------------------------------------------------------------------*/
+/* Spreads the bits of a packed k-mer over the whole 64-bit word         */
+/* (the splitmix64 finalizer), so that the smallest hashes are a random  */
+/* sample of the k-mers.                                                 */
+/*=======================================================================*/
+static unsigned long long mix_hash(unsigned long long value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+
+    return (value);
+
+}   // End mix_hash().
+
+
+/*=======================================================================*/
+/* Constructor: PWA_prefilter                                            */
+/*-----------------------------------------------------------------------*/
+/* Initializes a prefilter with 128-hash sketches of 12-mers for         */
+/* nucleotides and 4-mers for proteins.                                  */
+/*=======================================================================*/
+PWA_prefilter::PWA_prefilter()
+{
+    min_similarity  = 0.05;
+    sketch_size     = 128;
+    nucleotide_kmer = 12;
+    protein_kmer    = 4;
+    record_count    = 0;
+
+}   // End PWA_prefilter::PWA_prefilter().
+
+
+/*=======================================================================*/
+/* Method: PWA_prefilter::sketch_records()                               */
+/*-----------------------------------------------------------------------*/
+/* Sketches every record of store_obj and builds the hash index.         */
+/*=======================================================================*/
+void PWA_prefilter::sketch_records(PWA_store *store_obj)
+{
+    string sequence = "";
+
+    record_count = store_obj->get_record_count();
+    sketches.assign(record_count, vector<unsigned long long>());
+    hash_records.clear();
+    unsketched_records.clear();
+
+    for (long i = 0; i < record_count; i++)
+    {
+        store_obj->get_sequence(i, sequence);
+        sketch_sequence(sequence, store_obj->is_nucleotide(i), sketches[i]);
+
+        if (sketches[i].empty())
+        {
+            unsketched_records.push_back(i);
+        }
+        for (size_t h = 0; h < sketches[i].size(); h++)
+        {
+            hash_records[sketches[i][h]].push_back(i);
+        }
+    }
+
+}   // End PWA_prefilter::sketch_records().
+
+
+/*=======================================================================*/
+/* Method: PWA_prefilter::get_candidate_pairs()                          */
+/*-----------------------------------------------------------------------*/
+/* Stores in partners, in increasing order, every later record that      */
+/* should be aligned with record. Records without a sketch are always    */
+/* aligned, since nothing is known about them.                           */
+/*=======================================================================*/
+void PWA_prefilter::get_candidate_pairs(long record, vector<long> &partners)
+{
+    partners.clear();
+
+    if ((min_similarity <= 0) || sketches[record].empty())
+    {
+        for (long j = record + 1; j < record_count; j++)
+        {
+            partners.push_back(j);
+        }
+        return;
+    }
+
+    // Later records sharing at least one sketch hash.
+    vector<unsigned long long> &sketch = sketches[record];
+    for (size_t h = 0; h < sketch.size(); h++)
+    {
+        vector<long> &records = hash_records[sketch[h]];
+        vector<long>::iterator it = upper_bound(records.begin(),
+                                                records.end(), record);
+        partners.insert(partners.end(), it, records.end());
+    }
+    sort(partners.begin(), partners.end());
+    partners.erase(unique(partners.begin(), partners.end()),
+                   partners.end());
+
+    size_t kept = 0;
+    for (size_t p = 0; p < partners.size(); p++)
+    {
+        if (get_similarity(record, partners[p]) >= min_similarity)
+        {
+            partners[kept++] = partners[p];
+        }
+    }
+    partners.resize(kept);
+
+    // Unsketched records never appear in the index.
+    vector<long>::iterator it = upper_bound(unsketched_records.begin(),
+                                            unsketched_records.end(),
+                                            record);
+    partners.insert(partners.end(), it, unsketched_records.end());
+    sort(partners.begin(), partners.end());
+
+}   // End PWA_prefilter::get_candidate_pairs().
+
+
+/*=======================================================================*/
+/* Method: PWA_prefilter::get_similarity()                               */
+/*-----------------------------------------------------------------------*/
+/* Estimates the Jaccard similarity of two records: the fraction of the  */
+/* sketch_size smallest hashes of the union of both sketches that are    */
+/* in both.                                                              */
+/*=======================================================================*/
+double PWA_prefilter::get_similarity(long record_1, long record_2)
+{
+    vector<unsigned long long> &a = sketches[record_1];
+    vector<unsigned long long> &b = sketches[record_2];
+    size_t i = 0;
+    size_t j = 0;
+    int union_size = 0;
+    int shared     = 0;
+
+    while ((union_size < sketch_size) && (i < a.size()) && (j < b.size()))
+    {
+        if (a[i] == b[j])
+        {
+            shared++;
+            i++;
+            j++;
+        }
+        else if (a[i] < b[j])
+        {
+            i++;
+        }
+        else
+        {
+            j++;
+        }
+        union_size++;
+    }
+
+    // One sketch ran out: the rest of the union comes from the other.
+    union_size = min((size_t)sketch_size,
+                     union_size + (a.size() - i) + (b.size() - j));
+
+    return ((union_size > 0) ? (double)shared / union_size : 0);
+
+}   // End PWA_prefilter::get_similarity().
+
+
+/*=======================================================================*/
+/* Method: PWA_prefilter::sketch_sequence()                              */
+/*-----------------------------------------------------------------------*/
+/* Stores in sketch the sketch_size smallest distinct k-mer hashes of    */
+/* sequence, in increasing order. K-mers are packed 2 bits per base or   */
+/* 5 bits per residue, case-insensitively; k-mers containing a           */
+/* character without a code (such as N) are left out.                    */
+/*=======================================================================*/
+void PWA_prefilter::sketch_sequence(const string &sequence, bool nucleotide,
+                                    vector<unsigned long long> &sketch)
+{
+    int  k     = nucleotide ? nucleotide_kmer : protein_kmer;
+    int  bits  = nucleotide ? 2 : 5;
+    unsigned long long mask = (k * bits >= 64) ? ~0ULL
+                              : (1ULL << (k * bits)) - 1;
+    unsigned long long kmer = 0;
+    int  valid = 0;
+
+    sketch.clear();
+
+    for (size_t i = 0; i < sequence.length(); i++)
+    {
+        int c    = toupper((unsigned char)sequence[i]);
+        int code = -1;
+
+        if (nucleotide)
+        {
+            switch (c)
+            {
+                case 'A': code = 0; break;
+                case 'C': code = 1; break;
+                case 'G': code = 2; break;
+                case 'T': code = 3; break;
+                default:  break;
+            }
+        }
+        else if ((c >= 'A') && (c <= 'Z'))
+        {
+            code = c - 'A';
+        }
+
+        if (code < 0)
+        {
+            valid = 0;
+            continue;
+        }
+
+        kmer = ((kmer << bits) | code) & mask;
+        if (++valid >= k)
+        {
+            sketch.push_back(mix_hash(kmer));
+        }
+    }
+
+    sort(sketch.begin(), sketch.end());
+    sketch.erase(unique(sketch.begin(), sketch.end()), sketch.end());
+    if ((int)sketch.size() > sketch_size)
+    {
+        sketch.resize(sketch_size);
+    }
+
+}   // End PWA_prefilter::sketch_sequence().
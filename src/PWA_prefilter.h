@@ -0,0 +1,40 @@
+#ifndef PWA_PREFILTER_H
+#define PWA_PREFILTER_H
+
+#include "PWA_store.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+class PWA_prefilter
+{
+public:
+    PWA_prefilter();
+    void sketch_records(PWA_store *store_obj);
+    void get_candidate_pairs(long record, vector<long> &partners);
+    double get_similarity(long record_1, long record_2);
+
+    double min_similarity;      // 0 aligns every pair.
+    int    sketch_size;
+    int    nucleotide_kmer;
+    int    protein_kmer;
+
+private:
+    void sketch_sequence(const string &sequence, bool nucleotide,
+                         vector<unsigned long long> &sketch);
+
+    long record_count;
+    vector<vector<unsigned long long> > sketches;
+
+    // Records whose sketch contains each hash.
+    unordered_map<unsigned long long, vector<long> > hash_records;
+
+    // Records too short to sketch; always aligned.
+    vector<long> unsketched_records;
+
+};  // PWA_prefilter
+
+#endif  // PWA_PREFILTER_H
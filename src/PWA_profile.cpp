@@ -0,0 +1,351 @@
+/*=======================================================================*/
+/* Filename: PWA_profile.cpp                                             */
+/*=======================================================================*/
+/* Hardware counter profiling (--profile). Cycles, instructions, cache   */
+/* misses and branch misses are counted with Linux perf_event_open()     */
+/* for the whole process, including the threads it starts, and charged   */
+/* to the phase that is running when they are read: reading the input,   */
+/* the phases of PWA_alignment::begin_PWA_alignment(), the batch         */
+/* pipeline and writing the output.                                      */
+/*                                                                       */
+/* The report gives, per phase, instructions per cycle and misses per    */
+/* thousand instructions: a fill with low IPC and many cache misses is   */
+/* memory-bound (favouring banded, linear or fewer threads), one with    */
+/* high IPC is compute-bound.                                            */
+/*                                                                       */
+/* Counters may be missing (other systems, containers, or                */
+/* perf_event_paranoid); phases are then still timed and the report      */
+/* says why the counters are missing.                                    */
+/*                                                                       */
+/* Batch workers each keep their own profile, counting their own thread, */
+/* which is added to the main one when the worker is done, so the        */
+/* alignment phases of a batch run are totals over the workers.          */
+/*=======================================================================*/
+#include "PWA_profile.h"
+
+#include <chrono>
+#include <errno.h>
+#include <iomanip>
+#include <sstream>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+const char *PWA_profile::counter_names[number_of_counters] =
+    {"cycles", "instructions", "cache misses", "branch misses"};
+
+
+/*=======================================================================*/
+/* Constructor: PWA_profile                                              */
+/*-----------------------------------------------------------------------*/
+/* Initializes a profile with no counters open and no phases.            */
+/*=======================================================================*/
+PWA_profile::PWA_profile()
+{
+    for (int c = 0; c < number_of_counters; c++)
+    {
+        counter_fds[c]        = -1;
+        counter_available[c]  = 0;
+        phase_start_counts[c] = 0;
+    }
+    unavailable_reason = "not opened";
+    current_phase      = -1;
+    workers_added      = 0;
+
+}   // End PWA_profile::PWA_profile().
+
+
+/*=======================================================================*/
+/* Method: PWA_profile::open_counters()                                  */
+/*-----------------------------------------------------------------------*/
+/* Opens one user-space counter per event for the calling thread and     */
+/* the threads it starts from now on. Events the system cannot count are */
+/* left closed, and the first error is kept for the report.              */
+/*=======================================================================*/
+void PWA_profile::open_counters(void)
+{
+#ifdef __linux__
+    const unsigned long long events[number_of_counters] =
+        {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+         PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    unavailable_reason = "";
+
+    for (int c = 0; c < number_of_counters; c++)
+    {
+        struct perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+
+        attributes.type           = PERF_TYPE_HARDWARE;
+        attributes.size           = sizeof(attributes);
+        attributes.config         = events[c];
+        attributes.inherit        = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv     = 1;
+        attributes.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                    PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        counter_fds[c] = syscall(__NR_perf_event_open, &attributes,
+                                 0, -1, -1, 0);
+        counter_available[c] = (counter_fds[c] >= 0);
+        if ((counter_fds[c] < 0) && unavailable_reason.empty())
+        {
+            unavailable_reason = string(counter_names[c]) + ": " +
+                                 strerror(errno);
+        }
+    }
+#else
+    unavailable_reason = "perf_event_open() is Linux only";
+#endif
+
+}   // End PWA_profile::open_counters().
+
+
+/*=======================================================================*/
+/* Method: PWA_profile::close_counters()                                 */
+/*-----------------------------------------------------------------------*/
+/* Ends the current phase, if any, and closes the counters.              */
+/*=======================================================================*/
+void PWA_profile::close_counters(void)
+{
+    end_phase();
+
+    for (int c = 0; c < number_of_counters; c++)
+    {
+        if (counter_fds[c] >= 0)
+        {
+            close(counter_fds[c]);
+            counter_fds[c] = -1;
+        }
+    }
+
+}   // End PWA_profile::close_counters().
+
+
+/*=======================================================================*/
+/* Method: PWA_profile::begin_phase()                                    */
+/*-----------------------------------------------------------------------*/
+/* Starts charging counts and time to the phase name, ending the         */
+/* current phase first. Phases keep the order in which they first ran.   */
+/*=======================================================================*/
+void PWA_profile::begin_phase(const string &name)
+{
+    end_phase();
+
+    for (size_t p = 0; p < phases.size(); p++)
+    {
+        if (phases[p].name == name)
+        {
+            current_phase = p;
+        }
+    }
+    if (current_phase < 0)
+    {
+        PWA_phase phase;
+        phase.name    = name;
+        phase.calls   = 0;
+        phase.seconds = 0;
+        for (int c = 0; c < number_of_counters; c++)
+        {
+            phase.counts[c] = 0;
+        }
+        phases.push_back(phase);
+        current_phase = phases.size() - 1;
+    }
+
+    read_counters(phase_start_counts);
+    phase_start_time = chrono::steady_clock::now();
+
+}   // End PWA_profile::begin_phase().
+
+
+/*=======================================================================*/
+/* Method: PWA_profile::end_phase()                                      */
+/*-----------------------------------------------------------------------*/
+/* Adds the counts and time since begin_phase() to the current phase.    */
+/*=======================================================================*/
+void PWA_profile::end_phase(void)
+{
+    if (current_phase < 0)
+    {
+        return;
+    }
+
+    long counts[number_of_counters];
+    read_counters(counts);
+
+    PWA_phase &phase = phases[current_phase];
+    phase.calls++;
+    phase.seconds += chrono::duration<double>(chrono::steady_clock::now() -
+                                              phase_start_time).count();
+    for (int c = 0; c < number_of_counters; c++)
+    {
+        phase.counts[c] += counts[c] - phase_start_counts[c];
+    }
+
+    current_phase = -1;
+
+}   // End PWA_profile::end_phase().
+
+
+/*=======================================================================*/
+/* Method: PWA_profile::read_counters()                                  */
+/*-----------------------------------------------------------------------*/
+/* Stores the current count of every counter in values, scaled up if the */
+/* kernel had to multiplex the counter, or -1 for closed counters.       */
+/*=======================================================================*/
+void PWA_profile::read_counters(long *values)
+{
+    for (int c = 0; c < number_of_counters; c++)
+    {
+        unsigned long long data[3] = {0, 0, 0};  // Value, enabled, running.
+
+        values[c] = -1;
+        if ((counter_fds[c] >= 0) &&
+            (read(counter_fds[c], data, sizeof(data)) == sizeof(data)))
+        {
+            values[c] = (data[2] > 0) ?
+                        (long)((double)data[0] * data[1] / data[2]) : 0;
+        }
+    }
+
+}   // End PWA_profile::read_counters().
+
+
+/*=======================================================================*/
+/* Method: PWA_profile::add_profile()                                    */
+/*-----------------------------------------------------------------------*/
+/* Adds the calls, time and counts of every phase of worker_profile to   */
+/* the phase of the same name, appending phases not run here. A counter  */
+/* is only shown if every profile added could read it.                   */
+/*=======================================================================*/
+void PWA_profile::add_profile(const PWA_profile &worker_profile)
+{
+    for (size_t w = 0; w < worker_profile.phases.size(); w++)
+    {
+        const PWA_phase &worker_phase = worker_profile.phases[w];
+        size_t p = 0;
+
+        while ((p < phases.size()) && (phases[p].name != worker_phase.name))
+        {
+            p++;
+        }
+        if (p == phases.size())
+        {
+            phases.push_back(worker_phase);
+            continue;
+        }
+
+        phases[p].calls   += worker_phase.calls;
+        phases[p].seconds += worker_phase.seconds;
+        for (int c = 0; c < number_of_counters; c++)
+        {
+            phases[p].counts[c] += worker_phase.counts[c];
+        }
+    }
+
+    for (int c = 0; c < number_of_counters; c++)
+    {
+        counter_available[c] = counter_available[c] &&
+                               worker_profile.counter_available[c];
+    }
+    if (unavailable_reason.empty())
+    {
+        unavailable_reason = worker_profile.unavailable_reason;
+    }
+    workers_added++;
+
+}   // End PWA_profile::add_profile().
+
+
+/*=======================================================================*/
+/* Method: PWA_profile::get_report()                                     */
+/*-----------------------------------------------------------------------*/
+/* Returns a table of the phases with their time and counts, IPC and     */
+/* cache and branch misses per thousand instructions. Unavailable        */
+/* counters are shown as "-". With batch workers added, their phases add */
+/* up the time and counts of every worker.                               */
+/*=======================================================================*/
+string PWA_profile::get_report(void)
+{
+    ostringstream report;
+
+    report << "Profile";
+    if (!unavailable_reason.empty())
+    {
+        report << " (counters unavailable, " << unavailable_reason << ")";
+    }
+    report << ":" << endl;
+
+    report << "  " << left << setw(16) << "Phase" << right
+           << setw(6) << "Calls" << setw(11) << "Seconds"
+           << setw(15) << "Cycles" << setw(15) << "Instructions"
+           << setw(6) << "IPC" << setw(11) << "Cache MPKI"
+           << setw(12) << "Branch MPKI" << endl;
+
+    for (size_t p = 0; p < phases.size(); p++)
+    {
+        PWA_phase &phase = phases[p];
+        long cycles       = phase.counts[0];
+        long instructions = phase.counts[1];
+        bool counted      = counter_available[1] && (instructions > 0);
+
+        report << "  " << left << setw(16) << phase.name << right
+               << setw(6) << phase.calls
+               << setw(11) << fixed << setprecision(3) << phase.seconds;
+
+        for (int c = 0; c < 2; c++)
+        {
+            if (counter_available[c])
+            {
+                report << setw(15) << phase.counts[c];
+            }
+            else
+            {
+                report << setw(15) << "-";
+            }
+        }
+
+        if (counted && counter_available[0] && (cycles > 0))
+        {
+            report << setw(6) << setprecision(2)
+                   << (double)instructions / cycles;
+        }
+        else
+        {
+            report << setw(6) << "-";
+        }
+
+        for (int c = 2; c < 4; c++)
+        {
+            int column_width = (c == 2) ? 11 : 12;
+            if (counted && counter_available[c])
+            {
+                report << setw(column_width) << setprecision(2)
+                       << (1000.0 * phase.counts[c]) / instructions;
+            }
+            else
+            {
+                report << setw(column_width) << "-";
+            }
+        }
+        report << endl;
+    }
+
+    if (workers_added > 0)
+    {
+        report << "  Alignment phases are totals over " << workers_added
+               << " worker(s)." << endl;
+    }
+
+    return (report.str());
+
+}   // End PWA_profile::get_report().
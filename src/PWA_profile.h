@@ -0,0 +1,49 @@
+#ifndef PWA_PROFILE_H
+#define PWA_PROFILE_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Totals of one phase over every time it ran.
+struct PWA_phase
+{
+    string name;
+    long   calls;
+    double seconds;
+    long   counts[4];   // See PWA_profile::counter_names.
+};
+
+class PWA_profile
+{
+public:
+    PWA_profile();
+    void   open_counters(void);
+    void   close_counters(void);
+    void   begin_phase(const string &name);
+    void   end_phase(void);
+    void   add_profile(const PWA_profile &worker_profile);
+    string get_report(void);
+
+    static const int number_of_counters = 4;
+    static const char *counter_names[number_of_counters];
+
+private:
+    void read_counters(long *values);
+
+    int    counter_fds[number_of_counters];    // -1 if closed.
+    bool   counter_available[number_of_counters];
+    string unavailable_reason;
+
+    vector<PWA_phase> phases;
+    int    current_phase;   // Index in phases, -1 between phases.
+    long   phase_start_counts[number_of_counters];
+    chrono::steady_clock::time_point phase_start_time;
+
+    int    workers_added;   // Profiles of batch workers added.
+
+};  // PWA_profile
+
+#endif  // PWA_PROFILE_H
@@ -0,0 +1,414 @@
+/*=======================================================================*/
+/* Filename: PWA_russians.cpp                                            */
+/*=======================================================================*/
+/* Four-Russians engine (--engine russians) for +1/-1 scoring, as used   */
+/* for nucleotides. The matrix is cut into blocks of block_size by       */
+/* block_size cells. As in PWA_difference, only differences between      */
+/* neighbouring cells are kept, and with +1/-1 scoring and gap g they    */
+/* take one of 2 - 2g values. A block's bottom and right differences     */
+/* then only depend on its top and left differences and on which of its  */
+/* cells are matches, so they are looked up in a table holding every     */
+/* such block instead of being computed cell by cell.                    */
+/*                                                                       */
+/* The block is keyed by its match mask rather than by its substrings:   */
+/* +1/-1 scoring only depends on equality, so this is the same table for */
+/* any alphabet, 4^(2t) times smaller. The table for each gap penalty is */
+/* built once per process, on first use, and shared by all threads.      */
+/*                                                                       */
+/* Only the top and left differences of each block are stored (2 bytes   */
+/* per block). The traceback solves the blocks on its path again, with   */
+/* the same tie-breaking as the nw engine, so the alignment is the same. */
+/* Edge blocks of odd-length sequences are solved directly.              */
+/*                                                                       */
+/* This is not the asymptotic Four-Russians method: that needs blocks of */
+/* t = O(log n) cells a side, and with match masks and difference        */
+/* inputs the table grows as 2^(t*t) * values^(2*t), too large past      */
+/* t = 2 for any gap penalty. With t fixed at 2, each lookup does the    */
+/* work of 4 cells, so the engine is still O(n * m), only with a smaller */
+/* constant than cell-by-cell nw.                                        */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_russians.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Largest number of difference values supported (gap penalty -4), so
+// that a difference fits in 4 bits and the table stays small.
+static const int max_values = 10;
+
+// Block tables by gap penalty, built on first use.
+static map<int, vector<unsigned short> > block_tables;
+static mutex block_tables_mutex;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_russians                                             */
+/*-----------------------------------------------------------------------*/
+/* Initializes an empty engine.                                          */
+/*=======================================================================*/
+PWA_russians::PWA_russians()
+{
+    length_1      = 0;
+    length_2      = 0;
+    gap_penalty   = -2;
+    values        = 6;
+    block_rows    = 0;
+    block_columns = 0;
+    final_score   = 0;
+    limit_obj     = NULL;
+
+}   // End PWA_russians::PWA_russians().
+
+
+/*=======================================================================*/
+/* Method: PWA_russians::can_align()                                     */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if PWA_obj uses +1/-1 scoring and a gap penalty from -1 to  */
+/* -4; otherwise the nw engine is used.                                  */
+/*=======================================================================*/
+bool PWA_russians::can_align(PWA_alignment *PWA_obj)
+{
+    int gap = PWA_obj->get_gap_penalty();
+
+    return ((PWA_obj->scoring_specified == 0) && (gap < 0) &&
+            (2 - (2 * gap) <= max_values));
+
+}   // End PWA_russians::can_align().
+
+
+/*=======================================================================*/
+/* Method: PWA_russians::begin_russians_alignment()                      */
+/*-----------------------------------------------------------------------*/
+/* Aligns the two sequences of PWA_obj, which must pass can_align(), and */
+/* stores the alignment in PWA_obj. If the time limit of PWA_obj passes  */
+/* first, sets status_over_limit instead.                                */
+/*=======================================================================*/
+void PWA_russians::begin_russians_alignment(PWA_alignment *PWA_obj)
+{
+    sequence_1    = PWA_obj->sequences_vector[0];
+    sequence_2    = PWA_obj->sequences_vector[1];
+    length_1      = sequence_1.length();
+    length_2      = sequence_2.length();
+    gap_penalty   = PWA_obj->get_gap_penalty();
+    values        = 2 - (2 * gap_penalty);
+    block_rows    = (length_2 + block_size - 1) / block_size;
+    block_columns = (length_1 + block_size - 1) / block_size;
+    limit_obj     = (PWA_obj->time_limit > 0) ? PWA_obj : NULL;
+
+    if (!fill_blocks())
+    {
+        PWA_obj->alignment_status = PWA_alignment::status_over_limit;
+        return;
+    }
+
+    PWA_obj->apply_cigar_string(trace_back_blocks());
+    PWA_obj->alignment_score = final_score;
+
+}   // End PWA_russians::begin_russians_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_russians::get_block_table()                               */
+/*-----------------------------------------------------------------------*/
+/* Returns the table of full blocks for gap_penalty, building it first   */
+/* if needed. Entry                                                      */
+/*     ((mask * values + top_0) * values + top_1) * values ... + left_1  */
+/* holds bottom_0, bottom_1, right_0 and right_1 in 4 bits each, from    */
+/* the lowest bits up. Differences are stored as difference - gap.       */
+/*=======================================================================*/
+const vector<unsigned short> &PWA_russians::get_block_table(int gap_penalty)
+{
+    lock_guard<mutex> lock(block_tables_mutex);
+
+    vector<unsigned short> &table = block_tables[gap_penalty];
+    if (!table.empty())
+    {
+        return (table);
+    }
+
+    int  values = 2 - (2 * gap_penalty);
+    int  cells  = block_size * block_size;
+    long key    = 0;
+
+    table.resize((1L << cells) * values * values * values * values);
+
+    for (int mask = 0; mask < (1 << cells); mask++)
+    {
+        bool match[block_size * block_size];
+        for (int c = 0; c < cells; c++)
+        {
+            match[c] = (mask >> c) & 1;
+        }
+
+        for (int t_0 = 0; t_0 < values; t_0++)
+        for (int t_1 = 0; t_1 < values; t_1++)
+        for (int l_0 = 0; l_0 < values; l_0++)
+        for (int l_1 = 0; l_1 < values; l_1++)
+        {
+            int top[2]  = {t_0 + gap_penalty, t_1 + gap_penalty};
+            int left[2] = {l_0 + gap_penalty, l_1 + gap_penalty};
+            int bottom[2];
+            int right[2];
+
+            solve_block(gap_penalty, 2, 2, match, top, left, bottom, right,
+                        NULL);
+
+            table[key++] = (bottom[0] - gap_penalty) |
+                           ((bottom[1] - gap_penalty) << 4) |
+                           ((right[0] - gap_penalty) << 8) |
+                           ((right[1] - gap_penalty) << 12);
+        }
+    }
+
+    return (table);
+
+}   // End PWA_russians::get_block_table().
+
+
+/*=======================================================================*/
+/* Method: PWA_russians::solve_block()                                   */
+/*-----------------------------------------------------------------------*/
+/* Computes a block of rows by columns cells (at most block_size each)   */
+/* from the differences along its top row boundary (top[c], from column  */
+/* c to c + 1) and left column boundary (left[r], from row r to r + 1).  */
+/* Stores the differences along its bottom row and right column, and, if */
+/* steps is not NULL, the step of each cell (0 D, 1 L, 2 U, row by row). */
+/* Scores are relative to the top left corner, which only changes them   */
+/* by a constant.                                                        */
+/*=======================================================================*/
+void PWA_russians::solve_block(int gap_penalty, int rows, int columns,
+                               const bool *match, const int *top,
+                               const int *left, int *bottom, int *right,
+                               char *steps)
+{
+    int score[block_size + 1][block_size + 1];
+
+    score[0][0] = 0;
+    for (int c = 0; c < columns; c++)
+    {
+        score[0][c+1] = score[0][c] + top[c];
+    }
+    for (int r = 0; r < rows; r++)
+    {
+        score[r+1][0] = score[r][0] + left[r];
+    }
+
+    for (int r = 1; r <= rows; r++)
+    {
+        for (int c = 1; c <= columns; c++)
+        {
+            int diagonal = score[r-1][c-1] +
+                           (match[((r-1) * columns) + (c-1)] ? 1 : -1);
+            int from_left = score[r][c-1] + gap_penalty;
+            int from_up   = score[r-1][c] + gap_penalty;
+            int best      = max(max(diagonal, from_left), from_up);
+            score[r][c]   = best;
+
+            if (steps != NULL)
+            {
+                steps[((r-1) * columns) + (c-1)] =
+                    (best == diagonal) ? 0 : (best == from_left) ? 1 : 2;
+            }
+        }
+    }
+
+    for (int c = 0; c < columns; c++)
+    {
+        bottom[c] = score[rows][c+1] - score[rows][c];
+    }
+    for (int r = 0; r < rows; r++)
+    {
+        right[r] = score[r+1][columns] - score[r][columns];
+    }
+
+}   // End PWA_russians::solve_block().
+
+
+/*=======================================================================*/
+/* Method: PWA_russians::get_match_mask()                                */
+/*-----------------------------------------------------------------------*/
+/* Fills match for the block whose top left cell is (row + 1,            */
+/* column + 1) and returns it as a bit mask, bit r * columns + c.        */
+/*=======================================================================*/
+int PWA_russians::get_match_mask(int row, int column, int rows, int columns,
+                                 bool *match)
+{
+    int mask = 0;
+
+    for (int r = 0; r < rows; r++)
+    {
+        for (int c = 0; c < columns; c++)
+        {
+            match[(r * columns) + c] =
+                (sequence_1[column + c] == sequence_2[row + r]);
+            mask |= match[(r * columns) + c] << ((r * columns) + c);
+        }
+    }
+
+    return (mask);
+
+}   // End PWA_russians::get_match_mask().
+
+
+/*=======================================================================*/
+/* Method: PWA_russians::fill_blocks()                                   */
+/*-----------------------------------------------------------------------*/
+/* Computes the blocks row by row, keeping the bottom differences of the */
+/* previous block row, and the final score as the first column score of  */
+/* the last row plus its horizontal differences. Returns 0 if the time   */
+/* limit of limit_obj passed first.                                      */
+/*=======================================================================*/
+bool PWA_russians::fill_blocks(void)
+{
+    const vector<unsigned short> &table = get_block_table(gap_penalty);
+
+    // Horizontal differences (minus gap_penalty) along the current block
+    // row boundary; row 0 is all gaps.
+    vector<unsigned char> horizontal(length_1 + 1, 0);
+
+    block_inputs.assign((size_t)block_rows * block_columns, 0);
+
+    for (int bi = 0; bi < block_rows; bi++)
+    {
+        int row   = bi * block_size;
+        int rows  = min(block_size, length_2 - row);
+        int left_0 = 0;     // Column 0 is all gaps.
+        int left_1 = 0;
+        unsigned short *inputs = &block_inputs[(size_t)bi * block_columns];
+
+        for (int bj = 0; bj < block_columns; bj++)
+        {
+            int column  = bj * block_size;
+            int columns = min(block_size, length_1 - column);
+            int top_0   = horizontal[column];
+            int top_1   = horizontal[column + 1];
+
+            inputs[bj] = (((top_0 * values) + top_1) * values + left_0) *
+                         values + left_1;
+
+            if ((rows == block_size) && (columns == block_size))
+            {
+                int mask = (sequence_1[column]     == sequence_2[row])     |
+                           ((sequence_1[column + 1] == sequence_2[row]) << 1) |
+                           ((sequence_1[column]     == sequence_2[row + 1]) << 2) |
+                           ((sequence_1[column + 1] == sequence_2[row + 1]) << 3);
+                unsigned short out = table[((long)mask * values * values *
+                                            values * values) + inputs[bj]];
+
+                horizontal[column]     = out & 15;
+                horizontal[column + 1] = (out >> 4) & 15;
+                left_0 = (out >> 8) & 15;
+                left_1 = out >> 12;
+            }
+            else
+            {
+                bool match[block_size * block_size];
+                int  top[2]  = {top_0 + gap_penalty, top_1 + gap_penalty};
+                int  left[2] = {left_0 + gap_penalty, left_1 + gap_penalty};
+                int  bottom[2];
+                int  right[2];
+
+                get_match_mask(row, column, rows, columns, match);
+                solve_block(gap_penalty, rows, columns, match, top, left,
+                            bottom, right, NULL);
+
+                for (int c = 0; c < columns; c++)
+                {
+                    horizontal[column + c] = bottom[c] - gap_penalty;
+                }
+                left_0 = right[0] - gap_penalty;
+                left_1 = (rows > 1) ? right[1] - gap_penalty : 0;
+            }
+        }
+
+        if ((limit_obj != NULL) && limit_obj->exceeds_time_limit())
+        {
+            return (0);
+        }
+    }
+
+    final_score = length_2 * gap_penalty;
+    for (int j = 0; j < length_1; j++)
+    {
+        final_score += horizontal[j] + gap_penalty;
+    }
+
+    return (1);
+
+}   // End PWA_russians::fill_blocks().
+
+
+/*=======================================================================*/
+/* Method: PWA_russians::trace_back_blocks()                             */
+/*-----------------------------------------------------------------------*/
+/* Follows the steps from the last cell back to the first, solving each  */
+/* block on the way again from its stored inputs, and returns them as an */
+/* M/I/D step string in alignment order.                                 */
+/*=======================================================================*/
+string PWA_russians::trace_back_blocks(void)
+{
+    string path = "";
+    int    i    = length_2;     // Cell (i, j), 1-based.
+    int    j    = length_1;
+
+    while ((i > 0) && (j > 0))
+    {
+        int  bi      = (i - 1) / block_size;
+        int  bj      = (j - 1) / block_size;
+        int  row     = bi * block_size;
+        int  column  = bj * block_size;
+        int  rows    = min(block_size, length_2 - row);
+        int  columns = min(block_size, length_1 - column);
+        int  inputs  = block_inputs[((size_t)bi * block_columns) + bj];
+        bool match[block_size * block_size];
+        char steps[block_size * block_size];
+        int  top[2], left[2], bottom[2], right[2];
+
+        left[1] = (inputs % values) + gap_penalty;
+        inputs /= values;
+        left[0] = (inputs % values) + gap_penalty;
+        inputs /= values;
+        top[1]  = (inputs % values) + gap_penalty;
+        inputs /= values;
+        top[0]  = inputs + gap_penalty;
+
+        get_match_mask(row, column, rows, columns, match);
+        solve_block(gap_penalty, rows, columns, match, top, left, bottom,
+                    right, steps);
+
+        // Walk until the path leaves the block.
+        while ((i > row) && (j > column))
+        {
+            int step = steps[((i - 1 - row) * columns) + (j - 1 - column)];
+            if (step == 0)
+            {
+                path += 'M';
+                i--;
+                j--;
+            }
+            else if (step == 1)
+            {
+                path += 'D';
+                j--;
+            }
+            else
+            {
+                path += 'I';
+                i--;
+            }
+        }
+    }
+    path.append(j, 'D');
+    path.append(i, 'I');
+
+    reverse(path.begin(), path.end());
+
+    return (path);
+
+}   // End PWA_russians::trace_back_blocks().
@@ -0,0 +1,50 @@
+#ifndef PWA_RUSSIANS_H
+#define PWA_RUSSIANS_H
+
+#include "PWA_alignment.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_russians
+{
+public:
+    PWA_russians();
+    static bool can_align(PWA_alignment *PWA_obj);
+    void begin_russians_alignment(PWA_alignment *PWA_obj);
+
+    // Cells per block side. Fixed at 2, not log n, since the table grows
+    // as 2^(t*t) * values^(2*t): t = 3 is already 24M entries at gap -2.
+    // Each lookup replaces 4 cells, a constant factor, not log^2 n.
+    static const int block_size = 2;
+
+private:
+    static const vector<unsigned short> &get_block_table(int gap_penalty);
+    static void solve_block(int gap_penalty, int rows, int columns,
+                            const bool *match, const int *top,
+                            const int *left, int *bottom, int *right,
+                            char *steps);
+
+    bool fill_blocks(void);
+    string trace_back_blocks(void);
+    int  get_match_mask(int row, int column, int rows, int columns,
+                        bool *match);
+
+    string sequence_1;      // Columns of the matrix.
+    string sequence_2;      // Rows of the matrix.
+    int    length_1, length_2;
+    int    gap_penalty;
+    int    values;          // Possible differences, gap to 1 - gap.
+    int    block_rows, block_columns;
+    int    final_score;
+    PWA_alignment *limit_obj;   // Checks time_limit after each block row.
+
+    // Boundary differences of each block, top pair then left pair
+    // packed as base-values digits, so it can be solved again.
+    vector<unsigned short> block_inputs;
+
+};  // PWA_russians
+
+#endif  // PWA_RUSSIANS_H
@@ -0,0 +1,582 @@
+/*=======================================================================*/
+/* Filename: PWA_scheduler.cpp                                           */
+/*=======================================================================*/
+/* Work-stealing scheduler for the batch pipeline. Each worker has its   */
+/* own deque of pairs, filled round robin by the producer, and of tiles. */
+/* A worker takes tiles before pairs, its own before others', and steals */
+/* from the front of another worker's deques when its own are empty, so  */
+/* no worker idles while any work is queued.                             */
+/*                                                                       */
+/* A pair too large for one worker (split_cells or more, nw engine) is   */
+/* filled in tiles of tile_size by tile_size cells. A tile is queued     */
+/* once the tiles above and to its left are done, on the deque of the    */
+/* worker that finished them, so the whole pool works along the          */
+/* anti-diagonal of tiles while the pair's own worker waits for the      */
+/* last one and then traces back. Once the pair's time limit has         */
+/* passed, its remaining tiles are skipped but still counted down.       */
+/*                                                                       */
+/* With pin_threads, each worker is pinned to one CPU, and builds its    */
+/* alignment objects after pinning. Under the kernel's first-touch       */
+/* policy a page lands on the node of the thread that first writes it,   */
+/* so the buffers of pairs a worker fills alone are on its node. The     */
+/* matrix of a tiled pair is not: each tile's pages go to the node of    */
+/* the worker that computed (or stole) it first, the pair's own worker   */
+/* may read them across nodes during the traceback, and as its arena is  */
+/* kept, so may later pairs. Nothing is bound or migrated.               */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_scheduler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+/*=======================================================================*/
+/* Function: get_seconds_since()                                         */
+/*-----------------------------------------------------------------------*/
+/* Returns the seconds elapsed since start.                              */
+/*=======================================================================*/
+static double get_seconds_since(chrono::steady_clock::time_point start)
+{
+    return (chrono::duration<double>(chrono::steady_clock::now() -
+                                     start).count());
+
+}   // End get_seconds_since().
+
+
+/*=======================================================================*/
+/* Constructor: PWA_scheduler                                            */
+/*-----------------------------------------------------------------------*/
+/* Initializes a scheduler without workers. Pairs of 2000 x 2000 cells   */
+/* or more are split into 256 x 256 tiles (320 KB of scores and steps,   */
+/* which fits in a core's L2 cache).                                     */
+/*=======================================================================*/
+PWA_scheduler::PWA_scheduler()
+{
+    pin_threads    = 0;
+    tile_size      = 256;
+    split_cells    = 4000000;
+
+    next_queue     = 0;
+    queued_tasks   = 0;
+    queued_tiles   = 0;
+    active_tilings = 0;
+    closed         = 0;
+
+}   // End PWA_scheduler::PWA_scheduler().
+
+
+/*=======================================================================*/
+/* Destructor: PWA_scheduler                                             */
+/*-----------------------------------------------------------------------*/
+/* Frees the worker deques.                                              */
+/*=======================================================================*/
+PWA_scheduler::~PWA_scheduler()
+{
+    for (size_t w = 0; w < queues.size(); w++)
+    {
+        delete queues[w];
+    }
+
+}   // End PWA_scheduler::~PWA_scheduler().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::start()                                        */
+/*-----------------------------------------------------------------------*/
+/* Creates the deques of number_of_workers workers and starts the clock  */
+/* of the utilization report. Called before the workers start.           */
+/*=======================================================================*/
+void PWA_scheduler::start(int number_of_workers)
+{
+    for (int w = 0; w < number_of_workers; w++)
+    {
+        PWA_worker_queue *queue = new PWA_worker_queue();
+        queue->cpu          = -1;
+        queue->pairs        = 0;
+        queue->tiles_run    = 0;
+        queue->steals       = 0;
+        queue->busy_seconds = 0;
+        queue->task_running = 0;
+        queues.push_back(queue);
+    }
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        for (int c = 0; c < CPU_SETSIZE; c++)
+        {
+            if (CPU_ISSET(c, &allowed))
+            {
+                cpus.push_back(c);
+            }
+        }
+    }
+
+    start_time = chrono::steady_clock::now();
+
+}   // End PWA_scheduler::start().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::pin_worker()                                   */
+/*-----------------------------------------------------------------------*/
+/* With pin_threads, pins the calling thread, worker, to one of the CPUs */
+/* the process may run on. Must be called by the worker before it first  */
+/* writes anything it wants on its own NUMA node.                        */
+/*=======================================================================*/
+void PWA_scheduler::pin_worker(int worker)
+{
+    if ((pin_threads == 0) || cpus.empty())
+    {
+        return;
+    }
+
+    int cpu = cpus[worker % cpus.size()];
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set),
+                               &cpu_set) == 0)
+    {
+        queues[worker]->cpu = cpu;
+    }
+
+}   // End PWA_scheduler::pin_worker().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::push_task()                                    */
+/*-----------------------------------------------------------------------*/
+/* Queues a pair on the next worker's deque. Only the producer calls it. */
+/*=======================================================================*/
+void PWA_scheduler::push_task(PWA_task *task)
+{
+    PWA_worker_queue *queue = queues[next_queue];
+    next_queue = (next_queue + 1) % queues.size();
+
+    {
+        lock_guard<mutex> lock(queue->queue_mutex);
+        queue->tasks.push_back(task);
+    }
+    {
+        lock_guard<mutex> lock(idle_mutex);
+        queued_tasks++;
+    }
+    work_ready.notify_one();
+
+}   // End PWA_scheduler::push_task().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::close()                                        */
+/*-----------------------------------------------------------------------*/
+/* Tells the workers that no more pairs will be queued.                  */
+/*=======================================================================*/
+void PWA_scheduler::close(void)
+{
+    lock_guard<mutex> lock(idle_mutex);
+    closed = 1;
+    work_ready.notify_all();
+
+}   // End PWA_scheduler::close().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::get_task()                                     */
+/*-----------------------------------------------------------------------*/
+/* Returns the next pair for worker, running any queued tiles of other   */
+/* workers' pairs first. Returns NULL once the scheduler is closed and   */
+/* no pairs or tiles are left. Calling it also marks the end of the      */
+/* worker's previous pair.                                               */
+/*=======================================================================*/
+PWA_task *PWA_scheduler::get_task(int worker)
+{
+    PWA_worker_queue *queue = queues[worker];
+
+    if (queue->task_running)
+    {
+        queue->busy_seconds += get_seconds_since(queue->task_start);
+        queue->task_running  = 0;
+    }
+
+    for (;;)
+    {
+        PWA_tile  tile;
+        PWA_task *task = NULL;
+
+        if (get_tile(worker, tile))
+        {
+            chrono::steady_clock::time_point tile_start =
+                chrono::steady_clock::now();
+            run_tile(worker, tile);
+            queue->busy_seconds += get_seconds_since(tile_start);
+            continue;
+        }
+
+        if (get_pair(worker, task))
+        {
+            queue->pairs++;
+            queue->task_running = 1;
+            queue->task_start   = chrono::steady_clock::now();
+            return (task);
+        }
+
+        unique_lock<mutex> lock(idle_mutex);
+        work_ready.wait(lock, [this]
+                        { return (queued_tasks > 0) || (queued_tiles > 0) ||
+                                 (closed && (active_tilings == 0)); });
+
+        if ((queued_tasks == 0) && (queued_tiles == 0) && closed &&
+            (active_tilings == 0))
+        {
+            return (NULL);
+        }
+    }
+
+}   // End PWA_scheduler::get_task().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::try_get_task()                                 */
+/*-----------------------------------------------------------------------*/
+/* Returns another pair for worker, which is still busy with the pair    */
+/* of get_task(), or NULL at once if no pair is queued. Tiles are left   */
+/* to get_task().                                                        */
+/*=======================================================================*/
+PWA_task *PWA_scheduler::try_get_task(int worker)
+{
+    PWA_task *task = NULL;
+
+    if (get_pair(worker, task))
+    {
+        queues[worker]->pairs++;
+        return (task);
+    }
+
+    return (NULL);
+
+}   // End PWA_scheduler::try_get_task().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::can_fill_in_tiles()                            */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if a matrix of cells cells is worth splitting into tiles.   */
+/*=======================================================================*/
+bool PWA_scheduler::can_fill_in_tiles(long cells)
+{
+    return ((queues.size() > 1) && (cells >= split_cells));
+
+}   // End PWA_scheduler::can_fill_in_tiles().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::fill_in_tiles()                                */
+/*-----------------------------------------------------------------------*/
+/* Fills tiling, whose first row and column are filled, with the help    */
+/* of the other workers. worker runs tiles (of any pair) until all of    */
+/* this pair's tiles are done.                                           */
+/*=======================================================================*/
+void PWA_scheduler::fill_in_tiles(PWA_tiling *tiling, int worker)
+{
+    tiling->tile_rows    = (tiling->height - 1 + tile_size - 1) / tile_size;
+    tiling->tile_columns = (tiling->width - 1 + tile_size - 1) / tile_size;
+    tiling->tiles_left   = (long)tiling->tile_rows * tiling->tile_columns;
+    tiling->waiting      = new atomic<int>[tiling->tiles_left];
+    tiling->stopped      = 0;
+
+    for (int r = 0; r < tiling->tile_rows; r++)
+    {
+        for (int c = 0; c < tiling->tile_columns; c++)
+        {
+            tiling->waiting[((long)r * tiling->tile_columns) + c] =
+                (r > 0) + (c > 0);
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(idle_mutex);
+        active_tilings++;
+    }
+
+    PWA_tile first = {tiling, 0, 0};
+    push_tile(worker, first);
+
+    while (tiling->tiles_left > 0)
+    {
+        PWA_tile tile;
+        if (get_tile(worker, tile))
+        {
+            run_tile(worker, tile);
+            continue;
+        }
+
+        // Waiting is not work, though it happens within the pair.
+        chrono::steady_clock::time_point wait_start =
+            chrono::steady_clock::now();
+        unique_lock<mutex> lock(idle_mutex);
+        tile_ready.wait(lock, [this, tiling]
+                        { return (queued_tiles > 0) ||
+                                 (tiling->tiles_left == 0); });
+        queues[worker]->busy_seconds -= get_seconds_since(wait_start);
+    }
+
+    delete[] tiling->waiting;
+    tiling->waiting = NULL;
+
+    lock_guard<mutex> lock(idle_mutex);
+    if (--active_tilings == 0)
+    {
+        work_ready.notify_all();
+    }
+
+}   // End PWA_scheduler::fill_in_tiles().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::get_tile()                                     */
+/*-----------------------------------------------------------------------*/
+/* Takes the newest tile of worker's deque, whose neighbours are most    */
+/* likely still in its cache, or else steals the oldest tile of another  */
+/* worker's deque. Returns 0 if no tile is queued.                       */
+/*=======================================================================*/
+bool PWA_scheduler::get_tile(int worker, PWA_tile &tile)
+{
+    if (queued_tiles == 0)
+    {
+        return (0);
+    }
+
+    int number_of_workers = queues.size();
+
+    for (int v = 0; v < number_of_workers; v++)
+    {
+        PWA_worker_queue *victim = queues[(worker + v) % number_of_workers];
+        lock_guard<mutex> lock(victim->queue_mutex);
+
+        if (!victim->tiles.empty())
+        {
+            if (v == 0)
+            {
+                tile = victim->tiles.back();
+                victim->tiles.pop_back();
+            }
+            else
+            {
+                tile = victim->tiles.front();
+                victim->tiles.pop_front();
+                queues[worker]->steals++;
+            }
+            queued_tiles--;
+            return (1);
+        }
+    }
+
+    return (0);
+
+}   // End PWA_scheduler::get_tile().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::get_pair()                                     */
+/*-----------------------------------------------------------------------*/
+/* Takes the oldest pair of worker's deque, or else of another worker's. */
+/* Oldest first keeps the in-order writer moving. Returns 0 if no pair   */
+/* is queued.                                                            */
+/*=======================================================================*/
+bool PWA_scheduler::get_pair(int worker, PWA_task *&task)
+{
+    if (queued_tasks == 0)
+    {
+        return (0);
+    }
+
+    int number_of_workers = queues.size();
+
+    for (int v = 0; v < number_of_workers; v++)
+    {
+        PWA_worker_queue *victim = queues[(worker + v) % number_of_workers];
+        lock_guard<mutex> lock(victim->queue_mutex);
+
+        if (!victim->tasks.empty())
+        {
+            task = victim->tasks.front();
+            victim->tasks.pop_front();
+            if (v > 0)
+            {
+                queues[worker]->steals++;
+            }
+            queued_tasks--;
+            return (1);
+        }
+    }
+
+    return (0);
+
+}   // End PWA_scheduler::get_pair().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::push_tile()                                    */
+/*-----------------------------------------------------------------------*/
+/* Queues a tile that is ready to be filled on worker's deque, and wakes */
+/* an idle worker and any pair owner waiting for tiles.                  */
+/*=======================================================================*/
+void PWA_scheduler::push_tile(int worker, const PWA_tile &tile)
+{
+    {
+        lock_guard<mutex> lock(queues[worker]->queue_mutex);
+        queues[worker]->tiles.push_back(tile);
+    }
+    {
+        lock_guard<mutex> lock(idle_mutex);
+        queued_tiles++;
+    }
+    work_ready.notify_one();
+    tile_ready.notify_all();
+
+}   // End PWA_scheduler::push_tile().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::run_tile()                                     */
+/*-----------------------------------------------------------------------*/
+/* Fills tile (unless the pair is stopped), queues the tiles to its      */
+/* right and below once they have nothing else to wait for, and wakes    */
+/* the owner after the last tile.                                        */
+/* The tiling is not touched after its last tile is counted, since its   */
+/* owner may free it at once.                                            */
+/*=======================================================================*/
+void PWA_scheduler::run_tile(int worker, const PWA_tile &tile)
+{
+    PWA_tiling *tiling = tile.tiling;
+
+    if (!tiling->stopped && (tiling->limit_obj != NULL) &&
+        tiling->limit_obj->exceeds_time_limit())
+    {
+        tiling->stopped = 1;
+    }
+    if (!tiling->stopped)
+    {
+        fill_tile(tile);
+        queues[worker]->tiles_run++;
+    }
+
+    if ((tile.row + 1 < tiling->tile_rows) &&
+        (--tiling->waiting[((long)(tile.row + 1) * tiling->tile_columns) +
+                           tile.column] == 0))
+    {
+        PWA_tile below = {tiling, tile.row + 1, tile.column};
+        push_tile(worker, below);
+    }
+    if ((tile.column + 1 < tiling->tile_columns) &&
+        (--tiling->waiting[((long)tile.row * tiling->tile_columns) +
+                           tile.column + 1] == 0))
+    {
+        PWA_tile right = {tiling, tile.row, tile.column + 1};
+        push_tile(worker, right);
+    }
+
+    if (--tiling->tiles_left == 0)
+    {
+        lock_guard<mutex> lock(idle_mutex);
+        tile_ready.notify_all();
+    }
+
+}   // End PWA_scheduler::run_tile().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::fill_tile()                                    */
+/*-----------------------------------------------------------------------*/
+/* Fills the cells of tile exactly as                                    */
+/* PWA_alignment::fill_alignment_matrix() does, choosing the diagonal,   */
+/* then left, then up step on ties.                                      */
+/*=======================================================================*/
+void PWA_scheduler::fill_tile(const PWA_tile &tile)
+{
+    PWA_tiling *tiling = tile.tiling;
+    int first_row    = 1 + (tile.row * tile_size);
+    int last_row     = min(tiling->height, first_row + tile_size);
+    int first_column = 1 + (tile.column * tile_size);
+    int last_column  = min(tiling->width, first_column + tile_size);
+    int gap_penalty  = tiling->gap_penalty;
+
+    for (int i = first_row; i < last_row; i++)
+    {
+        int  *row      = tiling->matrix[i];
+        int  *previous = tiling->matrix[i-1];
+        char *steps    = tiling->steps + ((long)i * tiling->width);
+        int   char_2   = (unsigned char)tiling->sequence_2[i-1];
+
+        for (int j = first_column; j < last_column; j++)
+        {
+            int char_1   = (unsigned char)tiling->sequence_1[j-1];
+            int diagonal = previous[j-1] +
+                           tiling->score_table[(char_1 << 8) | char_2];
+            int left     = row[j-1] + gap_penalty;
+            int up       = previous[j] + gap_penalty;
+            int best     = max(max(diagonal, left), up);
+
+            row[j]   = best;
+            steps[j] = (best == diagonal) ? 'D' : (best == left) ? 'L' : 'U';
+        }
+    }
+
+}   // End PWA_scheduler::fill_tile().
+
+
+/*=======================================================================*/
+/* Method: PWA_scheduler::get_report()                                   */
+/*-----------------------------------------------------------------------*/
+/* Returns a table of each worker's CPU, pairs, tiles, steals and busy   */
+/* time, and its utilization: busy time over the time since start().     */
+/*=======================================================================*/
+string PWA_scheduler::get_report(void)
+{
+    ostringstream report;
+    double wall_seconds = get_seconds_since(start_time);
+
+    report << "Workers (" << queues.size() << ", "
+           << fixed << setprecision(3) << wall_seconds << " s):" << endl;
+    report << "  " << left << setw(8) << "Worker" << right
+           << setw(6) << "CPU" << setw(10) << "Pairs"
+           << setw(10) << "Tiles" << setw(10) << "Steals"
+           << setw(11) << "Busy s" << setw(8) << "Util %" << endl;
+
+    for (size_t w = 0; w < queues.size(); w++)
+    {
+        PWA_worker_queue *queue = queues[w];
+
+        report << "  " << left << setw(8) << w + 1 << right;
+        if (queue->cpu >= 0)
+        {
+            report << setw(6) << queue->cpu;
+        }
+        else
+        {
+            report << setw(6) << "-";
+        }
+        report << setw(10) << queue->pairs
+               << setw(10) << queue->tiles_run
+               << setw(10) << queue->steals
+               << setw(11) << setprecision(3) << queue->busy_seconds
+               << setw(8) << setprecision(1)
+               << ((wall_seconds > 0) ?
+                   (100.0 * queue->busy_seconds) / wall_seconds : 0)
+               << endl;
+    }
+
+    return (report.str());
+
+}   // End PWA_scheduler::get_report().
@@ -0,0 +1,102 @@
+#ifndef PWA_SCHEDULER_H
+#define PWA_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_alignment;
+struct PWA_task;
+
+// The nw matrix of one pair, filled tile by tile by any worker. The
+// first row and column must already be filled.
+struct PWA_tiling
+{
+    int       **matrix;
+    char       *steps;          // D, L or U for each cell, row by row.
+    const int  *score_table;    // See PWA_alignment::build_score_table().
+    const char *sequence_1;     // Columns of the matrix.
+    const char *sequence_2;     // Rows of the matrix.
+    int         width, height;
+    int         gap_penalty;
+    PWA_alignment *limit_obj;   // Time limit checked per tile, or NULL.
+    atomic<bool>  stopped;      // Set once the time limit has passed.
+
+    int           tile_rows, tile_columns;
+    atomic<int>  *waiting;      // Tiles above and to the left not done.
+    atomic<long>  tiles_left;
+};
+
+struct PWA_tile
+{
+    PWA_tiling *tiling;
+    int         row;
+    int         column;
+};
+
+// Deques and statistics of one worker. Only the worker itself touches
+// the statistics.
+struct PWA_worker_queue
+{
+    mutex            queue_mutex;
+    deque<PWA_task*> tasks;
+    deque<PWA_tile>  tiles;
+
+    int    cpu;             // -1 if not pinned.
+    long   pairs;
+    long   tiles_run;
+    long   steals;
+    double busy_seconds;
+    bool   task_running;
+    chrono::steady_clock::time_point task_start;
+};
+
+class PWA_scheduler
+{
+public:
+    PWA_scheduler();
+    ~PWA_scheduler();
+    void      start(int number_of_workers);
+    void      pin_worker(int worker);
+    void      push_task(PWA_task *task);
+    void      close(void);
+    PWA_task *get_task(int worker);
+    PWA_task *try_get_task(int worker);
+    bool      can_fill_in_tiles(long cells);
+    void      fill_in_tiles(PWA_tiling *tiling, int worker);
+    string    get_report(void);
+
+    bool pin_threads;       // Pin worker i to the i-th allowed CPU.
+    int  tile_size;         // Cells per tile side.
+    long split_cells;       // Pairs this large are filled in tiles.
+
+private:
+    bool get_tile(int worker, PWA_tile &tile);
+    bool get_pair(int worker, PWA_task *&task);
+    void push_tile(int worker, const PWA_tile &tile);
+    void run_tile(int worker, const PWA_tile &tile);
+    void fill_tile(const PWA_tile &tile);
+
+    vector<PWA_worker_queue*> queues;
+    vector<int> cpus;       // CPUs the process may run on.
+    int  next_queue;        // Where the next pair goes, round robin.
+
+    mutex              idle_mutex;
+    condition_variable work_ready;  // For workers in get_task().
+    condition_variable tile_ready;  // For owners in fill_in_tiles().
+    atomic<long> queued_tasks;
+    atomic<long> queued_tiles;
+    long active_tilings;    // Under idle_mutex, like closed.
+    bool closed;
+
+    chrono::steady_clock::time_point start_time;
+
+};  // PWA_scheduler
+
+#endif  // PWA_SCHEDULER_H
@@ -0,0 +1,168 @@
+/*=======================================================================*/
+/* Filename: PWA_shard.cpp                                               */
+/*=======================================================================*/
+/* Splits the pairs of a batch or all-vs-all job between independent     */
+/* processes (--shard i/N) and merges their outputs (--merge N).         */
+/*                                                                       */
+/* Pairs are taken in their canonical output order and each pair is      */
+/* weighted by its matrix size, (length 1 + 1) * (length 2 + 1). Shard   */
+/* i gets the pairs whose midpoint falls in the i-th N-th of the total   */
+/* weight, so every shard gets a contiguous run of pairs with about the  */
+/* same amount of work, and the same input always gives the same split.  */
+/* Because the runs are contiguous, merging is concatenation in shard    */
+/* order.                                                                */
+/*                                                                       */
+/* Shard i of N writes OUTPUT.i-of-N (OUTPUT given with -o), through a   */
+/* temporary file renamed when the shard finishes, so a shard file only  */
+/* exists once it is complete.                                           */
+/*=======================================================================*/
+#include "PWA_message.h"
+#include "PWA_shard.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace std;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_shard                                                */
+/*-----------------------------------------------------------------------*/
+/* Initializes a single shard that owns every pair.                      */
+/*=======================================================================*/
+PWA_shard::PWA_shard()
+{
+    shard_index      = 1;
+    number_of_shards = 1;
+    total_cells      = 0;
+
+}   // End PWA_shard::PWA_shard().
+
+
+/*=======================================================================*/
+/* Method: PWA_shard::parse_shard()                                      */
+/*-----------------------------------------------------------------------*/
+/* Reads shard_index and number_of_shards from text such as "3/8".       */
+/* Returns 0 if text is not of that form with 1 <= i <= N.               */
+/*=======================================================================*/
+bool PWA_shard::parse_shard(const char *text)
+{
+    int  index = 0;
+    int  count = 0;
+    char extra = '\0';
+
+    if ((sscanf(text, "%d/%d%c", &index, &count, &extra) != 2) ||
+        (count < 1) || (index < 1) || (index > count))
+    {
+        return (0);
+    }
+
+    shard_index      = index;
+    number_of_shards = count;
+
+    return (1);
+
+}   // End PWA_shard::parse_shard().
+
+
+/*=======================================================================*/
+/* Method: PWA_shard::owns_pair()                                        */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if the pair whose cells start at start_cells in the         */
+/* canonical order belongs to this shard.                                */
+/*=======================================================================*/
+bool PWA_shard::owns_pair(long start_cells, long pair_cells)
+{
+    return (get_pair_shard(start_cells, pair_cells) == shard_index);
+
+}   // End PWA_shard::owns_pair().
+
+
+/*=======================================================================*/
+/* Method: PWA_shard::get_pair_shard()                                   */
+/*-----------------------------------------------------------------------*/
+/* Returns the shard (1 to number_of_shards) of the pair whose cells     */
+/* start at start_cells: the N-th of total_cells its midpoint is in.     */
+/*=======================================================================*/
+int PWA_shard::get_pair_shard(long start_cells, long pair_cells)
+{
+    if (total_cells <= 0)
+    {
+        return (1);
+    }
+
+    double middle = start_cells + (pair_cells / 2.0);
+    int    shard  = (int)((middle * number_of_shards) / total_cells) + 1;
+
+    return ((shard > number_of_shards) ? number_of_shards : shard);
+
+}   // End PWA_shard::get_pair_shard().
+
+
+/*=======================================================================*/
+/* Method: PWA_shard::get_shard_filename()                               */
+/*-----------------------------------------------------------------------*/
+/* Returns the output file name of shard, e.g. "out.txt.3-of-8".         */
+/*=======================================================================*/
+string PWA_shard::get_shard_filename(const char *output_filename,
+                                     int shard)
+{
+    ostringstream filename;
+    filename << output_filename << "." << shard << "-of-"
+             << number_of_shards;
+
+    return (filename.str());
+
+}   // End PWA_shard::get_shard_filename().
+
+
+/*=======================================================================*/
+/* Method: PWA_shard::merge_shards()                                     */
+/*-----------------------------------------------------------------------*/
+/* Concatenates the outputs of shards 1 to number_of_shards into         */
+/* output_filename, in shard order. All shard files are checked before   */
+/* anything is written, so a missing (unfinished) shard leaves no        */
+/* partial merge behind. The shard files are left in place.              */
+/*=======================================================================*/
+void PWA_shard::merge_shards(const char *output_filename,
+                             int shard_count, PWA_message *msg_obj)
+{
+    number_of_shards = shard_count;
+
+    for (int shard = 1; shard <= number_of_shards; shard++)
+    {
+        ifstream shard_file(get_shard_filename(output_filename,
+                                               shard).c_str());
+        if (!shard_file)
+        {
+            msg_obj->print_missing_shard(
+                get_shard_filename(output_filename, shard));
+        }
+    }
+
+    string   temporary_filename = string(output_filename) + ".tmp";
+    ofstream output_file(temporary_filename.c_str(),
+                         ofstream::out | ofstream::trunc | ofstream::binary);
+
+    for (int shard = 1; shard <= number_of_shards; shard++)
+    {
+        ifstream shard_file(get_shard_filename(output_filename,
+                                               shard).c_str(),
+                            ifstream::in | ifstream::binary);
+
+        // Streaming an empty file would set failbit on output_file.
+        if (shard_file.peek() != ifstream::traits_type::eof())
+        {
+            output_file << shard_file.rdbuf();
+        }
+    }
+
+    output_file.close();
+    rename(temporary_filename.c_str(), output_filename);
+
+    msg_obj->print_merge_summary(number_of_shards, output_filename);
+
+}   // End PWA_shard::merge_shards().
@@ -0,0 +1,27 @@
+#ifndef PWA_SHARD_H
+#define PWA_SHARD_H
+
+#include "PWA_message.h"
+
+#include <string>
+
+using namespace std;
+
+class PWA_shard
+{
+public:
+    PWA_shard();
+    bool   parse_shard(const char *text);
+    bool   owns_pair(long start_cells, long pair_cells);
+    int    get_pair_shard(long start_cells, long pair_cells);
+    string get_shard_filename(const char *output_filename, int shard);
+    void   merge_shards(const char *output_filename, int shard_count,
+                        PWA_message *msg_obj);
+
+    int  shard_index;       // 1 to number_of_shards.
+    int  number_of_shards;
+    long total_cells;       // Estimated cells of all pairs of the job.
+
+};  // PWA_shard
+
+#endif  // PWA_SHARD_H
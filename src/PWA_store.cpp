@@ -0,0 +1,401 @@
+/*=======================================================================*/
+/* Filename: PWA_store.cpp                                               */
+/*=======================================================================*/
+/* Holds every record of an input file in a few large arrays instead of  */
+/* one string per record. Nucleotide records are packed 2 bits per       */
+/* base (A=0, C=1, G=2, T=3) and protein records 5 bits per residue.     */
+/* Characters without a code (N and the other IUPAC codes, gaps, ...)    */
+/* are kept as runs in an exception list, and soft-masked lower-case     */
+/* stretches as runs in a lower-case list, so decoding a record gives    */
+/* back exactly the characters that were read.                           */
+/*                                                                       */
+/* The alignment engines work on decoded strings. The diagonal filter    */
+/* (PWA_diagonal) reads the 2-bit words of nucleotide records directly,  */
+/* with get_packed_words() and get_exception_mask().                     */
+/*=======================================================================*/
+#include "PWA_store.h"
+
+#include <ctype.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Residues with a 5-bit protein code, in code order.
+static const char protein_alphabet[] = "ACDEFGHIKLMNPQRSTVWYBZXJUO*";
+
+// Bases with a 2-bit nucleotide code, in code order.
+static const char nucleotide_alphabet[] = "ACGT";
+
+// Codes of each upper-case character, or no_code.
+static const unsigned char no_code = 255;
+
+
+/*=======================================================================*/
+/* Function: get_code_table()                                            */
+/*-----------------------------------------------------------------------*/
+/* Fills table with the code of every character in alphabet.             */
+/*=======================================================================*/
+static void get_code_table(const char *alphabet, unsigned char *table)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        table[i] = no_code;
+    }
+    for (int i = 0; alphabet[i] != '\0'; i++)
+    {
+        table[(unsigned char)alphabet[i]] = i;
+    }
+
+}   // End get_code_table().
+
+
+/*=======================================================================*/
+/* Constructor: PWA_store                                                */
+/*-----------------------------------------------------------------------*/
+/* Initializes an empty store.                                           */
+/*=======================================================================*/
+PWA_store::PWA_store()
+{
+    clear_records();
+
+}   // End PWA_store::PWA_store().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::clear_records()                                    */
+/*-----------------------------------------------------------------------*/
+/* Removes all records. Each offsets array keeps one entry more than     */
+/* there are records, so the end of record r is the start of r + 1.      */
+/*=======================================================================*/
+void PWA_store::clear_records(void)
+{
+    name_arena.clear();
+    packed_arena.clear();
+    lengths.clear();
+    bits_per_code.clear();
+    exception_starts.clear();
+    exception_lengths.clear();
+    exception_chars.clear();
+    lower_case_starts.clear();
+    lower_case_lengths.clear();
+
+    name_offsets.assign(1, 0);
+    word_offsets.assign(1, 0);
+    exception_offsets.assign(1, 0);
+    lower_case_offsets.assign(1, 0);
+
+}   // End PWA_store::clear_records().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::add_record()                                       */
+/*-----------------------------------------------------------------------*/
+/* Appends a record to the store. A record is packed as nucleotides if   */
+/* at least 90% of it is A, C, G, T or N in either case, and as protein  */
+/* otherwise.                                                            */
+/*=======================================================================*/
+void PWA_store::add_record(const string &name, const string &sequence)
+{
+    static unsigned char nucleotide_codes[256];
+    static unsigned char protein_codes[256];
+    static bool tables_built = 0;
+
+    if (!tables_built)
+    {
+        get_code_table(nucleotide_alphabet, nucleotide_codes);
+        get_code_table(protein_alphabet, protein_codes);
+        tables_built = 1;
+    }
+
+    long length      = sequence.length();
+    long nucleotides = 0;
+
+    for (long i = 0; i < length; i++)
+    {
+        int c = toupper((unsigned char)sequence[i]);
+        if ((nucleotide_codes[c] != no_code) || (c == 'N'))
+        {
+            nucleotides++;
+        }
+    }
+
+    bool nucleotide = (nucleotides * 10 >= length * 9);
+    int  bits       = nucleotide ? 2 : 5;
+    const unsigned char *codes = nucleotide ? nucleotide_codes
+                                            : protein_codes;
+
+    long first_word = word_offsets.back();
+    long words      = ((length * bits) + 63) / 64;
+    long first_bit  = first_word * 64;
+
+    packed_arena.resize(first_word + words, 0);
+
+    for (long i = 0; i < length; i++)
+    {
+        unsigned char c     = sequence[i];
+        unsigned char upper = toupper(c);
+        unsigned char code  = codes[upper];
+
+        if (code == no_code)
+        {
+            // Kept as is, case included; packed as code 0.
+            if (!exception_chars.empty() &&
+                (exception_offsets.back() < (long)exception_starts.size()) &&
+                (exception_chars.back() == (char)c) &&
+                (exception_starts.back() + exception_lengths.back() == i))
+            {
+                exception_lengths.back()++;
+            }
+            else
+            {
+                exception_starts.push_back(i);
+                exception_lengths.push_back(1);
+                exception_chars.push_back(c);
+            }
+            continue;
+        }
+
+        if (c != upper)
+        {
+            if (!lower_case_starts.empty() &&
+                (lower_case_offsets.back() <
+                 (long)lower_case_starts.size()) &&
+                (lower_case_starts.back() + lower_case_lengths.back() == i))
+            {
+                lower_case_lengths.back()++;
+            }
+            else
+            {
+                lower_case_starts.push_back(i);
+                lower_case_lengths.push_back(1);
+            }
+        }
+
+        put_code(first_bit + (i * bits), code, bits);
+    }
+
+    name_arena.append(name);
+    name_offsets.push_back(name_arena.length());
+    word_offsets.push_back(first_word + words);
+    lengths.push_back(length);
+    bits_per_code.push_back(bits);
+    exception_offsets.push_back(exception_starts.size());
+    lower_case_offsets.push_back(lower_case_starts.size());
+
+}   // End PWA_store::add_record().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::get_record_count()                                 */
+/*-----------------------------------------------------------------------*/
+/* Returns the number of records in the store.                           */
+/*=======================================================================*/
+long PWA_store::get_record_count(void)
+{
+    return (lengths.size());
+
+}   // End PWA_store::get_record_count().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::get_length()                                       */
+/*-----------------------------------------------------------------------*/
+/* Returns the number of characters in record.                           */
+/*=======================================================================*/
+long PWA_store::get_length(long record)
+{
+    return (lengths[record]);
+
+}   // End PWA_store::get_length().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::is_nucleotide()                                    */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if record is packed 2 bits per base.                        */
+/*=======================================================================*/
+bool PWA_store::is_nucleotide(long record)
+{
+    return (bits_per_code[record] == 2);
+
+}   // End PWA_store::is_nucleotide().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::get_name()                                         */
+/*-----------------------------------------------------------------------*/
+/* Copies the name of record into name.                                  */
+/*=======================================================================*/
+void PWA_store::get_name(long record, string &name)
+{
+    name.assign(name_arena, name_offsets[record],
+                name_offsets[record+1] - name_offsets[record]);
+
+}   // End PWA_store::get_name().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::get_sequence()                                     */
+/*-----------------------------------------------------------------------*/
+/* Decodes record into sequence: the packed codes first, then the        */
+/* exception runs over them, then the lower-case runs.                   */
+/*=======================================================================*/
+void PWA_store::get_sequence(long record, string &sequence)
+{
+    long length     = lengths[record];
+    int  bits       = bits_per_code[record];
+    long first_bit  = word_offsets[record] * 64;
+    const char *alphabet = (bits == 2) ? nucleotide_alphabet
+                                       : protein_alphabet;
+
+    sequence.resize(length);
+
+    if (bits == 2)
+    {
+        // Four bases per byte, 32 per word; no code crosses a word.
+        const unsigned long long *words = get_packed_words(record);
+        for (long i = 0; i < length; i++)
+        {
+            sequence[i] = alphabet[(words[i >> 5] >> ((i & 31) * 2)) & 3];
+        }
+    }
+    else
+    {
+        for (long i = 0; i < length; i++)
+        {
+            sequence[i] = alphabet[get_code(first_bit + (i * bits), bits)];
+        }
+    }
+
+    for (long r = exception_offsets[record];
+         r < exception_offsets[record+1]; r++)
+    {
+        sequence.replace(exception_starts[r], exception_lengths[r],
+                         exception_lengths[r], exception_chars[r]);
+    }
+
+    for (long r = lower_case_offsets[record];
+         r < lower_case_offsets[record+1]; r++)
+    {
+        long end = lower_case_starts[r] + lower_case_lengths[r];
+        for (long i = lower_case_starts[r]; i < end; i++)
+        {
+            sequence[i] = tolower((unsigned char)sequence[i]);
+        }
+    }
+
+}   // End PWA_store::get_sequence().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::get_packed_words()                                 */
+/*-----------------------------------------------------------------------*/
+/* Returns the first packed word of record. Code i of a nucleotide       */
+/* record is bits 2*(i%32) and up of word i/32; exceptions read as A.    */
+/*=======================================================================*/
+const unsigned long long *PWA_store::get_packed_words(long record)
+{
+    return (packed_arena.data() + word_offsets[record]);
+
+}   // End PWA_store::get_packed_words().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::get_word_count()                                   */
+/*-----------------------------------------------------------------------*/
+/* Returns the number of packed words of record.                         */
+/*=======================================================================*/
+long PWA_store::get_word_count(long record)
+{
+    return (word_offsets[record+1] - word_offsets[record]);
+
+}   // End PWA_store::get_word_count().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::get_exception_mask()                               */
+/*-----------------------------------------------------------------------*/
+/* Fills mask, laid out like the packed words of a nucleotide record,    */
+/* with the low bit of the 2-bit slot of every exception set, so that    */
+/* code comparisons can tell an N (packed as A) from a real A.           */
+/*=======================================================================*/
+void PWA_store::get_exception_mask(long record,
+                                   vector<unsigned long long> &mask)
+{
+    mask.assign(get_word_count(record), 0);
+
+    for (long r = exception_offsets[record];
+         r < exception_offsets[record+1]; r++)
+    {
+        long end = exception_starts[r] + exception_lengths[r];
+        for (long i = exception_starts[r]; i < end; i++)
+        {
+            mask[i >> 5] |= 1ULL << ((i & 31) * 2);
+        }
+    }
+
+}   // End PWA_store::get_exception_mask().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::get_memory_bytes()                                 */
+/*-----------------------------------------------------------------------*/
+/* Returns the memory held by the store, for reports.                    */
+/*=======================================================================*/
+long PWA_store::get_memory_bytes(void)
+{
+    long bytes = name_arena.capacity();
+
+    bytes += packed_arena.capacity() * sizeof(unsigned long long);
+    bytes += (name_offsets.capacity() + word_offsets.capacity() +
+              lengths.capacity() + exception_offsets.capacity() +
+              exception_starts.capacity() + exception_lengths.capacity() +
+              lower_case_offsets.capacity() + lower_case_starts.capacity() +
+              lower_case_lengths.capacity()) * sizeof(long);
+    bytes += bits_per_code.capacity() + exception_chars.capacity();
+
+    return (bytes);
+
+}   // End PWA_store::get_memory_bytes().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::put_code()                                         */
+/*-----------------------------------------------------------------------*/
+/* ORs a code of the given number of bits into the arena at bit. 5-bit   */
+/* codes may cross into the next word.                                   */
+/*=======================================================================*/
+void PWA_store::put_code(long bit, unsigned int code, int bits)
+{
+    long word  = bit >> 6;
+    int  shift = bit & 63;
+
+    packed_arena[word] |= (unsigned long long)code << shift;
+    if (shift + bits > 64)
+    {
+        packed_arena[word+1] |= (unsigned long long)code >> (64 - shift);
+    }
+
+}   // End PWA_store::put_code().
+
+
+/*=======================================================================*/
+/* Method: PWA_store::get_code()                                         */
+/*-----------------------------------------------------------------------*/
+/* Reads the code of the given number of bits at bit.                    */
+/*=======================================================================*/
+unsigned int PWA_store::get_code(long bit, int bits)
+{
+    long word  = bit >> 6;
+    int  shift = bit & 63;
+    unsigned long long value = packed_arena[word] >> shift;
+
+    if (shift + bits > 64)
+    {
+        value |= packed_arena[word+1] << (64 - shift);
+    }
+
+    return (value & ((1u << bits) - 1));
+
+}   // End PWA_store::get_code().
@@ -0,0 +1,56 @@
+#ifndef PWA_STORE_H
+#define PWA_STORE_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_store
+{
+public:
+    PWA_store();
+    void add_record(const string &name, const string &sequence);
+    void clear_records(void);
+
+    long get_record_count(void);
+    long get_length(long record);
+    bool is_nucleotide(long record);
+    void get_name(long record, string &name);
+    void get_sequence(long record, string &sequence);
+    const unsigned long long *get_packed_words(long record);
+    long get_word_count(long record);
+    void get_exception_mask(long record, vector<unsigned long long> &mask);
+    long get_memory_bytes(void);
+
+private:
+    void put_code(long bit, unsigned int code, int bits);
+    unsigned int get_code(long bit, int bits);
+
+    // Names, back to back, and where each one starts.
+    string       name_arena;
+    vector<long> name_offsets;
+
+    // Sequences: 2 bits per character for nucleotide records and 5 bits
+    // for protein records. Every record starts on a new 64-bit word.
+    vector<unsigned long long> packed_arena;
+    vector<long>               word_offsets;
+    vector<long>               lengths;
+    vector<unsigned char>      bits_per_code;
+
+    // Runs of characters that have no code (N, IUPAC codes, other
+    // symbols), stored as they are. exception_offsets[record] is the
+    // first run of each record.
+    vector<long> exception_offsets;
+    vector<long> exception_starts;
+    vector<long> exception_lengths;
+    vector<char> exception_chars;
+
+    // Runs of lower-case (soft-masked) characters.
+    vector<long> lower_case_offsets;
+    vector<long> lower_case_starts;
+    vector<long> lower_case_lengths;
+
+};  // PWA_store
+
+#endif  // PWA_STORE_H
@@ -0,0 +1,231 @@
+/*=======================================================================*/
+/* Filename: PWA_strand.cpp                                              */
+/*=======================================================================*/
+/* Chooses the strand of sequence 2 for --both-strands. Sequence 1 is    */
+/* scored against sequence 2 and its reverse complement in one pass:     */
+/* both score rows are updated in the same loop over the columns, and    */
+/* both read their substitution scores from one query profile (the       */
+/* score of every column of sequence 1 against each character), so the   */
+/* second strand costs little more than the first. The alignment itself  */
+/* is then computed by the selected engine for the better strand only.   */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_strand.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_strand                                               */
+/*-----------------------------------------------------------------------*/
+/* Initializes an empty strand chooser.                                  */
+/*=======================================================================*/
+PWA_strand::PWA_strand()
+{
+    forward_score = 0;
+    reverse_score = 0;
+    columns       = 0;
+    gap_penalty   = -2;
+    free_end_gaps = 0;
+
+}   // End PWA_strand::PWA_strand().
+
+
+/*=======================================================================*/
+/* Method: PWA_strand::choose_strand()                                   */
+/*-----------------------------------------------------------------------*/
+/* Scores both strands of sequence 2 of PWA_obj and sets PWA_obj->strand */
+/* to '+' or '-'. For '-', sequence 2 is replaced by its reverse         */
+/* complement, so the engines align the better strand as usual. Ties go  */
+/* to the forward strand.                                                */
+/*=======================================================================*/
+void PWA_strand::choose_strand(PWA_alignment *PWA_obj)
+{
+    string &sequence_2 = PWA_obj->sequences_vector[1];
+    string reverse_2   = get_reverse_complement(sequence_2);
+
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    columns       = PWA_obj->sequences_vector[0].length();
+    gap_penalty   = PWA_obj->get_gap_penalty();
+    free_end_gaps = (PWA_obj->engine == "overlap");
+
+    build_query_profile(PWA_obj->sequences_vector[0], sequence_2, reverse_2,
+                        PWA_obj->score_table.data());
+    score_both_strands(sequence_2, reverse_2);
+
+    if (reverse_score > forward_score)
+    {
+        PWA_obj->strand = '-';
+        sequence_2.swap(reverse_2);
+    }
+    else
+    {
+        PWA_obj->strand = '+';
+    }
+
+}   // End PWA_strand::choose_strand().
+
+
+/*=======================================================================*/
+/* Method: PWA_strand::get_reverse_complement()                          */
+/*-----------------------------------------------------------------------*/
+/* Returns the reverse complement of a nucleotide sequence. IUPAC        */
+/* ambiguity codes are complemented too, U is read as T, case is kept,   */
+/* and any other character is left as it is.                             */
+/*=======================================================================*/
+string PWA_strand::get_reverse_complement(const string &sequence)
+{
+    static const char *pairs = "ATUACGRYKMBVDHSSWWNN";
+    static char complement[256];
+    static bool table_built = 0;
+
+    if (!table_built)
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            complement[c] = c;
+        }
+        for (int k = 0; pairs[k] != '\0'; k += 2)
+        {
+            complement[(unsigned char)pairs[k]]   = pairs[k+1];
+            complement[(unsigned char)pairs[k]+32] = pairs[k+1] + 32;
+            if (pairs[k] != 'U')
+            {
+                complement[(unsigned char)pairs[k+1]]    = pairs[k];
+                complement[(unsigned char)pairs[k+1]+32] = pairs[k] + 32;
+            }
+        }
+        table_built = 1;
+    }
+
+    string reverse(sequence.rbegin(), sequence.rend());
+    for (size_t i = 0; i < reverse.length(); i++)
+    {
+        reverse[i] = complement[(unsigned char)reverse[i]];
+    }
+
+    return (reverse);
+
+}   // End PWA_strand::get_reverse_complement().
+
+
+/*=======================================================================*/
+/* Method: PWA_strand::build_query_profile()                             */
+/*-----------------------------------------------------------------------*/
+/* Builds one profile row for every character that occurs in either      */
+/* strand of sequence 2: usually just A, C, G and T, however long the    */
+/* sequences are.                                                        */
+/*=======================================================================*/
+void PWA_strand::build_query_profile(const string &sequence_1,
+                                     const string &sequence_2,
+                                     const string &reverse_2,
+                                     const int *score_table)
+{
+    const string *strands[] = {&sequence_2, &reverse_2};
+
+    profile.clear();
+    fill(profile_row, profile_row + 256, -1);
+
+    for (int s = 0; s < 2; s++)
+    {
+        for (size_t i = 0; i < strands[s]->length(); i++)
+        {
+            int char_2 = (unsigned char)(*strands[s])[i];
+            if (profile_row[char_2] >= 0)
+            {
+                continue;
+            }
+
+            profile_row[char_2] = profile.size();
+            profile.push_back(vector<int>(columns));
+            for (int j = 0; j < columns; j++)
+            {
+                int char_1 = (unsigned char)sequence_1[j];
+                profile.back()[j] = score_table[(char_1 << 8) | char_2];
+            }
+        }
+    }
+
+}   // End PWA_strand::build_query_profile().
+
+
+/*=======================================================================*/
+/* Method: PWA_strand::score_both_strands()                              */
+/*-----------------------------------------------------------------------*/
+/* Computes the final score of sequence 1 against both strands, keeping  */
+/* one score row per strand. With free_end_gaps the first row and        */
+/* column are 0 and the score is the best cell of the last row or        */
+/* column, as in PWA_overlap.                                            */
+/*=======================================================================*/
+void PWA_strand::score_both_strands(const string &sequence_2,
+                                    const string &reverse_2)
+{
+    int rows = sequence_2.length();
+    vector<int> forward(columns + 1);
+    vector<int> reverse(columns + 1);
+
+    for (int k = 0; k <= columns; k++)
+    {
+        forward[k] = free_end_gaps ? 0 : k * gap_penalty;
+        reverse[k] = forward[k];
+    }
+    forward_score = forward[columns];
+    reverse_score = reverse[columns];
+
+    for (int i = 0; i < rows; i++)
+    {
+        const int *forward_profile =
+            profile[profile_row[(unsigned char)sequence_2[i]]].data();
+        const int *reverse_profile =
+            profile[profile_row[(unsigned char)reverse_2[i]]].data();
+        int forward_diagonal = forward[0];
+        int reverse_diagonal = reverse[0];
+
+        forward[0] = free_end_gaps ? 0 : (i + 1) * gap_penalty;
+        reverse[0] = forward[0];
+
+        for (int k = 1; k <= columns; k++)
+        {
+            int forward_up = forward[k];
+            int reverse_up = reverse[k];
+
+            forward[k] = max(max(forward_diagonal + forward_profile[k-1],
+                                 forward[k-1] + gap_penalty),
+                             forward_up + gap_penalty);
+            reverse[k] = max(max(reverse_diagonal + reverse_profile[k-1],
+                                 reverse[k-1] + gap_penalty),
+                             reverse_up + gap_penalty);
+
+            forward_diagonal = forward_up;
+            reverse_diagonal = reverse_up;
+        }
+
+        if (free_end_gaps)
+        {
+            forward_score = max(forward_score, forward[columns]);
+            reverse_score = max(reverse_score, reverse[columns]);
+        }
+    }
+
+    if (free_end_gaps)
+    {
+        forward_score = max(forward_score,
+                            *max_element(forward.begin(), forward.end()));
+        reverse_score = max(reverse_score,
+                            *max_element(reverse.begin(), reverse.end()));
+    }
+    else
+    {
+        forward_score = forward[columns];
+        reverse_score = reverse[columns];
+    }
+
+}   // End PWA_strand::score_both_strands().
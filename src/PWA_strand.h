@@ -0,0 +1,39 @@
+#ifndef PWA_STRAND_H
+#define PWA_STRAND_H
+
+#include "PWA_alignment.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_strand
+{
+public:
+    PWA_strand();
+    void choose_strand(PWA_alignment *PWA_obj);
+    static string get_reverse_complement(const string &sequence);
+
+    int forward_score;
+    int reverse_score;
+
+private:
+    void build_query_profile(const string &sequence_1,
+                             const string &sequence_2,
+                             const string &reverse_2,
+                             const int *score_table);
+    void score_both_strands(const string &sequence_2,
+                            const string &reverse_2);
+
+    int  columns;
+    int  gap_penalty;
+    bool free_end_gaps;     // Overlap engine scoring.
+
+    // profile[profile_row[c]][j - 1] is the score of column j against c.
+    vector<vector<int> > profile;
+    int profile_row[256];
+
+};  // PWA_strand
+
+#endif  // PWA_STRAND_H
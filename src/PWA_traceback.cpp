@@ -0,0 +1,360 @@
+/*=======================================================================*/
+/* Filename: PWA_traceback.cpp                                           */
+/*=======================================================================*/
+/* Needleman-Wunsch engine for pairs whose traceback does not fit in     */
+/* memory (--traceback-file). Only two rows of scores are kept in        */
+/* memory; the step of every cell (D, L or U, 2 bits each) goes to a     */
+/* scratch file that is memory-mapped one block of rows at a time.       */
+/*                                                                       */
+/* The fill writes the blocks from the first row to the last and the     */
+/* traceback reads them from the last row to the first, each block       */
+/* being mapped once, so the page cache sees two sequential passes over  */
+/* the file. The result is the same exact alignment as the in-memory     */
+/* nw engine, without the recomputation of the linear-space engine.      */
+/*                                                                       */
+/* The scratch file is created next to the given name (FILE.XXXXXX) and  */
+/* unlinked at once, so it never outlives the alignment, and every       */
+/* alignment (and every batch thread) gets its own.                      */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_message.h"
+#include "PWA_traceback.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <new>
+#include <stdlib.h>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// 2-bit step codes.
+static const int step_diagonal = 0;
+static const int step_left     = 1;
+static const int step_up       = 2;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_traceback                                            */
+/*-----------------------------------------------------------------------*/
+/* Initializes an engine with no scratch file.                           */
+/*=======================================================================*/
+PWA_traceback::PWA_traceback()
+{
+    score_table   = NULL;
+    gap_penalty   = -2;
+    width = height = 0;
+    row_bytes     = 0;
+    final_score   = 0;
+    stopped       = 0;
+
+    scratch_fd    = -1;
+    window        = NULL;
+    window_offset = 0;
+    window_length = 0;
+    first_mapped  = 0;
+    last_mapped   = 0;
+
+}   // End PWA_traceback::PWA_traceback().
+
+
+/*=======================================================================*/
+/* Destructor: PWA_traceback                                             */
+/*-----------------------------------------------------------------------*/
+/* Unmaps the current block and closes the scratch file, so that an      */
+/* alignment abandoned by an exception leaves neither behind.            */
+/*=======================================================================*/
+PWA_traceback::~PWA_traceback()
+{
+    unmap_rows();
+    if (scratch_fd >= 0)
+    {
+        close(scratch_fd);
+    }
+
+}   // End PWA_traceback::~PWA_traceback().
+
+
+/*=======================================================================*/
+/* Method: PWA_traceback::begin_traceback_alignment()                    */
+/*-----------------------------------------------------------------------*/
+/* Aligns the two sequences of PWA_obj, keeping the steps in a scratch   */
+/* file next to PWA_obj->traceback_filename, and stores the alignment    */
+/* in PWA_obj. If the scratch file cannot be created or sized, prints    */
+/* an error and exits. With min_score_specified, stops after any row     */
+/* from which min_score can no longer be reached, and with a time limit, */
+/* after the row on which it passes.                                     */
+/*=======================================================================*/
+void PWA_traceback::begin_traceback_alignment(PWA_alignment *PWA_obj,
+                                              PWA_message *msg_obj)
+{
+    if (PWA_obj->score_table.empty())
+    {
+        PWA_obj->build_score_table();
+    }
+
+    sequence_1  = PWA_obj->sequences_vector[0];
+    sequence_2  = PWA_obj->sequences_vector[1];
+    score_table = PWA_obj->score_table.data();
+    gap_penalty = PWA_obj->get_gap_penalty();
+    width       = sequence_1.length() + 1;
+    height      = sequence_2.length() + 1;
+    row_bytes   = ((width - 1) + 3) / 4;
+
+    long file_bytes = row_bytes * (height - 1);
+    if (file_bytes > 0)
+    {
+        string scratch_name = PWA_obj->traceback_filename + ".XXXXXX";
+        vector<char> name(scratch_name.begin(), scratch_name.end());
+        name.push_back('\0');
+
+        scratch_fd = mkstemp(name.data());
+        if ((scratch_fd < 0) ||
+            (posix_fallocate(scratch_fd, 0, file_bytes) != 0))
+        {
+            msg_obj->print_traceback_file_error(
+                PWA_obj->traceback_filename);
+        }
+        unlink(name.data());
+    }
+
+    bool complete = fill_rows(PWA_obj);
+    string steps  = complete ? trace_back_rows() : "";
+
+    unmap_rows();
+    if (scratch_fd >= 0)
+    {
+        close(scratch_fd);
+        scratch_fd = -1;
+    }
+
+    if (!complete)
+    {
+        PWA_obj->alignment_status = stopped
+                                  ? PWA_alignment::status_over_limit
+                                  : PWA_alignment::status_below_min_score;
+        return;
+    }
+
+    PWA_obj->apply_cigar_string(steps);
+    PWA_obj->alignment_score = final_score;
+
+}   // End PWA_traceback::begin_traceback_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_traceback::fill_rows()                                    */
+/*-----------------------------------------------------------------------*/
+/* Computes the matrix row by row with two score rows, packing the step  */
+/* of each cell into the mapped block. Steps are chosen as in            */
+/* PWA_alignment::get_step_direction(): diagonal, then left, then up.    */
+/* The first row and column are not stored, their steps being known.     */
+/* Returns 0 if the fill was abandoned because of min_score or the time  */
+/* limit (stopped is then set).                                          */
+/*=======================================================================*/
+bool PWA_traceback::fill_rows(PWA_alignment *PWA_obj)
+{
+    vector<int> previous(width);
+    vector<int> current(width);
+    int rows_per_block = max(1L, block_bytes / max(1L, row_bytes));
+
+    for (int j = 0; j < width; j++)
+    {
+        previous[j] = j * gap_penalty;
+    }
+
+    for (int i = 1; i < height; i++)
+    {
+        int char_2 = (unsigned char)sequence_2[i-1];
+        unsigned char *row = NULL;
+
+        if (row_bytes > 0)
+        {
+            if (i - 1 >= last_mapped)
+            {
+                unmap_rows();
+                map_rows(i - 1, min(height - 1, i - 1 + rows_per_block));
+                madvise(window, window_length, MADV_SEQUENTIAL);
+            }
+            row = window + ((long)(i - 1) * row_bytes) - window_offset;
+        }
+
+        unsigned char packed = 0;
+        current[0] = i * gap_penalty;
+
+        for (int j = 1; j < width; j++)
+        {
+            int char_1   = (unsigned char)sequence_1[j-1];
+            int diagonal = previous[j-1] + score_table[(char_1 << 8) | char_2];
+            int left     = current[j-1] + gap_penalty;
+            int up       = previous[j] + gap_penalty;
+            int step     = step_diagonal;
+            int best     = diagonal;
+
+            if (left > best)
+            {
+                best = left;
+                step = step_left;
+            }
+            if (up > best)
+            {
+                best = up;
+                step = step_up;
+            }
+            current[j] = best;
+
+            packed |= step << (2 * ((j - 1) % 4));
+            if (((j - 1) % 4 == 3) || (j == width - 1))
+            {
+                row[(j - 1) / 4] = packed;
+                packed = 0;
+            }
+        }
+
+        if ((PWA_obj->min_score_specified == 1) &&
+            !PWA_obj->can_reach_min_score(current.data(), width - 1,
+                                          height - 1 - i))
+        {
+            return (0);
+        }
+
+        if (PWA_obj->exceeds_time_limit())
+        {
+            stopped = 1;
+            return (0);
+        }
+
+        previous.swap(current);
+    }
+
+    final_score = previous[width - 1];
+
+    return (1);
+
+}   // End PWA_traceback::fill_rows().
+
+
+/*=======================================================================*/
+/* Method: PWA_traceback::trace_back_rows()                              */
+/*-----------------------------------------------------------------------*/
+/* Follows the steps from the last cell back to the first and returns    */
+/* them as an M/I/D step string in alignment order (see                  */
+/* PWA_alignment::apply_cigar_string()).                                 */
+/*=======================================================================*/
+string PWA_traceback::trace_back_rows(void)
+{
+    string steps = "";
+    int    i     = height - 1;
+    int    j     = width - 1;
+
+    steps.reserve(i + j);
+
+    while ((i > 0) || (j > 0))
+    {
+        int step = (i == 0) ? step_left
+                 : (j == 0) ? step_up
+                 : get_step(i, j);
+
+        if (step == step_diagonal)
+        {
+            steps += 'M';
+            i--;
+            j--;
+        }
+        else if (step == step_left)
+        {
+            steps += 'D';
+            j--;
+        }
+        else
+        {
+            steps += 'I';
+            i--;
+        }
+    }
+
+    reverse(steps.begin(), steps.end());
+
+    return (steps);
+
+}   // End PWA_traceback::trace_back_rows().
+
+
+/*=======================================================================*/
+/* Method: PWA_traceback::get_step()                                     */
+/*-----------------------------------------------------------------------*/
+/* Returns the step code of cell (i, j), i and j at least 1. When the    */
+/* traceback moves above the mapped block, the block of rows ending at   */
+/* row i is mapped instead.                                              */
+/*=======================================================================*/
+int PWA_traceback::get_step(int i, int j)
+{
+    int rows_per_block = max(1L, block_bytes / row_bytes);
+
+    if ((i - 1 < first_mapped) || (i - 1 >= last_mapped))
+    {
+        unmap_rows();
+        map_rows(max(0, i - rows_per_block), i);
+        madvise(window, window_length, MADV_WILLNEED);
+    }
+
+    unsigned char packed = window[((long)(i - 1) * row_bytes) +
+                                  ((j - 1) / 4) - window_offset];
+
+    return ((packed >> (2 * ((j - 1) % 4))) & 3);
+
+}   // End PWA_traceback::get_step().
+
+
+/*=======================================================================*/
+/* Method: PWA_traceback::map_rows()                                     */
+/*-----------------------------------------------------------------------*/
+/* Maps the stored rows first_row to last_row - 1 of the scratch file.   */
+/* The mapping starts on the page holding first_row, so window_offset    */
+/* (the file offset of window) is page-aligned. Throws bad_alloc if the  */
+/* rows cannot be mapped.                                                */
+/*=======================================================================*/
+void PWA_traceback::map_rows(int first_row, int last_row)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+    long start     = (long)first_row * row_bytes;
+    long end       = (long)last_row * row_bytes;
+
+    window_offset = start - (start % page_size);
+    window_length = end - window_offset;
+    window        = (unsigned char *)mmap(NULL, window_length,
+                                          PROT_READ | PROT_WRITE, MAP_SHARED,
+                                          scratch_fd, window_offset);
+    if (window == MAP_FAILED)
+    {
+        // Out of address space; the caller owns the decision to exit.
+        window = NULL;
+        throw bad_alloc();
+    }
+
+    first_mapped = first_row;
+    last_mapped  = last_row;
+
+}   // End PWA_traceback::map_rows().
+
+
+/*=======================================================================*/
+/* Method: PWA_traceback::unmap_rows()                                   */
+/*-----------------------------------------------------------------------*/
+/* Unmaps the current block, if any. Written pages stay in the page      */
+/* cache until the kernel writes them back.                              */
+/*=======================================================================*/
+void PWA_traceback::unmap_rows(void)
+{
+    if (window != NULL)
+    {
+        munmap(window, window_length);
+        window = NULL;
+    }
+    first_mapped = 0;
+    last_mapped  = 0;
+
+}   // End PWA_traceback::unmap_rows().
@@ -0,0 +1,48 @@
+#ifndef PWA_TRACEBACK_H
+#define PWA_TRACEBACK_H
+
+#include "PWA_alignment.h"
+#include "PWA_message.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PWA_traceback
+{
+public:
+    PWA_traceback();
+    ~PWA_traceback();
+    void begin_traceback_alignment(PWA_alignment *PWA_obj,
+                                   PWA_message *msg_obj);
+
+    // Rows of steps mapped at a time while filling and tracing back.
+    static const long block_bytes = 16L << 20;
+
+private:
+    bool fill_rows(PWA_alignment *PWA_obj);
+    string trace_back_rows(void);
+    void map_rows(int first_row, int last_row);
+    void unmap_rows(void);
+    int  get_step(int i, int j);
+
+    string       sequence_1;    // Columns of the matrix.
+    string       sequence_2;    // Rows of the matrix.
+    const int   *score_table;
+    int          gap_penalty;
+    int          width, height;
+    long         row_bytes;     // Steps of one row, 4 per byte.
+    int          final_score;
+    bool         stopped;       // The time limit has passed.
+
+    int            scratch_fd;
+    unsigned char *window;      // Mapped rows first_mapped to last_mapped.
+    long           window_offset;
+    long           window_length;
+    int            first_mapped;
+    int            last_mapped; // One past the last mapped row.
+
+};  // PWA_traceback
+
+#endif  // PWA_TRACEBACK_H
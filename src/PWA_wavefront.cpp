@@ -0,0 +1,362 @@
+/*=======================================================================*/
+/* Filename: PWA_wavefront.cpp                                           */
+/*=======================================================================*/
+/* Wavefront alignment (WFA) engine. Instead of filling the whole        */
+/* matrix, the engine keeps, for each alignment penalty s and each       */
+/* diagonal k, the furthest position reachable with penalty s. Runs of   */
+/* matching characters are followed for free, so time and memory grow    */
+/* with the sequence length times the number of differences instead of   */
+/* the product of the sequence lengths.                                  */
+/*                                                                       */
+/* The work is still unbounded for distant pairs, so the time_limit and  */
+/* cell_limit of the alignment are checked after each penalty, counting  */
+/* every wavefront cell computed and every match followed as a cell.     */
+/*                                                                       */
+/* WFA needs free matches. The default scores (match +1, mismatch -1,    */
+/* gap gap_penalty) are converted to equivalent penalties:               */
+/*     2 * score = (n + m) - (4 * mismatches + (1 - 2 * gap) * gaps)     */
+/* where n and m are the sequence lengths, so the alignment with the     */
+/* smallest penalty is also the one with the highest score.              */
+/*=======================================================================*/
+#include "PWA_alignment.h"
+#include "PWA_wavefront.h"
+
+#include <algorithm>
+#include <climits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Marks a diagonal that cannot be reached with a given penalty.
+static const int no_offset = INT_MIN / 2;
+
+
+/*=======================================================================*/
+/* Constructor: PWA_wavefront                                            */
+/*-----------------------------------------------------------------------*/
+/* Initializes an empty wavefront engine.                                */
+/*=======================================================================*/
+PWA_wavefront::PWA_wavefront()
+{
+    cells_computed   = 0;
+    length_1         = 0;
+    length_2         = 0;
+    mismatch_penalty = 4;
+    gap_penalty      = 5;
+    limit_obj        = NULL;
+
+}   // End PWA_wavefront::PWA_wavefront().
+
+
+/*=======================================================================*/
+/* Method: PWA_wavefront::begin_wavefront_alignment()                    */
+/*-----------------------------------------------------------------------*/
+/* Aligns the two sequences in PWA_obj->sequences_vector. Wavefronts     */
+/* are computed for increasing penalties until the last cell of the      */
+/* matrix (offset length_1 on diagonal length_1 - length_2) is reached.  */
+/* The result is stored in PWA_obj exactly as trace_back_steps() and     */
+/* compute_alignment_score() would have stored it. If a limit is passed  */
+/* first, alignment_status is set to status_over_limit instead.          */
+/*=======================================================================*/
+void PWA_wavefront::begin_wavefront_alignment(PWA_alignment *PWA_obj)
+{
+    sequence_1 = PWA_obj->sequences_vector[0];
+    sequence_2 = PWA_obj->sequences_vector[1];
+    length_1   = sequence_1.length();
+    length_2   = sequence_2.length();
+
+    mismatch_penalty = 4;
+    gap_penalty      = 1 - (2 * PWA_obj->get_gap_penalty());
+    limit_obj        = PWA_obj;
+
+    for (size_t s = 0; s < wavefronts.size(); s++)
+    {
+        delete wavefronts[s];
+    }
+    wavefronts.clear();
+    cells_computed = 1;
+
+    // Penalty 0: only the main diagonal, starting at the origin.
+    PWA_wavefront_row *first_row = new PWA_wavefront_row;
+    first_row->lo = first_row->hi = 0;
+    first_row->offsets.push_back(0);
+    wavefronts.push_back(first_row);
+    extend_wavefront(0);
+
+    int  final_diagonal = length_1 - length_2;
+    int  score          = 0;
+    bool stopped        = 0;
+
+    while (get_offset(score, final_diagonal) < length_1)
+    {
+        if (exceeds_limits())
+        {
+            stopped = 1;
+            break;
+        }
+
+        score++;
+        compute_next_wavefront(score);
+        extend_wavefront(score);
+    }
+
+    if (stopped)
+    {
+        PWA_obj->alignment_status = PWA_alignment::status_over_limit;
+    }
+    else
+    {
+        PWA_obj->apply_cigar_string(trace_back_wavefronts(score));
+        PWA_obj->alignment_score = ((length_1 + length_2) - score) / 2;
+    }
+
+    for (size_t s = 0; s < wavefronts.size(); s++)
+    {
+        delete wavefronts[s];
+    }
+    wavefronts.clear();
+
+}   // End PWA_wavefront::begin_wavefront_alignment().
+
+
+/*=======================================================================*/
+/* Method: PWA_wavefront::exceeds_limits()                               */
+/*-----------------------------------------------------------------------*/
+/* Returns 1 if the alignment has computed more cells than the           */
+/* cell_limit of limit_obj allows, or has run past its time_limit.       */
+/*=======================================================================*/
+bool PWA_wavefront::exceeds_limits(void)
+{
+    if ((limit_obj->cell_limit > 0) &&
+        (cells_computed > limit_obj->cell_limit))
+    {
+        return (1);
+    }
+
+    return (limit_obj->exceeds_time_limit());
+
+}   // End PWA_wavefront::exceeds_limits().
+
+
+/*=======================================================================*/
+/* Method: PWA_wavefront::compute_next_wavefront()                       */
+/*-----------------------------------------------------------------------*/
+/* Computes the wavefront of penalty score from the wavefronts of        */
+/* score - mismatch_penalty (same diagonal) and score - gap_penalty      */
+/* (neighbouring diagonals). Penalties that cannot be reached from any   */
+/* earlier wavefront get an empty (NULL) entry.                          */
+/*=======================================================================*/
+void PWA_wavefront::compute_next_wavefront(int score)
+{
+    int lo = INT_MAX;
+    int hi = INT_MIN;
+
+    if ((score >= mismatch_penalty) &&
+        (wavefronts[score - mismatch_penalty] != NULL))
+    {
+        lo = min(lo, wavefronts[score - mismatch_penalty]->lo);
+        hi = max(hi, wavefronts[score - mismatch_penalty]->hi);
+    }
+    if ((score >= gap_penalty) &&
+        (wavefronts[score - gap_penalty] != NULL))
+    {
+        lo = min(lo, wavefronts[score - gap_penalty]->lo - 1);
+        hi = max(hi, wavefronts[score - gap_penalty]->hi + 1);
+    }
+
+    if (lo > hi)
+    {
+        wavefronts.push_back(NULL);
+        return;
+    }
+
+    lo = max(lo, -length_2);
+    hi = min(hi,  length_1);
+
+    PWA_wavefront_row *row = new PWA_wavefront_row;
+    row->lo = lo;
+    row->hi = hi;
+    row->offsets.resize(hi - lo + 1);
+    cells_computed += hi - lo + 1;
+
+    for (int k = lo; k <= hi; k++)
+    {
+        char op;
+        row->offsets[k - lo] = get_next_offset(score, k, &op);
+    }
+
+    wavefronts.push_back(row);
+
+}   // End PWA_wavefront::compute_next_wavefront().
+
+
+/*=======================================================================*/
+/* Method: PWA_wavefront::extend_wavefront()                             */
+/*-----------------------------------------------------------------------*/
+/* Follows matching characters along each diagonal of the wavefront of   */
+/* penalty score. Matches cost nothing, so each offset is moved as far   */
+/* as the sequences keep matching.                                       */
+/*=======================================================================*/
+void PWA_wavefront::extend_wavefront(int score)
+{
+    PWA_wavefront_row *row = wavefronts[score];
+
+    if (row == NULL)
+    {
+        return;
+    }
+
+    for (int k = row->lo; k <= row->hi; k++)
+    {
+        int h = row->offsets[k - row->lo];
+
+        if (h == no_offset)
+        {
+            continue;
+        }
+
+        int v = h - k;
+        while ((h < length_1) && (v < length_2) &&
+               (sequence_1[h] == sequence_2[v]))
+        {
+            h++;
+            v++;
+        }
+
+        cells_computed += h - row->offsets[k - row->lo];
+        row->offsets[k - row->lo] = h;
+    }
+
+}   // End PWA_wavefront::extend_wavefront().
+
+
+/*=======================================================================*/
+/* Method: PWA_wavefront::get_offset()                                   */
+/*-----------------------------------------------------------------------*/
+/* Returns the furthest offset on diagonal k with penalty score, or      */
+/* no_offset if that diagonal was not reached with that penalty.         */
+/*=======================================================================*/
+int PWA_wavefront::get_offset(int score, int k)
+{
+    if ((score < 0) || (score >= (int)wavefronts.size()) ||
+        (wavefronts[score] == NULL) ||
+        (k < wavefronts[score]->lo) || (k > wavefronts[score]->hi))
+    {
+        return (no_offset);
+    }
+
+    return (wavefronts[score]->offsets[k - wavefronts[score]->lo]);
+
+}   // End PWA_wavefront::get_offset().
+
+
+/*=======================================================================*/
+/* Method: PWA_wavefront::get_next_offset()                              */
+/*-----------------------------------------------------------------------*/
+/* Returns the furthest offset on diagonal k with penalty score before   */
+/* extension, and stores in op the step that reached it:                 */
+/*     'M': mismatch, from the same diagonal                             */
+/*     'D': gap in sequence 2, from diagonal k - 1                       */
+/*     'I': gap in sequence 1, from diagonal k + 1                       */
+/* Offsets that would run past the end of either sequence are ignored.   */
+/* Used both to compute wavefronts and to trace back through them.       */
+/*=======================================================================*/
+int PWA_wavefront::get_next_offset(int score, int k, char *op)
+{
+    int best = no_offset;
+    int h    = 0;
+
+    *op = '\0';
+
+    h = get_offset(score - mismatch_penalty, k);
+    if ((h != no_offset) && (h + 1 <= length_1) &&
+        (h + 1 - k <= length_2) && (h + 1 > best))
+    {
+        best = h + 1;
+        *op  = 'M';
+    }
+
+    h = get_offset(score - gap_penalty, k - 1);
+    if ((h != no_offset) && (h + 1 <= length_1) &&
+        (h + 1 - k <= length_2) && (h + 1 > best))
+    {
+        best = h + 1;
+        *op  = 'D';
+    }
+
+    h = get_offset(score - gap_penalty, k + 1);
+    if ((h != no_offset) && (h <= length_1) &&
+        (h - k <= length_2) && (h > best))
+    {
+        best = h;
+        *op  = 'I';
+    }
+
+    return (best);
+
+}   // End PWA_wavefront::get_next_offset().
+
+
+/*=======================================================================*/
+/* Method: PWA_wavefront::trace_back_wavefronts()                        */
+/*-----------------------------------------------------------------------*/
+/* Walks back from the last cell to the origin. At each wavefront, the   */
+/* difference between the stored (extended) offset and the offset        */
+/* before extension is a run of matches; the step that produced the      */
+/* offset before extension leads to an earlier wavefront. Returns the    */
+/* alignment as a cigar string (see get_cigar_string()).                 */
+/*=======================================================================*/
+string PWA_wavefront::trace_back_wavefronts(int final_score)
+{
+    string ops   = "";
+    int    score = final_score;
+    int    k     = length_1 - length_2;
+    int    h     = length_1;
+
+    while (score > 0)
+    {
+        char op;
+        int  h_before = get_next_offset(score, k, &op);
+
+        ops.append(h - h_before, 'M');
+        ops.push_back(op);
+
+        if (op == 'M')
+        {
+            h = h_before - 1;
+            score -= mismatch_penalty;
+        }
+        else if (op == 'D')
+        {
+            h = h_before - 1;
+            k--;
+            score -= gap_penalty;
+        }
+        else
+        {
+            h = h_before;
+            k++;
+            score -= gap_penalty;
+        }
+    }
+    ops.append(h, 'M');
+
+    // Convert the reversed steps to a cigar string.
+    ostringstream cigar;
+    size_t i = ops.length();
+    while (i > 0)
+    {
+        size_t j = i - 1;
+        while ((j > 0) && (ops[j-1] == ops[i-1]))
+        {
+            j--;
+        }
+        cigar << (i - j) << ops[i-1];
+        i = j;
+    }
+
+    return (cigar.str());
+
+}   // End PWA_wavefront::trace_back_wavefronts().
@@ -0,0 +1,47 @@
+#ifndef PWA_WAVEFRONT_H
+#define PWA_WAVEFRONT_H
+
+#include "PWA_alignment.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Furthest-reaching offsets of one score, for diagonals lo to hi.
+struct PWA_wavefront_row
+{
+    int lo, hi;
+    vector<int> offsets;
+};
+
+class PWA_wavefront
+{
+public:
+    PWA_wavefront();
+    void begin_wavefront_alignment(PWA_alignment *PWA_obj);
+
+    long cells_computed;
+
+private:
+    bool exceeds_limits(void);
+    void compute_next_wavefront(int score);
+    void extend_wavefront(int score);
+    int  get_offset(int score, int k);
+    int  get_next_offset(int score, int k, char *op);
+    string trace_back_wavefronts(int final_score);
+
+    string sequence_1;
+    string sequence_2;
+    int    length_1, length_2;
+
+    int mismatch_penalty;
+    int gap_penalty;
+
+    PWA_alignment *limit_obj;   // Checks the limits after each score.
+
+    vector<PWA_wavefront_row*> wavefronts;
+
+};  // PWA_wavefront
+
+#endif  // PWA_WAVEFRONT_H